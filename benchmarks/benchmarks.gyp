@@ -0,0 +1,27 @@
+{
+  'targets': [{
+    'target_name': 'benchmarks',
+    'type': 'executable',
+    'dependencies': [
+      'libadblockplus.gyp:libadblockplus'
+    ],
+    'sources': [
+      'src/AllocationCounter.cpp',
+      'src/BenchmarkPlatform.h',
+      'src/BenchmarkPlatform.cpp',
+      'src/Fixtures.h',
+      'src/Fixtures.cpp',
+      'src/Main.cpp',
+      'src/Report.h',
+      'src/Report.cpp'
+    ],
+    'msvs_settings': {
+      'VCLinkerTool': {
+        'SubSystem': '1',   # Console
+      }
+    },
+    'xcode_settings': {
+      'OTHER_LDFLAGS': ['-stdlib=libstdc++'],
+    },
+  }]
+}
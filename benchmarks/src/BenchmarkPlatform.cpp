@@ -0,0 +1,176 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <future>
+
+#include "BenchmarkPlatform.h"
+
+namespace
+{
+  class SilentLogSystem : public AdblockPlus::LogSystem
+  {
+  public:
+    void operator()(LogLevel logLevel, const std::string& message,
+      const std::string& source) override
+    {
+    }
+  };
+}
+
+FixtureFileSystem::FixtureFileSystem(const AdblockPlus::Scheduler& scheduler,
+  const Files& files)
+  : scheduler(scheduler), mutex(std::make_shared<std::mutex>()),
+    files(std::make_shared<Files>(files))
+{
+}
+
+void FixtureFileSystem::Read(const std::string& fileName,
+  const ReadCallback& callback) const
+{
+  auto mutex = this->mutex;
+  auto files = this->files;
+  scheduler([mutex, files, fileName, callback]
+  {
+    IOBuffer data;
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      auto it = files->find(fileName);
+      if (it == files->end())
+      {
+        callback(IOBuffer(), "File not found, " + fileName);
+        return;
+      }
+      data = it->second;
+    }
+    callback(std::move(data), "");
+  });
+}
+
+void FixtureFileSystem::Write(const std::string& fileName, const IOBuffer& data,
+  const Callback& callback)
+{
+  auto mutex = this->mutex;
+  auto files = this->files;
+  scheduler([mutex, files, fileName, data, callback]
+  {
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      (*files)[fileName] = data;
+    }
+    callback("");
+  });
+}
+
+void FixtureFileSystem::Move(const std::string& fromFileName,
+  const std::string& toFileName, const Callback& callback)
+{
+  auto mutex = this->mutex;
+  auto files = this->files;
+  scheduler([mutex, files, fromFileName, toFileName, callback]
+  {
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      auto it = files->find(fromFileName);
+      if (it == files->end())
+      {
+        callback("File (from) not found, " + fromFileName);
+        return;
+      }
+      (*files)[toFileName] = std::move(it->second);
+      files->erase(fromFileName);
+    }
+    callback("");
+  });
+}
+
+void FixtureFileSystem::Remove(const std::string& fileName,
+  const Callback& callback)
+{
+  auto mutex = this->mutex;
+  auto files = this->files;
+  scheduler([mutex, files, fileName, callback]
+  {
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      files->erase(fileName);
+    }
+    callback("");
+  });
+}
+
+void FixtureFileSystem::Stat(const std::string& fileName,
+  const StatCallback& callback) const
+{
+  auto mutex = this->mutex;
+  auto files = this->files;
+  scheduler([mutex, files, fileName, callback]
+  {
+    StatResult result;
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      result.exists = files->find(fileName) != files->end();
+    }
+    callback(result, "");
+  });
+}
+
+FixtureWebRequest::FixtureWebRequest(const Responses& responses)
+  : responses(responses)
+{
+}
+
+AdblockPlus::ServerResponse FixtureWebRequest::GET(const std::string& url,
+  const AdblockPlus::HeaderList& requestHeaders) const
+{
+  AdblockPlus::ServerResponse response;
+  response.status = AdblockPlus::IWebRequest::NS_OK;
+  // Downloader appends query parameters to the subscription URL.
+  auto it = responses.find(url.substr(0, url.find('?')));
+  if (it == responses.end())
+  {
+    response.responseStatus = 404;
+    return response;
+  }
+  response.responseStatus = 200;
+  response.responseText = it->second;
+  return response;
+}
+
+std::unique_ptr<AdblockPlus::Platform> CreateBenchmarkPlatform(
+  const FixtureFileSystem::Files& files, const FixtureWebRequest::Responses& responses)
+{
+  AdblockPlus::DefaultPlatformBuilder builder;
+  builder.logSystem.reset(new SilentLogSystem());
+  builder.fileSystem.reset(new FixtureFileSystem(builder.GetDefaultAsyncExecutor(), files));
+  builder.CreateDefaultWebRequest(AdblockPlus::WebRequestSyncPtr(new FixtureWebRequest(responses)));
+  return builder.CreatePlatform();
+}
+
+AdblockPlus::FilterEngine& CreateFilterEngine(AdblockPlus::Platform& platform)
+{
+  auto& jsEngine = platform.GetJsEngine();
+  AdblockPlus::FilterEngine::CreationParameters parameters;
+  parameters.preconfiguredPrefs.emplace("first_run_subscription_auto_select", jsEngine.NewValue(false));
+  parameters.preconfiguredPrefs.emplace("disable_auto_updates", jsEngine.NewValue(true));
+  std::promise<void> created;
+  platform.CreateFilterEngineAsync(parameters, [&created](const AdblockPlus::FilterEngine&)
+  {
+    created.set_value();
+  });
+  created.get_future().wait();
+  return platform.GetFilterEngine();
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_PLATFORM_H
+#define BENCHMARK_PLATFORM_H
+
+#include <AdblockPlus.h>
+#include <AdblockPlus/Platform.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * File system keeping the files in memory, so disk performance does not
+ * affect the results.
+ */
+class FixtureFileSystem : public AdblockPlus::IFileSystem
+{
+public:
+  typedef std::map<std::string, IOBuffer> Files;
+
+  FixtureFileSystem(const AdblockPlus::Scheduler& scheduler, const Files& files);
+  void Read(const std::string& fileName, const ReadCallback& callback) const override;
+  void Write(const std::string& fileName, const IOBuffer& data,
+    const Callback& callback) override;
+  void Move(const std::string& fromFileName, const std::string& toFileName,
+    const Callback& callback) override;
+  void Remove(const std::string& fileName, const Callback& callback) override;
+  void Stat(const std::string& fileName, const StatCallback& callback) const override;
+
+private:
+  AdblockPlus::Scheduler scheduler;
+  std::shared_ptr<std::mutex> mutex;
+  std::shared_ptr<Files> files;
+};
+
+/**
+ * Web request serving the fixtures, any other URL results in 404.
+ */
+class FixtureWebRequest : public AdblockPlus::IWebRequestSync
+{
+public:
+  typedef std::map<std::string, std::string> Responses;
+
+  explicit FixtureWebRequest(const Responses& responses);
+  AdblockPlus::ServerResponse GET(const std::string& url,
+    const AdblockPlus::HeaderList& requestHeaders) const override;
+
+private:
+  Responses responses;
+};
+
+/**
+ * Creates a platform with the default timer, the fixture file system and
+ * the fixture web request.
+ */
+std::unique_ptr<AdblockPlus::Platform> CreateBenchmarkPlatform(
+  const FixtureFileSystem::Files& files, const FixtureWebRequest::Responses& responses);
+
+/**
+ * Creates the filter engine and blocks until it's ready.
+ */
+AdblockPlus::FilterEngine& CreateFilterEngine(AdblockPlus::Platform& platform);
+
+#endif
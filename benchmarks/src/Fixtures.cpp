@@ -0,0 +1,183 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+
+#include "Fixtures.h"
+
+namespace
+{
+  // Share of each kind of filter in EasyList, in percent.
+  const unsigned kGenericHidingShare = 25;
+  const unsigned kDomainHidingShare = 20;
+  const unsigned kHostBlockingShare = 20;
+  const unsigned kPathBlockingShare = 15;
+  const unsigned kOptionBlockingShare = 10;
+  const unsigned kExceptionShare = 7;
+
+  // Number of document domains the filters and requests refer to.
+  const unsigned kSiteCount = 2000;
+
+  const char* const kTopLevelDomains[] = {"com", "net", "org", "de", "co.uk"};
+  const char* const kPathWords[] = {"ads", "banner", "promo", "track", "sponsor", "pixel", "adframe", "popunder"};
+
+  class Random
+  {
+  public:
+    explicit Random(uint32_t seed)
+      : state(seed)
+    {
+    }
+
+    uint32_t Next(uint32_t bound)
+    {
+      state = state * 1664525u + 1013904223u;
+      return (state >> 8) % bound;
+    }
+  private:
+    uint32_t state;
+  };
+
+  template<class T, size_t N>
+  const T& Pick(Random& random, const T (&items)[N])
+  {
+    return items[random.Next(N)];
+  }
+
+  std::string Site(unsigned index)
+  {
+    std::ostringstream site;
+    site << "site" << index << "." << kTopLevelDomains[index % 5];
+    return site.str();
+  }
+
+  std::string AdServer(unsigned index)
+  {
+    std::ostringstream host;
+    host << "adserver" << index << "." << kTopLevelDomains[index % 5];
+    return host.str();
+  }
+}
+
+std::vector<std::string> Fixtures::GenerateFilters(size_t filterCount)
+{
+  Random random(1);
+  std::vector<std::string> filters;
+  filters.reserve(filterCount);
+  for (size_t i = 0; i < filterCount; ++i)
+  {
+    std::ostringstream filter;
+    unsigned kind = random.Next(100);
+    if (kind < kGenericHidingShare)
+      filter << "##." << Pick(random, kPathWords) << "-box-" << i;
+    else if ((kind -= kGenericHidingShare) < kDomainHidingShare)
+      filter << Site(random.Next(kSiteCount)) << "###" << Pick(random, kPathWords) << "-" << i;
+    else if ((kind -= kDomainHidingShare) < kHostBlockingShare)
+      filter << "||" << AdServer(i) << "^$third-party";
+    else if ((kind -= kHostBlockingShare) < kPathBlockingShare)
+      filter << "/" << Pick(random, kPathWords) << i << "/" << Pick(random, kPathWords) << ".";
+    else if ((kind -= kPathBlockingShare) < kOptionBlockingShare)
+      filter << "||" << AdServer(i) << "/" << Pick(random, kPathWords) << "/$script,domain=" << Site(random.Next(kSiteCount));
+    else if ((kind -= kOptionBlockingShare) < kExceptionShare)
+      filter << "@@||" << AdServer(i) << "/" << Pick(random, kPathWords) << "/$image";
+    else
+      filter << Site(random.Next(kSiteCount)) << "#@#." << Pick(random, kPathWords) << "-box-" << i;
+    filters.push_back(filter.str());
+  }
+  return filters;
+}
+
+std::string Fixtures::ToFilterList(const std::vector<std::string>& filters)
+{
+  std::string list = "[Adblock Plus 2.0]\n! Title: Benchmark list\n! Expires: 4 days\n";
+  for (const auto& filter : filters)
+  {
+    list += filter;
+    list += '\n';
+  }
+  return list;
+}
+
+std::string Fixtures::ToPatternsIni(const std::string& subscriptionUrl,
+  const std::vector<std::string>& filters, std::time_t now)
+{
+  const std::time_t expires = now + 365 * 24 * 60 * 60;
+  std::ostringstream ini;
+  ini << "# Adblock Plus preferences\nversion=5\n\n"
+      << "[Subscription]\nurl=" << subscriptionUrl << "\ntitle=Benchmark list\n"
+      << "lastDownload=" << now << "\nlastSuccess=" << now << "\nlastCheck=" << now << "\n"
+      << "expires=" << expires << "\nsoftExpiration=" << expires << "\n\n"
+      << "[Subscription filters]\n";
+  for (const auto& filter : filters)
+  {
+    // square brackets at the line start would begin a new section
+    if (!filter.empty() && filter[0] == '[')
+      ini << '\\';
+    ini << filter << '\n';
+  }
+  return ini.str();
+}
+
+std::vector<BenchmarkRequest> Fixtures::GenerateRequests(size_t requestCount)
+{
+  typedef AdblockPlus::FilterEngine FilterEngine;
+  const FilterEngine::ContentType contentTypes[] = {
+    FilterEngine::CONTENT_TYPE_SCRIPT, FilterEngine::CONTENT_TYPE_IMAGE,
+    FilterEngine::CONTENT_TYPE_STYLESHEET, FilterEngine::CONTENT_TYPE_SUBDOCUMENT,
+    FilterEngine::CONTENT_TYPE_XMLHTTPREQUEST, FilterEngine::CONTENT_TYPE_OTHER
+  };
+
+  Random random(2);
+  std::vector<BenchmarkRequest> requests;
+  requests.reserve(requestCount);
+  for (size_t i = 0; i < requestCount; ++i)
+  {
+    BenchmarkRequest request;
+    request.contentType = Pick(random, contentTypes);
+    std::string site = Site(random.Next(kSiteCount));
+    request.documentUrl = "https://" + site + "/";
+    std::ostringstream url;
+    switch (random.Next(4))
+    {
+    case 0:
+      // third-party request to a host which likely has a filter
+      url << "https://" << AdServer(random.Next(20000)) << "/" << Pick(random, kPathWords) << "/" << i << ".js";
+      break;
+    case 1:
+      url << "https://cdn" << random.Next(50) << ".example.net/" << Pick(random, kPathWords)
+          << random.Next(20000) << "/" << Pick(random, kPathWords) << ".gif?r=" << i;
+      break;
+    default:
+      // first-party resources are the majority and are rarely blocked
+      url << "https://" << site << "/static/" << random.Next(1000) << "/app" << i << ".js";
+      break;
+    }
+    request.url = url.str();
+    requests.push_back(request);
+  }
+  return requests;
+}
+
+std::vector<std::string> Fixtures::GenerateDomains(size_t domainCount)
+{
+  Random random(3);
+  std::vector<std::string> domains;
+  domains.reserve(domainCount);
+  for (size_t i = 0; i < domainCount; ++i)
+    domains.push_back(Site(random.Next(kSiteCount)));
+  return domains;
+}
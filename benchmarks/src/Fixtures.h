@@ -0,0 +1,70 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <AdblockPlus.h>
+#include <ctime>
+#include <string>
+#include <vector>
+
+struct BenchmarkRequest
+{
+  std::string url;
+  AdblockPlus::FilterEngine::ContentType contentType;
+  std::string documentUrl;
+};
+
+/**
+ * Deterministic generators of benchmark input. The same parameters always
+ * yield the same data, so results of different runs are comparable.
+ */
+namespace Fixtures
+{
+  /**
+   * Generates filters resembling EasyList in the mix of blocking, exception,
+   * generic and domain specific element hiding filters.
+   */
+  std::vector<std::string> GenerateFilters(size_t filterCount);
+
+  /**
+   * Formats filters as a downloadable filter list.
+   */
+  std::string ToFilterList(const std::vector<std::string>& filters);
+
+  /**
+   * Formats filters as patterns.ini containing one up-to-date subscription,
+   * so loading it does not trigger a download.
+   */
+  std::string ToPatternsIni(const std::string& subscriptionUrl,
+    const std::vector<std::string>& filters, std::time_t now);
+
+  /**
+   * Generates requests of different content types, some of them are
+   * blocked or whitelisted by the generated filters.
+   */
+  std::vector<BenchmarkRequest> GenerateRequests(size_t requestCount);
+
+  /**
+   * Generates document domains, some of them have domain specific element
+   * hiding filters.
+   */
+  std::vector<std::string> GenerateDomains(size_t domainCount);
+}
+
+#endif
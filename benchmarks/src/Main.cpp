@@ -0,0 +1,288 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "../../src/FilePrefetcher.h"
+#include "../../src/FilterLineParser.h"
+#include "BenchmarkPlatform.h"
+#include "Fixtures.h"
+#include "Report.h"
+
+namespace
+{
+  const std::string kSubscriptionUrl = "https://fixtures.invalid/easylist.txt";
+
+  struct Options
+  {
+    Options()
+      : filters(60000), requests(10000), domains(1000), iterations(3)
+    {
+    }
+    size_t filters;
+    size_t requests;
+    size_t domains;
+    size_t iterations;
+    std::string output;
+    std::string fixturesDirectory;
+  };
+
+  bool ParseOption(const std::string& argument, const std::string& name, std::string& value)
+  {
+    std::string prefix = "--" + name + "=";
+    if (argument.compare(0, prefix.size(), prefix) != 0)
+      return false;
+    value = argument.substr(prefix.size());
+    return true;
+  }
+
+  Options ParseOptions(int argc, char* argv[])
+  {
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string value;
+      if (ParseOption(argv[i], "filters", value))
+        options.filters = std::strtoul(value.c_str(), nullptr, 10);
+      else if (ParseOption(argv[i], "requests", value))
+        options.requests = std::strtoul(value.c_str(), nullptr, 10);
+      else if (ParseOption(argv[i], "domains", value))
+        options.domains = std::strtoul(value.c_str(), nullptr, 10);
+      else if (ParseOption(argv[i], "iterations", value))
+        options.iterations = std::strtoul(value.c_str(), nullptr, 10);
+      else if (ParseOption(argv[i], "output", value))
+        options.output = value;
+      else if (ParseOption(argv[i], "write-fixtures", value))
+        options.fixturesDirectory = value;
+      else
+        throw std::invalid_argument("Unknown argument " + std::string(argv[i]) +
+          ", supported: --filters=N --requests=N --domains=N --iterations=N"
+          " --output=FILE --write-fixtures=DIRECTORY");
+    }
+    return options;
+  }
+
+  FixtureFileSystem::IOBuffer ToBuffer(const std::string& data)
+  {
+    return FixtureFileSystem::IOBuffer(data.begin(), data.end());
+  }
+
+  void WriteFile(const std::string& path, const std::string& data)
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << data;
+    if (!file)
+      throw std::runtime_error("Cannot write " + path);
+  }
+
+  void WriteFixtures(const std::string& directory, const std::string& filterList,
+    const std::string& patternsIni, const std::vector<BenchmarkRequest>& requests)
+  {
+    WriteFile(directory + "/easylist.txt", filterList);
+    WriteFile(directory + "/patterns.ini", patternsIni);
+    std::string corpus;
+    for (const auto& request : requests)
+    {
+      corpus += request.url + " " +
+        AdblockPlus::FilterEngine::ContentTypeToString(request.contentType) + " " +
+        request.documentUrl + "\n";
+    }
+    WriteFile(directory + "/requests.txt", corpus);
+  }
+
+  std::unique_ptr<AdblockPlus::Platform> BenchmarkEngineCreation(Report& report,
+    const std::string& name, const FixtureFileSystem::Files& files, size_t iterations)
+  {
+    std::unique_ptr<AdblockPlus::Platform> platform;
+    std::vector<double> samples;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+      platform.reset();
+      platform = CreateBenchmarkPlatform(files, FixtureWebRequest::Responses());
+      Stopwatch stopwatch;
+      CreateFilterEngine(*platform);
+      samples.push_back(stopwatch.ElapsedMicroseconds());
+    }
+    report.AddLatencies(name, samples);
+    return platform;
+  }
+
+  void BenchmarkSubscriptionParse(Report& report, const std::string& filterList)
+  {
+    FixtureWebRequest::Responses responses;
+    responses[kSubscriptionUrl] = filterList;
+    auto platform = CreateBenchmarkPlatform(FixtureFileSystem::Files(), responses);
+    auto& filterEngine = CreateFilterEngine(*platform);
+
+    std::mutex mutex;
+    std::condition_variable downloaded;
+    bool isDownloaded = false;
+    filterEngine.SetFilterChangeCallback([&](const std::string& action, AdblockPlus::JsValue&& item)
+    {
+      if (action != "subscription.downloadStatus" ||
+          item.GetProperty("url").AsString() != kSubscriptionUrl)
+        return;
+      std::lock_guard<std::mutex> lock(mutex);
+      isDownloaded = true;
+      downloaded.notify_one();
+    });
+
+    Stopwatch stopwatch;
+    filterEngine.GetSubscription(kSubscriptionUrl).AddToList();
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (!downloaded.wait_for(lock, std::chrono::minutes(5), [&isDownloaded] { return isDownloaded; }))
+        throw std::runtime_error("Subscription download has timed out");
+    }
+    report.Add("subscriptionParse", "totalUs", stopwatch.ElapsedMicroseconds());
+    filterEngine.RemoveFilterChangeCallback();
+    report.Add("subscriptionParse", "filters", static_cast<double>(
+      filterEngine.GetSubscription(kSubscriptionUrl).GetProperty("filters").AsList().size()));
+  }
+
+  void BenchmarkFilterKeywords(Report& report, const std::vector<std::string>& filters)
+  {
+    // several large subscriptions, like a list with its supplements.
+    const int subscriptionCount = 6;
+    std::string patternsIni;
+    for (int i = 0; i < subscriptionCount; ++i)
+      patternsIni += Fixtures::ToPatternsIni(kSubscriptionUrl + "?" + std::to_string(i), filters, 0);
+    auto file = *AdblockPlus::TokenizeFile(ToBuffer(patternsIni), "", 1);
+    unsigned threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned threads : {1u, threadCount})
+    {
+      file.keywords.clear();
+      Stopwatch stopwatch;
+      AdblockPlus::FindFilterKeywords(file, threads);
+      report.Add("filterKeywords", threads == 1 ? "singleThreadUs" : "allThreadsUs",
+        stopwatch.ElapsedMicroseconds());
+    }
+    report.Add("filterKeywords", "threads", threadCount);
+  }
+
+  void BenchmarkMatches(Report& report, AdblockPlus::FilterEngine& filterEngine,
+    const std::vector<BenchmarkRequest>& requests)
+  {
+    std::vector<double> samples;
+    samples.reserve(requests.size());
+    size_t blocked = 0;
+    Stopwatch total;
+    for (const auto& request : requests)
+    {
+      Stopwatch stopwatch;
+      auto match = filterEngine.Matches(request.url, request.contentType, request.documentUrl);
+      samples.push_back(stopwatch.ElapsedMicroseconds());
+      if (match && match->GetType() == AdblockPlus::Filter::TYPE_BLOCKING)
+        ++blocked;
+    }
+    double totalUs = total.ElapsedMicroseconds();
+    report.Add("matches", "requestsPerSecond", requests.size() / totalUs * 1e6);
+    report.Add("matches", "blocked", static_cast<double>(blocked));
+    report.AddLatencies("matches", samples);
+  }
+
+  void BenchmarkElementHidingSelectors(Report& report, AdblockPlus::FilterEngine& filterEngine,
+    const std::vector<std::string>& domains)
+  {
+    std::vector<double> samples;
+    samples.reserve(domains.size());
+    size_t selectors = 0;
+    for (const auto& domain : domains)
+    {
+      Stopwatch stopwatch;
+      selectors += filterEngine.GetElementHidingSelectors(domain).size();
+      samples.push_back(stopwatch.ElapsedMicroseconds());
+    }
+    if (!domains.empty())
+      report.Add("elementHidingSelectors", "meanSelectors", static_cast<double>(selectors) / domains.size());
+    report.AddLatencies("elementHidingSelectors", samples);
+  }
+
+  void BenchmarkJsValuesRoundTrip(Report& report, AdblockPlus::JsEngine& jsEngine)
+  {
+    const size_t operations = 10000;
+    AdblockPlus::JsValueList values;
+    values.push_back(jsEngine.NewValue("value"));
+    values.push_back(jsEngine.NewValue(42));
+    size_t allocationsBefore = GetAllocationCount();
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < operations; ++i)
+      jsEngine.TakeJsValues(jsEngine.StoreJsValues(values));
+    double totalUs = stopwatch.ElapsedMicroseconds();
+    report.Add("jsValuesRoundTrip", "nsPerOperation", totalUs * 1000 / operations);
+    report.Add("jsValuesRoundTrip", "allocationsPerOperation",
+      static_cast<double>(GetAllocationCount() - allocationsBefore) / operations);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    Options options = ParseOptions(argc, argv);
+    Report report;
+    report.Add("parameters", "filters", static_cast<double>(options.filters));
+    report.Add("parameters", "requests", static_cast<double>(options.requests));
+    report.Add("parameters", "domains", static_cast<double>(options.domains));
+    report.Add("parameters", "iterations", static_cast<double>(options.iterations));
+
+    auto filters = Fixtures::GenerateFilters(options.filters);
+    auto filterList = Fixtures::ToFilterList(filters);
+    auto patternsIni = Fixtures::ToPatternsIni(kSubscriptionUrl, filters, std::time(nullptr));
+    auto requests = Fixtures::GenerateRequests(options.requests);
+    auto domains = Fixtures::GenerateDomains(options.domains);
+    if (!options.fixturesDirectory.empty())
+      WriteFixtures(options.fixturesDirectory, filterList, patternsIni, requests);
+
+    BenchmarkEngineCreation(report, "engineCreationEmpty",
+      FixtureFileSystem::Files(), options.iterations);
+    FixtureFileSystem::Files files;
+    files["patterns.ini"] = ToBuffer(patternsIni);
+    auto platform = BenchmarkEngineCreation(report, "engineCreationWithPatterns",
+      files, options.iterations);
+
+    auto& filterEngine = platform->GetFilterEngine();
+    BenchmarkMatches(report, filterEngine, requests);
+    BenchmarkElementHidingSelectors(report, filterEngine, domains);
+    BenchmarkJsValuesRoundTrip(report, platform->GetJsEngine());
+    platform.reset();
+
+    BenchmarkSubscriptionParse(report, filterList);
+    BenchmarkFilterKeywords(report, filters);
+    report.Add("process", "peakRssKB", static_cast<double>(GetPeakRssKB()));
+
+    std::string json = report.ToJson();
+    if (options.output.empty())
+      std::cout << json;
+    else
+      WriteFile(options.output, json);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Exception: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
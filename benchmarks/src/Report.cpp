@@ -0,0 +1,117 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Report.h"
+
+namespace
+{
+  double Percentile(const std::vector<double>& sortedSamples, double percentile)
+  {
+    size_t index = static_cast<size_t>(percentile / 100 * (sortedSamples.size() - 1) + 0.5);
+    return sortedSamples[index];
+  }
+
+  std::string EscapeJson(const std::string& value)
+  {
+    std::string result;
+    for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+    return result;
+  }
+}
+
+void Report::Add(const std::string& benchmark, const std::string& metric, double value)
+{
+  auto it = std::find_if(benchmarks.begin(), benchmarks.end(),
+    [&benchmark](const std::pair<std::string, Metrics>& item)
+    {
+      return item.first == benchmark;
+    });
+  if (it == benchmarks.end())
+    it = benchmarks.insert(benchmarks.end(), std::make_pair(benchmark, Metrics()));
+  it->second.emplace_back(metric, value);
+}
+
+void Report::AddLatencies(const std::string& benchmark, std::vector<double>& samples)
+{
+  Add(benchmark, "count", static_cast<double>(samples.size()));
+  if (samples.empty())
+    return;
+  std::sort(samples.begin(), samples.end());
+  double total = std::accumulate(samples.begin(), samples.end(), 0.0);
+  Add(benchmark, "meanUs", total / samples.size());
+  Add(benchmark, "p50Us", Percentile(samples, 50));
+  Add(benchmark, "p90Us", Percentile(samples, 90));
+  Add(benchmark, "p99Us", Percentile(samples, 99));
+  Add(benchmark, "maxUs", samples.back());
+}
+
+std::string Report::ToJson() const
+{
+  std::ostringstream json;
+  json << std::setprecision(6) << std::fixed << "{\n";
+  for (size_t i = 0; i < benchmarks.size(); ++i)
+  {
+    json << "  \"" << EscapeJson(benchmarks[i].first) << "\": {";
+    const Metrics& metrics = benchmarks[i].second;
+    for (size_t j = 0; j < metrics.size(); ++j)
+    {
+      json << (j ? ", " : "") << "\"" << EscapeJson(metrics[j].first) << "\": "
+           << metrics[j].second;
+    }
+    json << "}" << (i + 1 < benchmarks.size() ? "," : "") << "\n";
+  }
+  json << "}\n";
+  return json.str();
+}
+
+size_t GetPeakRssKB()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#ifdef __APPLE__
+  // bytes on macOS, kilobytes elsewhere
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
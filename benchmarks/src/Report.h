@@ -0,0 +1,76 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Collects benchmark metrics and formats them as JSON, the metrics keep the
+ * order in which they have been added.
+ */
+class Report
+{
+public:
+  void Add(const std::string& benchmark, const std::string& metric, double value);
+
+  /**
+   * Adds count, mean, percentiles and maximum of the samples.
+   * @param samples Durations in microseconds, they get sorted.
+   */
+  void AddLatencies(const std::string& benchmark, std::vector<double>& samples);
+
+  std::string ToJson() const;
+
+private:
+  typedef std::vector<std::pair<std::string, double>> Metrics;
+  std::vector<std::pair<std::string, Metrics>> benchmarks;
+};
+
+class Stopwatch
+{
+public:
+  Stopwatch()
+    : start(std::chrono::steady_clock::now())
+  {
+  }
+
+  double ElapsedMicroseconds() const
+  {
+    return std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Returns the peak resident set size of the process in kilobytes.
+ */
+size_t GetPeakRssKB();
+
+/**
+ * Returns the number of memory allocations done by the process so far.
+ */
+size_t GetAllocationCount();
+
+#endif
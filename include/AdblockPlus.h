@@ -31,6 +31,7 @@
 #define ADBLOCK_PLUS_ADBLOCK_PLUS_H
 
 #include <AdblockPlus/AppInfo.h>
+#include <AdblockPlus/DefaultMetrics.h>
 #include <AdblockPlus/FilterEngine.h>
 #include <AdblockPlus/LogSystem.h>
 #include <AdblockPlus/JsEngine.h>
@@ -0,0 +1,113 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_DEFAULT_METRICS_H
+#define ADBLOCK_PLUS_DEFAULT_METRICS_H
+
+#include <atomic>
+#include "IMetrics.h"
+
+namespace AdblockPlus
+{
+  /**
+   * Lock-free latency histogram with a bounded relative error.
+   * Values below 16 microseconds are counted exactly, larger ones fall into
+   * one of 16 linear sub-buckets of their power of two, so a percentile is
+   * reported with an error of at most 1/16 of its value.
+   */
+  class LatencyHistogram
+  {
+  public:
+    LatencyHistogram();
+
+    void Record(std::chrono::microseconds value);
+
+    /**
+     * @return Number of recorded samples.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * @return Largest recorded sample.
+     */
+    std::chrono::microseconds GetMax() const;
+
+    /**
+     * Retrieves the value below which the given percentage of samples fall.
+     * @param percentile Percentage in the range [0, 100].
+     * @return The upper bound of the bucket containing the percentile, or 0
+     *         if there are no samples.
+     */
+    std::chrono::microseconds GetPercentile(double percentile) const;
+
+    /**
+     * Removes all samples. Samples recorded concurrently may be partially
+     * lost.
+     */
+    void Reset();
+
+  private:
+    static const int SUB_BUCKET_COUNT = 16;
+    static const int BUCKET_COUNT = SUB_BUCKET_COUNT * 61;
+
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    static int GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(int index);
+
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> max;
+  };
+
+  /**
+   * `IMetrics` implementation aggregating the counters and latencies in
+   * memory, it can be polled at any time from any thread.
+   */
+  class DefaultMetrics : public IMetrics
+  {
+  public:
+    DefaultMetrics();
+
+    void Increment(Counter counter, uint64_t value) override;
+    void Record(Histogram histogram, std::chrono::microseconds value) override;
+
+    /**
+     * @param counter Counter to retrieve.
+     * @return Current value of the counter.
+     */
+    uint64_t GetCounter(Counter counter) const;
+
+    /**
+     * @param histogram Histogram to retrieve.
+     * @return Histogram, it is being updated while the metrics are in use.
+     */
+    const LatencyHistogram& GetHistogram(Histogram histogram) const;
+
+    /**
+     * Resets all counters and histograms.
+     */
+    void Reset();
+
+  private:
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    LatencyHistogram histograms[HISTOGRAM_COUNT];
+  };
+}
+
+#endif
@@ -18,8 +18,12 @@
 #ifndef ADBLOCK_PLUS_FILTER_ENGINE_H
 #define ADBLOCK_PLUS_FILTER_ENGINE_H
 
+#include <chrono>
 #include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <AdblockPlus/JsEngine.h>
@@ -29,6 +33,9 @@
 namespace AdblockPlus
 {
   class FilterEngine;
+  class StartupTimelineRecorder;
+  class UpdateCheckCallbacks;
+  struct WarmCache;
   typedef std::shared_ptr<FilterEngine> FilterEnginePtr;
 
   /**
@@ -182,6 +189,132 @@ namespace AdblockPlus
    */
   typedef std::unique_ptr<Filter> FilterPtr;
 
+  /**
+   * Element hiding selectors of a domain in a single buffer, see
+   * `FilterEngine::GetElementHidingStyleSheet()`.
+   */
+  struct ElementHidingStyleSheet
+  {
+    ElementHidingStyleSheet()
+      : filterGeneration(0)
+    {
+    }
+    /**
+     * Generation of the filters the selectors are computed for, see
+     * `FilterEngine::GetFilterGeneration()`.
+     */
+    uint64_t filterGeneration;
+    /**
+     * Selectors separated by ",\n", so that the CSS rule hiding all of them
+     * is `selectors + " {display: none !important;}"`. Selectors never
+     * contain a line break.
+     */
+    std::string selectors;
+    /**
+     * Offsets of the selectors in `selectors`.
+     */
+    std::vector<size_t> offsets;
+
+    size_t GetSelectorCount() const
+    {
+      return offsets.size();
+    }
+
+    /**
+     * @return Length of the selector at `index`, excluding the separator.
+     */
+    size_t GetSelectorLength(size_t index) const
+    {
+      size_t end = index + 1 < offsets.size() ? offsets[index + 1] - 2 : selectors.size();
+      return end - offsets[index];
+    }
+  };
+
+  /**
+   * Shared immutable `ElementHidingStyleSheet`.
+   */
+  typedef std::shared_ptr<const ElementHidingStyleSheet> ElementHidingStyleSheetPtr;
+
+  /**
+   * CSS rules hiding the selectors of an `ElementHidingStyleSheet` in groups
+   * in a single buffer, see `FilterEngine::GetElementHidingRules()`.
+   * Each rule has the form `"sel1, sel2 {display: none !important;}"`, so an
+   * invalid selector discards only the rule of its group.
+   */
+  struct ElementHidingRules
+  {
+    ElementHidingRules()
+      : filterGeneration(0), groupSize(0)
+    {
+    }
+    /**
+     * Generation of the filters the rules are computed for.
+     */
+    uint64_t filterGeneration;
+    /**
+     * Maximal number of selectors in a rule.
+     */
+    size_t groupSize;
+    /**
+     * Rules each of which is followed by a line break.
+     */
+    std::string rules;
+    /**
+     * Offsets of the rules in `rules`.
+     */
+    std::vector<size_t> offsets;
+
+    size_t GetRuleCount() const
+    {
+      return offsets.size();
+    }
+
+    /**
+     * @return Length of the rule at `index`, excluding the line break.
+     */
+    size_t GetRuleLength(size_t index) const
+    {
+      size_t end = index + 1 < offsets.size() ? offsets[index + 1] : rules.size();
+      return end - 1 - offsets[index];
+    }
+  };
+
+  /**
+   * Shared immutable `ElementHidingRules`.
+   */
+  typedef std::shared_ptr<const ElementHidingRules> ElementHidingRulesPtr;
+
+  /**
+   * Element hiding emulation selector together with the text of its filter.
+   */
+  struct ElementHidingEmulationSelector
+  {
+    std::string selector;
+    std::string text;
+  };
+
+  /**
+   * Element hiding emulation selectors of a domain, see
+   * `FilterEngine::GetElementHidingEmulationSelectors()`.
+   */
+  struct ElementHidingEmulationSelectors
+  {
+    ElementHidingEmulationSelectors()
+      : filterGeneration(0)
+    {
+    }
+    /**
+     * Generation of the filters the selectors are computed for.
+     */
+    uint64_t filterGeneration;
+    std::vector<ElementHidingEmulationSelector> selectors;
+  };
+
+  /**
+   * Shared immutable `ElementHidingEmulationSelectors`.
+   */
+  typedef std::shared_ptr<const ElementHidingEmulationSelectors> ElementHidingEmulationSelectorsPtr;
+
   /**
    * Main component of libadblockplus.
    * It handles:
@@ -189,7 +322,7 @@ namespace AdblockPlus
    * - Subscription management and synchronization.
    * - Update checks for the application.
    */
-  class FilterEngine
+  class FilterEngine : public std::enable_shared_from_this<FilterEngine>
   {
   public:
     // Make sure to keep ContentType in sync with FilterEngine::contentTypes
@@ -246,6 +379,72 @@ namespace AdblockPlus
      */
     typedef std::function<void(const std::string&, JsValue&&)> FilterChangeCallback;
 
+    /**
+     * Summary of the filter changes of one subscription which happened during
+     * the coalescing window, see `SetFilterChangeBatchCallback()`.
+     */
+    struct FilterChangeBatch
+    {
+      FilterChangeBatch()
+        : filtersAdded(0), filtersRemoved(0)
+      {
+      }
+      /**
+       * URL of the affected subscription, empty for changes which are not
+       * related to any subscription, like "load" or "save".
+       */
+      std::string subscriptionUrl;
+      /**
+       * Distinct action event codes in the order of their first occurrence.
+       */
+      std::vector<std::string> actions;
+      /**
+       * Number of filters added to the subscription.
+       */
+      int filtersAdded;
+      /**
+       * Number of filters removed from the subscription.
+       */
+      int filtersRemoved;
+      /**
+       * Texts of the added filters, filled only if
+       * `FilterChangeBatchOptions::includeFilterTexts` is set.
+       */
+      std::vector<std::string> addedFilters;
+      /**
+       * Texts of the removed filters, filled only if
+       * `FilterChangeBatchOptions::includeFilterTexts` is set.
+       */
+      std::vector<std::string> removedFilters;
+    };
+
+    /**
+     * Callback type invoked with the coalesced filter changes, one item per
+     * affected subscription.
+     */
+    typedef std::function<void(const std::vector<FilterChangeBatch>&)> FilterChangeBatchCallback;
+
+    /**
+     * Options of batched filter change notifications.
+     */
+    struct FilterChangeBatchOptions
+    {
+      FilterChangeBatchOptions()
+        : window(0), includeFilterTexts(false)
+      {
+      }
+      /**
+       * Coalescing window, changes are collected starting from the first one
+       * until the window elapses. The default zero window merges the changes
+       * made by one operation, e.g. by a subscription update.
+       */
+      std::chrono::milliseconds window;
+      /**
+       * Whether to report the texts of the added and removed filters.
+       */
+      bool includeFilterTexts;
+    };
+
     /**
      * Container of name-value pairs representing a set of preferences.
      */
@@ -264,11 +463,180 @@ namespace AdblockPlus
      */
     typedef std::function<void(const std::string* allowedConnectionType, const std::function<void(bool)>&)> IsConnectionAllowedAsyncCallback;
 
+    /**
+     * Information about a memory pressure notification sent to the JS engine.
+     */
+    struct MemoryPressureReport
+    {
+      /**
+       * Time spent in the notification, it includes the garbage collection
+       * performed synchronously by the engine.
+       */
+      std::chrono::microseconds gcPause;
+      /**
+       * Used JS heap size in bytes before the notification.
+       */
+      size_t usedHeapSizeBefore;
+      /**
+       * Used JS heap size in bytes after the notification.
+       */
+      size_t usedHeapSizeAfter;
+    };
+
+    /**
+     * Everything needed to set up filtering of a page, see `GetPageSetup()`.
+     */
+    struct PageSetup
+    {
+      PageSetup()
+        : documentWhitelisted(false), elemhideWhitelisted(false)
+        , genericHide(false), genericBlock(false)
+      {
+      }
+      /**
+       * Whether the page is whitelisted, see `IsDocumentWhitelisted()`.
+       */
+      bool documentWhitelisted;
+      /**
+       * Whether element hiding is disabled on the page, see
+       * `IsElemhideWhitelisted()`.
+       */
+      bool elemhideWhitelisted;
+      /**
+       * Whether generic element hiding filters are disabled on the page by
+       * a `$generichide` exception.
+       */
+      bool genericHide;
+      /**
+       * Whether generic blocking filters are disabled on the page by a
+       * `$genericblock` exception.
+       */
+      bool genericBlock;
+      /**
+       * Host of the page.
+       */
+      std::string domain;
+      /**
+       * Result of `GetGenericElementHidingStyleSheet()`, `null` if element
+       * hiding or generic element hiding is disabled on the page.
+       */
+      ElementHidingStyleSheetPtr genericElementHidingStyleSheet;
+      /**
+       * Result of `GetElementHidingStyleSheetDelta()` for the domain, only
+       * with the domain specific selectors if `genericHide` is set. It is
+       * `null` if element hiding is disabled on the page.
+       */
+      ElementHidingStyleSheetPtr elementHidingStyleSheetDelta;
+    };
+
+    /**
+     * Callback type invoked after each memory pressure notification.
+     */
+    typedef std::function<void(const MemoryPressureReport&)> MemoryPressureReportCallback;
+
+    /**
+     * Policy deciding when the JS engine is notified about memory pressure
+     * after the filters have been saved.
+     */
+    struct MemoryPressurePolicy
+    {
+      enum Mode
+      {
+        /// The engine is never notified.
+        MODE_NEVER,
+        /// The engine is notified after each save.
+        MODE_ON_SAVE,
+        /// The engine is notified after a save if the used heap size
+        /// reaches `heapThreshold`.
+        MODE_HEAP_THRESHOLD
+      };
+
+      enum Level
+      {
+        /// The engine may collect garbage incrementally.
+        LEVEL_MODERATE,
+        /// The engine performs a full garbage collection immediately.
+        LEVEL_CRITICAL
+      };
+
+      MemoryPressurePolicy()
+        : mode(MODE_ON_SAVE), level(LEVEL_CRITICAL), heapThreshold(0)
+      {
+      }
+
+      Mode mode;
+      Level level;
+      /**
+       * Used JS heap size in bytes, considered only in `MODE_HEAP_THRESHOLD`.
+       */
+      size_t heapThreshold;
+      /**
+       * Optional callback receiving a report of each notification.
+       */
+      MemoryPressureReportCallback reportCallback;
+    };
+
+    /**
+     * A phase of the filter engine startup.
+     */
+    struct StartupPhase
+    {
+      /**
+       * Name of the phase, e.g. `jsEngine.isolate`, `evaluate filterStorage.js`
+       * or `read patterns.ini`.
+       */
+      std::string name;
+      /**
+       * Start of the phase relative to the beginning of the JS engine
+       * creation.
+       */
+      std::chrono::microseconds start;
+      /**
+       * Duration of the phase. Phases may overlap, e.g. the reading of files
+       * continues while the following scripts are being evaluated.
+       */
+      std::chrono::microseconds duration;
+    };
+
+    /**
+     * Startup phases ordered by their start.
+     */
+    typedef std::vector<StartupPhase> StartupTimeline;
+
+    /**
+     * Loading state of the subscriptions, see `GetStartupProgress()`.
+     */
+    struct StartupProgress
+    {
+      StartupProgress()
+        : isComplete(false)
+      {
+      }
+      /**
+       * `true` if all subscriptions are loaded.
+       */
+      bool isComplete;
+      /**
+       * URLs of the enabled subscriptions which filters are active.
+       */
+      std::vector<std::string> liveSubscriptions;
+    };
+
+    /**
+     * Callback type invoked when a subscription becomes active during the
+     * startup and when all of them are loaded.
+     */
+    typedef std::function<void(const StartupProgress&)> StartupProgressCallback;
+
     /**
      * FilterEngine creation parameters.
      */
     struct CreationParameters
     {
+      CreationParameters()
+        : progressiveStartup(false)
+      {
+      }
       /**
        * `AdblockPlus::FilterEngine::Prefs` name - value list of preconfigured
        * prefs.
@@ -280,6 +648,40 @@ namespace AdblockPlus
        * on the current connection.
        */
       IsConnectionAllowedAsyncCallback isSubscriptionDownloadAllowedCallback;
+      /**
+       * Memory pressure handling after saving the filters, by default the
+       * JS engine is notified about critical memory pressure after each save.
+       */
+      MemoryPressurePolicy memoryPressurePolicy;
+      /**
+       * Name of the file keeping the warm cache, see `SaveWarmCache()`.
+       * Empty by default, which disables the warm cache.
+       */
+      std::string warmCacheFileName;
+      /**
+       * If `true` the engine is passed to the `OnCreatedCallback` as soon as
+       * the custom filters and the acceptable ads subscription are active,
+       * the other subscriptions become active one by one while they are
+       * being loaded, see `GetStartupProgress()`. In order to load them
+       * first, they are saved before the other subscriptions. A patterns.ini
+       * saved without this option is only passed on once it is loaded.
+       * patterns.ini is parsed in slices of
+       * `JsEngine::GetFileParsingSliceDuration()`, if none is set a
+       * duration of 5 ms is set for the `JsEngine`. The engine is passed to
+       * the `OnCreatedCallback` by a timer task between two slices.
+       * Until the loading is complete, see `StartupProgress::isComplete`:
+       * - `Matches()`, the element hiding functions, `GetPref()` and
+       *   `SetPref()` can be used as usual, the filters of the active
+       *   subscriptions are applied.
+       * - `GetListedFilters()`, `GetListedSubscriptions()` and
+       *   `IsAASubscriptionEnabled()` only know the loaded subscriptions.
+       * - Adding or removing filters and subscriptions, enabling or
+       *   disabling subscriptions and updating them is applied when the
+       *   loading is complete, otherwise the loaded data would replace
+       *   these changes.
+       * `IsFirstRun()` is only valid when the loading is complete.
+       */
+      bool progressiveStartup;
     };
 
     /**
@@ -299,6 +701,8 @@ namespace AdblockPlus
       const OnCreatedCallback& onCreated,
       const CreationParameters& parameters = CreationParameters());
 
+    ~FilterEngine();
+
     /**
      * Retrieves the `JsEngine` instance associated with this `FilterEngine`
      * instance.
@@ -412,6 +816,8 @@ namespace AdblockPlus
      *        If the application is not capable of identifying the frame
      *        structure, e.g. because it is a proxy, it can be approximated
      *        using `ReferrerMapping`.
+     *        The decisions of recent calls are cached until the filters
+     *        change.
      * @return Matching filter, or a `null` if there was no match.
      * @throw `std::invalid_argument`, if an invalid `contentType` was supplied.
      */
@@ -419,6 +825,25 @@ namespace AdblockPlus
         ContentTypeMask contentTypeMask,
         const std::vector<std::string>& documentUrls) const;
 
+    /**
+     * Asynchronous version of
+     * Matches(const std::string&, ContentTypeMask, const std::vector<std::string>&) const.
+     * If the JS thread of the engine is started, see
+     * `JsEngine::StartJsThread()`, the matching is performed on that thread
+     * and the calling thread is never blocked. Otherwise it is performed by
+     * `Platform::Poll()` of an embedder-driven platform, or immediately for
+     * other platforms.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrls Chain of documents requesting the resource.
+     * @return Future of the matching filter, or of `null` if there was no
+     *         match. It holds the exception thrown by the matching, or an
+     *         exception if the filter engine is destroyed before.
+     */
+    std::future<FilterPtr> MatchesAsync(const std::string& url,
+        ContentTypeMask contentTypeMask,
+        const std::vector<std::string>& documentUrls) const;
+
     /**
      * Checks whether the document at the supplied URL is whitelisted.
      * @param url URL of the document.
@@ -433,6 +858,20 @@ namespace AdblockPlus
     bool IsDocumentWhitelisted(const std::string& url,
         const std::vector<std::string>& documentUrls) const;
 
+    /**
+     * Retrieves the whitelisting state and the element hiding selectors of
+     * a page at once. The frames are walked once for all kinds of
+     * whitelisting, in a single call into the JS engine, and the selectors
+     * are taken from the cache when possible.
+     * @param url URL of the page.
+     * @param documentUrls Chain of document URLs requesting the page,
+     *        starting with the current document's parent frame, ending with
+     *        the top-level frame.
+     * @return Whitelisting state and selectors of the page.
+     */
+    PageSetup GetPageSetup(const std::string& url,
+        const std::vector<std::string>& documentUrls) const;
+
     /**
      * Checks whether element hiding is disabled at the supplied URL.
      * @param url URL of the document.
@@ -455,6 +894,126 @@ namespace AdblockPlus
      */
     std::vector<std::string> GetElementHidingSelectors(const std::string& domain) const;
 
+    /**
+     * Retrieves CSS selectors for all element hiding filters active on the
+     * supplied domain in a single buffer. The results are cached per
+     * domain until the filters change, see `SetElementHidingCacheSize()`,
+     * so the same buffer is returned for repeated calls.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @return Selectors, never `null`.
+     */
+    ElementHidingStyleSheetPtr GetElementHidingStyleSheet(const std::string& domain) const;
+
+    /**
+     * Retrieves the CSS selectors of the generic element hiding filters
+     * which apply to every domain, i.e. which have neither domain
+     * restrictions nor exceptions. Together with
+     * `GetElementHidingStyleSheetDelta()` they are the selectors of
+     * `GetElementHidingStyleSheet()`, so the embedder can inject this
+     * style sheet once and reuse it until `filterGeneration`, its version,
+     * changes.
+     * @return Selectors, never `null`.
+     */
+    ElementHidingStyleSheetPtr GetGenericElementHidingStyleSheet() const;
+
+    /**
+     * Retrieves the CSS selectors active on the supplied domain except for
+     * those of `GetGenericElementHidingStyleSheet()`, i.e. the domain
+     * specific selectors and the generic ones which have exceptions or
+     * domain restrictions. The results are cached like those of
+     * `GetElementHidingStyleSheet()`.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @param specificOnly Whether to retrieve only the domain specific
+     *        selectors, e.g. because generic element hiding filters are
+     *        disabled on the domain by a `$generichide` exception. The
+     *        generic style sheet should not be injected then.
+     * @return Selectors, never `null`.
+     */
+    ElementHidingStyleSheetPtr GetElementHidingStyleSheetDelta(const std::string& domain,
+      bool specificOnly = false) const;
+
+    /**
+     * Retrieves the selectors of `GetElementHidingStyleSheet()` formatted as
+     * CSS rules of up to `groupSize` selectors. The rules are cached
+     * together with the selectors.
+     * @param domain Domain to retrieve the rules for.
+     * @param groupSize Maximal number of selectors in a rule, 0 puts all
+     *        selectors into a single rule.
+     * @return Rules, never `null`.
+     */
+    ElementHidingRulesPtr GetElementHidingRules(const std::string& domain,
+      size_t groupSize) const;
+
+    /**
+     * Retrieves the selectors of `GetGenericElementHidingStyleSheet()`
+     * formatted as CSS rules, see `GetElementHidingRules()`.
+     */
+    ElementHidingRulesPtr GetGenericElementHidingRules(size_t groupSize) const;
+
+    /**
+     * Retrieves the selectors of `GetElementHidingStyleSheetDelta()`
+     * formatted as CSS rules, see `GetElementHidingRules()`.
+     */
+    ElementHidingRulesPtr GetElementHidingRulesDelta(const std::string& domain,
+      size_t groupSize, bool specificOnly = false) const;
+
+    /**
+     * Retrieves the element hiding emulation selectors applying to a domain
+     * together with the texts of their filters. The result is cached and
+     * invalidated like the one of `GetElementHidingStyleSheet()`.
+     * @param domain Domain to retrieve the selectors for.
+     * @return Emulation selectors, never `null`.
+     */
+    ElementHidingEmulationSelectorsPtr GetElementHidingEmulationSelectors(const std::string& domain) const;
+
+    /**
+     * Sets the maximal size of the cache of element hiding selectors in
+     * bytes, the least recently used domains are evicted when it is
+     * exceeded. The default is 8 MiB, 0 disables the cache.
+     * @param size Maximal size in bytes.
+     */
+    void SetElementHidingCacheSize(size_t size);
+
+    /**
+     * Retrieves the generation of the filters, it is increased whenever the
+     * active filters can change, e.g. when filters are loaded, a filter or
+     * a subscription is added, removed or disabled, or a subscription is
+     * updated.
+     * @return Current generation.
+     */
+    uint64_t GetFilterGeneration() const;
+
+    /**
+     * Callback type invoked when `SaveWarmCache()` is done.
+     * @param error An error string, empty on success.
+     */
+    typedef std::function<void(const std::string& error)> SaveWarmCacheCallback;
+
+    /**
+     * Writes the element hiding results of the recently visited domains and
+     * the recent decisions of `Matches()` to
+     * `CreationParameters::warmCacheFileName` via `IFileSystem`.
+     * They are tagged with a hash of the filters as they are saved to
+     * patterns.ini. On the next start the warm cache is read in parallel
+     * with patterns.ini and it is used before the filters are parsed, so
+     * the first pages are served from warm caches. It is discarded if
+     * patterns.ini or the application version differ, and it is not used
+     * anymore once the filters change. Applications call it e.g. when they
+     * are sent to the background or before they exit.
+     * @param callback Called when the file is written.
+     */
+    void SaveWarmCache(const SaveWarmCacheCallback& callback = SaveWarmCacheCallback()) const;
+
+    /**
+     * Asynchronous version of `GetElementHidingSelectors()`, it is performed
+     * in the same way as `MatchesAsync()`.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @return Future of the list of CSS selectors, like the one of
+     *         `MatchesAsync()` it holds an exception on failure.
+     */
+    std::future<std::vector<std::string>> GetElementHidingSelectorsAsync(
+        const std::string& domain) const;
+
     /**
      * Retrieves a preference value.
      * @param pref Preference name.
@@ -513,6 +1072,23 @@ namespace AdblockPlus
      */
     void RemoveFilterChangeCallback();
 
+    /**
+     * Sets the callback invoked with summarized filter changes. Unlike
+     * `SetFilterChangeCallback()` the changes are coalesced, so e.g. a
+     * subscription update results in a single call with the numbers of
+     * added and removed filters instead of a call per filter.
+     * Both callbacks can be used simultaneously.
+     * @param callback Callback to invoke.
+     * @param options Coalescing options.
+     */
+    void SetFilterChangeBatchCallback(const FilterChangeBatchCallback& callback,
+      const FilterChangeBatchOptions& options = FilterChangeBatchOptions());
+
+    /**
+     * Removes the callback invoked with summarized filter changes.
+     */
+    void RemoveFilterChangeBatchCallback();
+
     /**
      * Stores the value indicating what connection types are allowed, it is
      * passed to CreateParameters::isConnectionAllowed callback.
@@ -555,18 +1131,80 @@ namespace AdblockPlus
      */
     static std::string ContentTypeToString(ContentType contentType);
 
+    /**
+     * Retrieves the phases of the filter engine startup: the creation of the
+     * isolate (including the initialization of V8 if it is the first
+     * isolate), the setup of the context, the evaluation of each script,
+     * the reading of `prefs.json` and `patterns.ini`, the loading of the
+     * filters (`filters.load`) and the whole time until the engine is
+     * initialized (`filterEngine.init`).
+     * The timeline is complete when the engine is passed to the
+     * `OnCreatedCallback` unless `CreationParameters::progressiveStartup` is
+     * set, then it is complete when the loading of the filters is.
+     * @return Startup phases.
+     */
+    StartupTimeline GetStartupTimeline() const;
+
+    /**
+     * Retrieves the startup timeline in the
+     * [trace event format](https://github.com/catapult-project/catapult/blob/master/tracing/README.md),
+     * it can be loaded e.g. into `chrome://tracing`.
+     * @return JSON string.
+     */
+    std::string GetStartupTimelineTraceJson() const;
+
+    /**
+     * Retrieves which subscriptions are active, it is only interesting with
+     * `CreationParameters::progressiveStartup`, otherwise all enabled
+     * subscriptions are active once the engine is created.
+     * @return Current loading state.
+     */
+    StartupProgress GetStartupProgress() const;
+
+    /**
+     * Sets the callback invoked when the loading state changes during the
+     * startup.
+     * @param callback Callback to invoke.
+     */
+    void SetStartupProgressCallback(const StartupProgressCallback& callback);
+
+    /**
+     * Removes the callback set via `SetStartupProgressCallback()`.
+     */
+    void RemoveStartupProgressCallback();
+
   private:
     JsEnginePtr jsEngine;
     bool firstRun;
-    int updateCheckId;
+    std::shared_ptr<UpdateCheckCallbacks> updateCheckCallbacks;
+    std::shared_ptr<StartupTimelineRecorder> startupTimeline;
+    struct CacheState;
+    std::shared_ptr<CacheState> cacheState;
+    std::string warmCacheFileName;
     static const std::map<ContentType, std::string> contentTypes;
 
     explicit FilterEngine(const JsEnginePtr& jsEngine);
 
+    FilterPtr MatchesImpl(const std::string& url,
+                          ContentTypeMask contentTypeMask,
+                          const std::vector<std::string>& documentUrls) const;
     FilterPtr CheckFilterMatch(const std::string& url,
                                ContentTypeMask contentTypeMask,
                                const std::string& documentUrl) const;
+    // kind is ElementHidingCache::Kind
+    ElementHidingStyleSheetPtr GetCachedStyleSheet(int kind, const std::string& domain) const;
+    ElementHidingRulesPtr GetCachedRules(int kind, const std::string& domain, size_t groupSize) const;
+    // Requires the JS engine to be locked.
+    std::string GetFilterStateHash() const;
+    void ApplyWarmCache(const WarmCache& warmCache);
+    // Take the result from the applied warm cache and add it to the cache
+    // of the filter generation.
+    bool GetWarmMatchDecision(const std::string& key, uint64_t generation,
+                              std::string& filterText) const;
+    ElementHidingStyleSheetPtr GetWarmStyleSheet(int kind, const std::string& domain,
+                                                 uint64_t generation) const;
     void FilterChanged(const FilterChangeCallback& callback, JsValueList&& params) const;
+    void FilterChangeBatchReady(const FilterChangeBatchCallback& callback, JsValueList&& params) const;
     FilterPtr GetWhitelistingFilter(const std::string& url,
       ContentTypeMask contentTypeMask, const std::string& documentUrl) const;
     FilterPtr GetWhitelistingFilter(const std::string& url,
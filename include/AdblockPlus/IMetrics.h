@@ -0,0 +1,114 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_METRICS_H
+#define ADBLOCK_PLUS_METRICS_H
+
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Sink of counters and latency samples collected on the hot paths of the
+   * library.
+   * The methods are called concurrently from arbitrary threads, including
+   * threads holding the lock of the JS engine, so implementations have to
+   * be thread-safe and must neither block nor call back into the library.
+   */
+  struct IMetrics
+  {
+    enum Counter
+    {
+      /// Calls of `FilterEngine::Matches()`.
+      COUNTER_MATCHES,
+      /// Calls of `FilterEngine::Matches()` which have found a blocking
+      /// filter.
+      COUNTER_MATCHES_BLOCKED,
+      /// Acquisitions of the lock of the JS engine.
+      COUNTER_JS_CONTEXT_ACQUISITIONS,
+      /// Web requests performed by the default web request implementation.
+      COUNTER_WEB_REQUESTS,
+      /// Web requests which have failed or have a status other than 200.
+      COUNTER_WEB_REQUEST_FAILURES,
+      /// Files read by the default file system implementation.
+      COUNTER_FILE_READS,
+      /// Bytes read by the default file system implementation.
+      COUNTER_FILE_BYTES_READ,
+      /// Files written by the default file system implementation.
+      COUNTER_FILE_WRITES,
+      /// Bytes written by the default file system implementation.
+      COUNTER_FILE_BYTES_WRITTEN,
+      /// Failed operations of the default file system implementation.
+      COUNTER_FILE_ERRORS,
+      /// Calls of `FilterEngine::GetElementHidingStyleSheet()` answered
+      /// from the cache.
+      COUNTER_ELEMHIDE_CACHE_HITS,
+      /// Calls of `FilterEngine::GetElementHidingStyleSheet()` computing the
+      /// selectors.
+      COUNTER_ELEMHIDE_CACHE_MISSES,
+      /// Calls of `FilterEngine::Matches()` answered from the cache, it is
+      /// only used along with the warm cache.
+      COUNTER_MATCH_CACHE_HITS,
+      /// Calls of `FilterEngine::Matches()` matching the URL despite the
+      /// cache.
+      COUNTER_MATCH_CACHE_MISSES,
+      COUNTER_COUNT
+    };
+
+    enum Histogram
+    {
+      /// Duration of `FilterEngine::Matches()`.
+      HISTOGRAM_MATCHES,
+      /// Time spent waiting for the lock of the JS engine.
+      HISTOGRAM_JS_CONTEXT_WAIT,
+      /// Duration of web requests, excluding the time spent in the queue.
+      HISTOGRAM_WEB_REQUEST,
+      /// Duration of reading a file, excluding the time spent in the queue.
+      HISTOGRAM_FILE_READ,
+      /// Duration of writing a file, excluding the time spent in the queue.
+      HISTOGRAM_FILE_WRITE,
+      HISTOGRAM_COUNT
+    };
+
+    virtual ~IMetrics() {}
+
+    /**
+     * Increments a counter.
+     * @param counter Counter to increment.
+     * @param value Increment.
+     */
+    virtual void Increment(Counter counter, uint64_t value) = 0;
+
+    /**
+     * Records a latency sample.
+     * @param histogram Histogram receiving the sample.
+     * @param value Measured duration.
+     */
+    virtual void Record(Histogram histogram, std::chrono::microseconds value) = 0;
+  };
+
+  /**
+   * Shared smart pointer to an instance of `IMetrics` implementation, it is
+   * shared by the platform and the default implementations of the other
+   * platform interfaces.
+   */
+  typedef std::shared_ptr<IMetrics> MetricsPtr;
+}
+
+#endif
@@ -19,12 +19,14 @@
 #define ADBLOCK_PLUS_JS_ENGINE_H
 
 #include <functional>
+#include <atomic>
+#include <chrono>
 #include <map>
-#include <list>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
 #include <mutex>
+#include <vector>
 #include <AdblockPlus/AppInfo.h>
 #include <AdblockPlus/LogSystem.h>
 #include <AdblockPlus/IFileSystem.h>
@@ -45,6 +47,13 @@ namespace v8
 namespace AdblockPlus
 {
   class JsEngine;
+  class JsContext;
+  class JsEventTable;
+  class JsExecutor;
+  class JsHeapObserver;
+  class JsLockGate;
+  class JsLockProfiler;
+  class JsWeakValuesTable;
   class Platform;
 
   /**
@@ -74,13 +83,7 @@ namespace AdblockPlus
   {
     friend class JsValue;
     friend class JsContext;
-
-    struct JsWeakValuesList
-    {
-      ~JsWeakValuesList();
-      std::vector<v8::Global<v8::Value>> values;
-    };
-    typedef std::list<JsWeakValuesList> JsWeakValuesLists;
+    friend class FilterEngine;
   public:
     /**
      * Event callback function.
@@ -92,15 +95,207 @@ namespace AdblockPlus
      */
     typedef std::map<std::string, EventCallback> EventMap;
 
+    /**
+     * Interned event name, see `RegisterEvent()`.
+     */
+    typedef uint32_t EventID;
+
     /**
      * An opaque structure representing ID of stored JsValueList.
+     * The ID is valid only until the values are taken.
      */
     class JsWeakValuesID
     {
       friend class JsEngine;
-      JsWeakValuesLists::const_iterator iterator;
+      uint64_t id;
+    };
+
+    /**
+     * JavaScript heap usage, see `GetHeapStatistics()`.
+     */
+    struct HeapStatistics
+    {
+      /**
+       * Size of the live objects in bytes.
+       */
+      size_t usedHeapSize;
+      /**
+       * Size of the heap reserved by the engine in bytes.
+       */
+      size_t totalHeapSize;
+      /**
+       * Maximal size of the heap in bytes.
+       */
+      size_t heapSizeLimit;
+      /**
+       * Size of the memory held outside of the heap by JavaScript objects,
+       * e.g. by array buffers, in bytes.
+       */
+      size_t externalMemorySize;
+      /**
+       * Number of full (mark-sweep-compact) garbage collections.
+       */
+      uint32_t majorGcCount;
+      /**
+       * Number of young generation (scavenge) garbage collections.
+       */
+      uint32_t minorGcCount;
+    };
+
+    /**
+     * Callback type invoked when the heap usage approaches its limit.
+     * It is called after a garbage collection, so it must not call into the
+     * JavaScript engine.
+     */
+    typedef std::function<void(const HeapStatistics&)> NearHeapLimitCallback;
+
+    /**
+     * Parameters of the isolate created by `New()`.
+     */
+    struct IsolateParameters
+    {
+      IsolateParameters()
+        : maxOldGenerationSizeMB(0), maxSemiSpaceSizeMB(0)
+        , nearHeapLimitRatio(0.9)
+      {
+      }
+      /**
+       * Maximal size of the old generation in megabytes, 0 keeps the
+       * default of V8.
+       */
+      int maxOldGenerationSizeMB;
+      /**
+       * Maximal size of a semi-space of the young generation in megabytes,
+       * 0 keeps the default of V8.
+       */
+      int maxSemiSpaceSizeMB;
+      /**
+       * Optional callback invoked after a garbage collection if the used heap
+       * size is still at least `nearHeapLimitRatio` of the heap size limit.
+       */
+      NearHeapLimitCallback nearHeapLimitCallback;
+      double nearHeapLimitRatio;
     };
 
+    /**
+     * Process wide parameters of V8, see `InitializeV8()`.
+     */
+    struct V8Parameters
+    {
+      V8Parameters()
+        : workerThreadCount(-1)
+      {
+      }
+      /**
+       * Number of the worker threads of V8. 0 disables the background tasks
+       * of V8, e.g. concurrent compilation and sweeping, and no worker is
+       * started. A negative value lets V8 choose it by the number of
+       * processors.
+       */
+      int workerThreadCount;
+      /**
+       * Predefined set of flags, applied before `flags`:
+       * - empty, keeps the defaults of V8.
+       * - "low-memory", optimizes for size, compiles lazily and uses small
+       *   semi-spaces.
+       * - "throughput", uses larger semi-spaces to reduce the number of
+       *   scavenges.
+       */
+      std::string profile;
+      /**
+       * Arbitrary V8 flags, e.g. "--max_old_space_size=64".
+       */
+      std::vector<std::string> flags;
+    };
+
+    /**
+     * Kinds of work acquiring the lock of the engine, see
+     * `GetLockStatistics()`.
+     */
+    enum LockCategory
+    {
+      /// Any other acquisition, e.g. by the API of `FilterEngine`.
+      LOCK_CATEGORY_OTHER,
+      /// Request matching and element hiding selectors.
+      LOCK_CATEGORY_MATCH,
+      /// Timer callbacks.
+      LOCK_CATEGORY_TIMER,
+      /// File system callbacks, including the parsing of read files.
+      LOCK_CATEGORY_FILE_SYSTEM,
+      /// Web request callbacks.
+      LOCK_CATEGORY_WEB_REQUEST,
+      /// Event callbacks calling back into the engine.
+      LOCK_CATEGORY_EVENT,
+      /// Memory pressure notifications.
+      LOCK_CATEGORY_GC,
+      LOCK_CATEGORY_COUNT
+    };
+
+    /**
+     * Lock usage of a category, see `GetLockStatistics()`.
+     */
+    struct LockStatistics
+    {
+      LockCategory category;
+      /**
+       * Number of acquisitions of the lock.
+       */
+      uint64_t acquisitions;
+      /**
+       * Time spent waiting for the lock.
+       */
+      std::chrono::microseconds totalWaitTime;
+      std::chrono::microseconds maxWaitTime;
+      /**
+       * Time the lock has been held.
+       */
+      std::chrono::microseconds totalHoldTime;
+      std::chrono::microseconds maxHoldTime;
+      /**
+       * Time other threads have waited for the lock while this category
+       * was holding it.
+       */
+      std::chrono::microseconds blockingTime;
+    };
+
+    /**
+     * Parameters of the prioritized locking, see
+     * `SetLockPriorityParameters()`.
+     */
+    struct LockPriorityParameters
+    {
+      LockPriorityParameters()
+        : enabled(false), maxForegroundBurst(16)
+      {
+      }
+      /**
+       * Whether foreground work, i.e. the calls of the API including
+       * `FilterEngine::Matches()` (`LOCK_CATEGORY_MATCH` and
+       * `LOCK_CATEGORY_OTHER`), locks the engine before waiting background
+       * work like timers, file system and web request callbacks or memory
+       * pressure notifications.
+       */
+      bool enabled;
+      /**
+       * Number of consecutive foreground acquisitions after which a waiting
+       * background task locks the engine.
+       */
+      unsigned maxForegroundBurst;
+    };
+
+    ~JsEngine();
+
+    /**
+     * Initializes V8 for the whole process. It can be called only once and
+     * before the first engine is created, otherwise `New()` initializes V8
+     * with the default parameters, which disable the background tasks of V8
+     * if the platform is embedder-driven.
+     * @param parameters Worker threads and flags of V8.
+     * @throw `std::invalid_argument` if the profile is unknown.
+     * @throw `std::logic_error` if V8 is already initialized.
+     */
+    static void InitializeV8(const V8Parameters& parameters);
+
     /**
      * Creates a new JavaScript engine instance.
      *
@@ -112,6 +307,19 @@ namespace AdblockPlus
      * @return New `JsEngine` instance.
      */
     static JsEnginePtr New(const AppInfo& appInfo, Platform& platform, std::unique_ptr<IV8IsolateProvider> isolate = nullptr);
+
+    /**
+     * Creates a new JavaScript engine instance with its own isolate.
+     *
+     * @param appInfo Information about the app.
+     * @param platform AdblockPlus platform providing with necessary
+     *        dependencies.
+     * @param isolateParameters Heap limits of the isolate and the callback
+     *        invoked when they are almost reached.
+     * @return New `JsEngine` instance.
+     */
+    static JsEnginePtr New(const AppInfo& appInfo, Platform& platform, const IsolateParameters& isolateParameters);
+
     /**
      * Registers the callback function for an event.
      * @param eventName Event name. Note that this can be any string - it's a
@@ -133,6 +341,38 @@ namespace AdblockPlus
      */
     void TriggerEvent(const std::string& eventName, JsValueList&& params);
 
+    /**
+     * Returns the ID of an event, which can be used instead of the event name
+     * to avoid looking up the name each time. The same name always yields
+     * the same ID during the lifetime of the engine. In JavaScript the ID is
+     * returned by `_getEventId(eventName)` and can be passed to
+     * `_triggerEvent()` instead of the name.
+     * @param eventName Event name.
+     * @return Event ID.
+     */
+    EventID RegisterEvent(const std::string& eventName);
+
+    /**
+     * Registers the callback function for an event.
+     * @param eventID Event ID returned by `RegisterEvent()`.
+     * @param callback Event callback function.
+     */
+    void SetEventCallback(EventID eventID, const EventCallback& callback);
+
+    /**
+     * Removes the callback function for an event.
+     * @param eventID Event ID returned by `RegisterEvent()`.
+     */
+    void RemoveEventCallback(EventID eventID);
+
+    /**
+     * Triggers an event. Unlike the name based variant it neither takes a lock
+     * nor copies the callback, what matters for frequently triggered events.
+     * @param eventID Event ID returned by `RegisterEvent()`.
+     * @param params Event parameters.
+     */
+    void TriggerEvent(EventID eventID, JsValueList&& params);
+
     /**
      * Evaluates a JavaScript expression.
      * @param source JavaScript expression to evaluate.
@@ -214,6 +454,7 @@ namespace AdblockPlus
      * Extracts and removes from `JsEngine` earlier stored `JsValue`s.
      * The method is thread-safe.
      * @param id `JsWeakValuesID` of values.
+     * @throw `std::runtime_error` if the values are already taken.
      * @return `JsValueList` of stored values.
      */
     JsValueList TakeJsValues(const JsWeakValuesID& id);
@@ -261,6 +502,100 @@ namespace AdblockPlus
      */
     void NotifyLowMemory();
 
+    /**
+     * Retrieves the current heap usage and the number of garbage
+     * collections performed since the engine has been created.
+     * @return Heap statistics.
+     */
+    HeapStatistics GetHeapStatistics();
+
+    /**
+     * Sets the maximal time the engine stays locked while the lines of a
+     * file read by `_fileSystem.readFromFile` are passed to the scripts, e.g.
+     * while the filters are loaded. When it elapses the engine is unlocked
+     * and the processing continues in a timer task, so that e.g. requests
+     * can be matched meanwhile. The filters of a downloaded subscription
+     * are created in such slices as well before the list is parsed.
+     * @param duration Duration of a slice, zero (the default) processes the
+     *        whole file at once.
+     */
+    void SetFileParsingSliceDuration(std::chrono::microseconds duration);
+
+    /**
+     * Retrieves the duration set by `SetFileParsingSliceDuration()`.
+     * @return Duration of a slice.
+     */
+    std::chrono::microseconds GetFileParsingSliceDuration() const;
+
+    /**
+     * Configures whether foreground work locks the engine before background
+     * work, by default all threads compete for the lock equally.
+     * @param parameters Prioritization parameters.
+     */
+    void SetLockPriorityParameters(const LockPriorityParameters& parameters);
+
+    /**
+     * Enables or disables the recording of lock statistics. While it is
+     * disabled the acquisition of the lock only checks a flag.
+     * Only the outermost acquisition by a thread is recorded.
+     * @param enabled Whether the statistics are recorded.
+     */
+    void SetLockProfilingEnabled(bool enabled);
+
+    /**
+     * Retrieves the lock statistics recorded since the profiling has been
+     * enabled or reset. The categories keeping other threads waiting the
+     * longest come first, followed by the ones holding the lock the longest.
+     * @return Statistics of each category.
+     */
+    std::vector<LockStatistics> GetLockStatistics() const;
+
+    /**
+     * Discards the recorded lock statistics.
+     */
+    void ResetLockStatistics();
+
+    /**
+     * Retrieves the string representation of a lock category, e.g. `match`.
+     * @param category Lock category.
+     * @return Name of the category.
+     * @throw `std::invalid_argument`, if an invalid `category` was supplied.
+     */
+    static std::string LockCategoryToString(LockCategory category);
+
+    /**
+     * Starts a thread owned by the engine which runs the asynchronous calls
+     * like `FilterEngine::MatchesAsync()`. Afterwards timer, file system and
+     * web request callbacks are posted to that thread as well instead of
+     * locking the engine on the thread calling them back, so that the
+     * threads of the embedder are never blocked by the engine unless they
+     * call the synchronous API. Calling it again has no effect.
+     */
+    void StartJsThread();
+
+    /**
+     * @return Whether `StartJsThread()` has been called.
+     */
+    bool HasJsThread() const;
+
+    /**
+     * Private functionality.
+     * Runs the task on the JS thread of the engine, or immediately if it is
+     * called on the JS thread. Without JS thread the task is posted to the
+     * embedder-driven platform, see `Platform::Poll()`, or run immediately.
+     * The task is discarded if the engine is already destroyed.
+     */
+    static void Dispatch(const std::weak_ptr<JsEngine>& jsEngine,
+      const std::function<void()>& task);
+
+    /**
+     * Private functionality.
+     * @return Number of threads waiting for the lock of the engine, as
+     *         counted by the prioritized locking if it is enabled, otherwise
+     *         by the lock profiling. Zero if both are disabled.
+     */
+    unsigned GetLockWaitingCount() const;
+
     /**
      * Private functionality.
      */
@@ -273,18 +608,65 @@ namespace AdblockPlus
 
     explicit JsEngine(Platform& platform, std::unique_ptr<IV8IsolateProvider> isolate);
 
+    static JsEnginePtr New(const AppInfo& appInfo, Platform& platform,
+      std::unique_ptr<IV8IsolateProvider> isolate, const IsolateParameters& isolateParameters,
+      std::chrono::steady_clock::time_point creationStart);
+
     JsValue GetGlobalObject();
 
     Platform& platform;
     /// Isolate must be disposed only after disposing of all objects which are
     /// using it.
     std::unique_ptr<IV8IsolateProvider> isolate;
+    /// Used by every JsContext, so they are destroyed after the members
+    /// below.
+    std::unique_ptr<JsLockGate> lockGate;
+    std::unique_ptr<JsLockProfiler> lockProfiler;
 
     std::unique_ptr<v8::Global<v8::Context>> context;
-    EventMap eventCallbacks;
-    std::mutex eventCallbacksMutex;
-    JsWeakValuesLists jsWeakValuesLists;
-    std::mutex jsWeakValuesListsMutex;
+    std::unique_ptr<JsEventTable> eventCallbacks;
+    std::unique_ptr<JsWeakValuesTable> jsWeakValues;
+    std::unique_ptr<JsHeapObserver> heapObserver;
+    std::atomic<int64_t> fileParsingSliceDuration;
+    /// Points in time of the engine creation, `creationStart` precedes the
+    /// creation of the isolate and thereby the initialization of V8.
+    std::chrono::steady_clock::time_point creationStart;
+    std::chrono::steady_clock::time_point isolateCreated;
+    std::chrono::steady_clock::time_point contextCreated;
+    mutable std::mutex jsThreadMutex;
+    /// Declared last to be stopped first, while the rest is intact.
+    std::unique_ptr<JsExecutor> jsThread;
+  };
+
+  /**
+   * Keeps the JavaScript engine entered on the current thread for the
+   * lifetime of the object. Without a session each `JsValue` operation
+   * acquires and releases the isolate lock on its own, with a session the
+   * lock is taken once and a sequence of operations only opens lightweight
+   * nested scopes, e.g.
+   *
+   *     JsEngineSession session(jsEngine);
+   *     for (const auto& name : object.GetOwnPropertyNames())
+   *       values[name] = object.GetProperty(name).AsString();
+   *
+   * Other threads cannot use the engine while a session exists, so it should
+   * be kept as short as possible. The session must be destroyed on the thread
+   * which has created it and `JsEngine` must outlive it.
+   */
+  class JsEngineSession
+  {
+  public:
+    /**
+     * Enters the engine, blocks until the isolate lock is acquired.
+     * @param jsEngine `JsEngine` to enter.
+     */
+    explicit JsEngineSession(JsEngine& jsEngine);
+    ~JsEngineSession();
+  private:
+    JsEngineSession(const JsEngineSession&);
+    JsEngineSession& operator=(const JsEngineSession&);
+
+    std::unique_ptr<JsContext> context;
   };
 }
 
@@ -19,7 +19,9 @@
 #define ADBLOCK_PLUS_JS_VALUE_H
 
 #include <stdint.h>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -76,6 +78,29 @@ namespace AdblockPlus
     bool AsBool() const;
     JsValueList AsList() const;
 
+    /**
+     * Converts an array (see `IsArray()`) into a list of strings. Unlike
+     * `AsList()` followed by `AsString()` for each item it walks the array
+     * under a single context and writes UTF-8 directly into the result.
+     * @return List of array items converted to strings.
+     */
+    std::vector<std::string> AsStringVector() const;
+
+    /**
+     * Converts own properties of an object (see `IsObject()`) into a map of
+     * property names to property values converted to strings. Like
+     * `AsStringVector()` it is done under a single context.
+     * @return Map of property names to string property values.
+     */
+    std::map<std::string, std::string> AsStringMap() const;
+
+    /**
+     * Like `AsStringMap()` but keeps the properties in their order, e.g.\ for
+     * headers.
+     * @return List of pairs of property names and string property values.
+     */
+    std::vector<std::pair<std::string, std::string>> AsStringPairs() const;
+
     /**
      * Returns a list of property names if this is an object (see `IsObject()`).
      * @return List of property names.
@@ -22,15 +22,19 @@
 #include "ITimer.h"
 #include "IFileSystem.h"
 #include "IWebRequest.h"
+#include "IMetrics.h"
 #include "AppInfo.h"
 #include "Scheduler.h"
 #include "FilterEngine.h"
+#include <chrono>
 #include <mutex>
 #include <future>
 
 namespace AdblockPlus
 {
   struct IV8IsolateProvider;
+  class EmbedderTaskQueue;
+  class FilePrefetcher;
   class JsEngine;
 
   /**
@@ -50,6 +54,9 @@ namespace AdblockPlus
      * @param timer Implementation of timer.
      * @param webRequest Implementation of web request.
      * @param fileSystem Implementation of filesystem.
+     * @param metrics Optional sink of counters and latencies, see
+     *        `DefaultMetrics`. It is not replaced by a default
+     *        implementation when it is nullptr.
      */
     struct CreationParameters
     {
@@ -57,6 +64,7 @@ namespace AdblockPlus
       TimerPtr timer;
       WebRequestPtr webRequest;
       FileSystemPtr fileSystem;
+      MetricsPtr metrics;
     };
 
     /**
@@ -83,6 +91,16 @@ namespace AdblockPlus
      */
     void SetUpJsEngine(const AppInfo& appInfo = AppInfo(), std::unique_ptr<IV8IsolateProvider> isolate = nullptr);
 
+    /**
+     * Ensures that JsEngine is constructed with its own isolate. If JsEngine
+     * is already present then the parameters are ignored.
+     *
+     * @param appInfo Information about the app.
+     * @param isolateParameters Heap limits of the isolate, see
+     *        `JsEngine::IsolateParameters`.
+     */
+    void SetUpJsEngine(const AppInfo& appInfo, const JsEngine::IsolateParameters& isolateParameters);
+
     /**
      * Retrieves the `JsEngine` instance. It calls SetUpJsEngine if JsEngine is
      * not initialized yet.
@@ -107,6 +125,73 @@ namespace AdblockPlus
      */
     FilterEngine& GetFilterEngine();
 
+    /**
+     * Retrieves the metrics sink, it does not change during the lifetime of
+     * the platform.
+     * @return Metrics sink or nullptr if there is none.
+     */
+    IMetrics* GetMetrics() const
+    {
+      return metrics.get();
+    }
+
+    /**
+     * Runs the tasks which are ready at the moment of the call on the
+     * calling thread, i.e. expired timers, file system and web request
+     * operations and their completions. Tasks which become ready meanwhile
+     * are run by the next call. It has effect only for a platform created
+     * in the embedder-driven mode, see
+     * `DefaultPlatformBuilder::EnableEmbedderDrivenMode()`.
+     * @return Number of executed tasks.
+     */
+    size_t Poll();
+
+    /**
+     * Calls `Poll()` until there are no ready tasks, it does not wait for
+     * timers which have not expired yet.
+     * @return Number of executed tasks.
+     */
+    size_t RunUntilIdle();
+
+    /**
+     * Allows the embedder to sleep between the calls of `Poll()`.
+     * @return Time until the next task is ready, zero if there is a ready
+     *         task and `std::chrono::milliseconds::max()` if there is none
+     *         or the platform is not embedder-driven.
+     */
+    std::chrono::milliseconds GetTimeUntilNextTask() const;
+
+    /**
+     * @return Whether the tasks of the platform are run by `Poll()`.
+     */
+    bool IsEmbedderDriven() const
+    {
+      return !!taskQueue;
+    }
+
+    /**
+     * Private functionality.
+     * Posts a completion to be run by `Poll()` unless it is called from
+     * `Poll()` on the same thread.
+     * @return `true` if the task is posted, `false` if the caller should
+     *         run it immediately.
+     */
+    bool PostEmbedderTask(const SchedulerTask& task);
+
+    /**
+     * Private functionality.
+     * @return Reader of the files which are needed early, like patterns.ini.
+     */
+    FilePrefetcher& GetFilePrefetcher();
+
+    /**
+     * Private functionality.
+     * @return Number of threads parsing the filters of a read file, one if
+     *         the platform is embedder-driven and zero, meaning a thread per
+     *         core, otherwise.
+     */
+    unsigned GetFilterParsingThreadCount() const;
+
     typedef std::function<void(ITimer&)> WithTimerCallback;
     virtual void WithTimer(const WithTimerCallback&);
 
@@ -124,11 +209,14 @@ namespace AdblockPlus
     TimerPtr timer;
     FileSystemPtr fileSystem;
     WebRequestPtr webRequest;
+    MetricsPtr metrics;
+    std::shared_ptr<EmbedderTaskQueue> taskQueue;
   private:
     // used for creation and deletion of modules.
     std::mutex modulesMutex;
     std::shared_ptr<JsEngine> jsEngine;
     std::shared_future<FilterEnginePtr> filterEngine;
+    std::shared_ptr<FilePrefetcher> filePrefetcher;
   };
 
   /**
@@ -146,8 +234,25 @@ namespace AdblockPlus
      */
     Scheduler GetDefaultAsyncExecutor();
 
+    /**
+     * Switches the builder to the embedder-driven mode, in which the created
+     * platform has no threads of its own. The default timer, file system
+     * and web request queue their work and completions, which are run by
+     * `Platform::Poll()` on the thread of the embedder, the completions of
+     * custom implementations are queued as well. V8 is initialized without
+     * background tasks if the first `JsEngine` of the process is created
+     * by such a platform.
+     * It should be called before the default implementations are
+     * constructed.
+     * @throw `std::logic_error` if the default file system or web request is
+     *        already constructed.
+     */
+    void EnableEmbedderDrivenMode();
+
     /**
      * Constructs default implementation of `ITimer`.
+     * The default file system and web request report to `metrics`, so it
+     * should be set before they are constructed.
      */
     void CreateDefaultTimer();
 
@@ -175,6 +280,7 @@ namespace AdblockPlus
   private:
     std::shared_ptr<Scheduler> asyncExecutor;
     Scheduler defaultScheduler;
+    std::shared_ptr<EmbedderTaskQueue> taskQueue;
   };
 }
 
@@ -20,16 +20,42 @@
 let API = (() =>
 {
   const {Services} = Cu.import("resource://gre/modules/Services.jsm", {});
-  const {Filter} = require("filterClasses");
+  const {Filter, WhitelistFilter} = require("filterClasses");
   const {Subscription} = require("subscriptionClasses");
   const {SpecialSubscription} = require("subscriptionClasses");
   const {FilterStorage} = require("filterStorage");
   const {defaultMatcher} = require("matcher");
   const {ElemHide} = require("elemHide");
+  const {ElemHideEmulation} = require("elemHideEmulation");
   const {Synchronizer} = require("synchronizer");
   const {Prefs} = require("prefs");
   const {checkForUpdates} = require("updater");
   const {Notification} = require("notification");
+  const {setFilterChangeBatching} = require("filterUpdateRegistration");
+  const {IO} = require("io");
+  const {getStartupProgress, whenLoaded} = require("progressiveStartup");
+
+  const elemHideCriteria = {
+    all: ElemHide.ALL_MATCHING,
+    delta: ElemHide.NO_UNCONDITIONAL,
+    specific: ElemHide.SPECIFIC_ONLY
+  };
+
+  // Subscriptions loaded from patterns.ini replace the objects which were
+  // created for their URLs before.
+  function getLoadedSubscription(subscription)
+  {
+    return Subscription.fromURL(subscription.url);
+  }
+
+  function checkFilterMatch(url, contentTypeMask, documentUrl)
+  {
+    let requestHost = extractHostFromURL(url);
+    let documentHost = extractHostFromURL(documentUrl);
+    let thirdParty = isThirdParty(requestHost, documentHost);
+    return defaultMatcher.matchesAny(
+      url, contentTypeMask, documentHost, thirdParty);
+  }
 
   return {
     getFilterFromText(text)
@@ -50,12 +76,12 @@ let API = (() =>
 
     addFilterToList(filter)
     {
-      FilterStorage.addFilter(filter);
+      whenLoaded(() => FilterStorage.addFilter(filter));
     },
 
     removeFilterFromList(filter)
     {
-      FilterStorage.removeFilter(filter);
+      whenLoaded(() => FilterStorage.removeFilter(filter));
     },
 
     getListedFilters()
@@ -92,20 +118,38 @@ let API = (() =>
 
     addSubscriptionToList(subscription)
     {
-      FilterStorage.addSubscription(subscription);
+      whenLoaded(() =>
+      {
+        subscription = getLoadedSubscription(subscription);
+        FilterStorage.addSubscription(subscription);
 
-      if (!subscription.lastDownload)
-        Synchronizer.execute(subscription);
+        if (!subscription.lastDownload)
+          Synchronizer.execute(subscription);
+      });
     },
 
     removeSubscriptionFromList(subscription)
     {
-      FilterStorage.removeSubscription(subscription);
+      whenLoaded(() =>
+      {
+        FilterStorage.removeSubscription(getLoadedSubscription(subscription));
+      });
+    },
+
+    setSubscriptionDisabled(subscription, disabled)
+    {
+      whenLoaded(() =>
+      {
+        getLoadedSubscription(subscription).disabled = disabled;
+      });
     },
 
     updateSubscription(subscription)
     {
-      Synchronizer.execute(subscription);
+      whenLoaded(() =>
+      {
+        Synchronizer.execute(getLoadedSubscription(subscription));
+      });
     },
 
     isSubscriptionUpdating(subscription)
@@ -147,24 +191,27 @@ let API = (() =>
 
     setAASubscriptionEnabled(enabled)
     {
-      let aaSubscription = FilterStorage.subscriptions.find(
-        API.isAASubscription);
-      if (!enabled)
-      {
-        if (aaSubscription && !aaSubscription.disabled)
-          aaSubscription.disabled = true;
-        return;
-      }
-      if (!aaSubscription)
+      whenLoaded(() =>
       {
-        aaSubscription = Subscription.fromURL(
-          Prefs.subscriptions_exceptionsurl);
-        FilterStorage.addSubscription(aaSubscription);
-      }
-      if (aaSubscription.disabled)
-        aaSubscription.disabled = false;
-      if (!aaSubscription.lastDownload)
-        Synchronizer.execute(aaSubscription);
+        let aaSubscription = FilterStorage.subscriptions.find(
+          API.isAASubscription);
+        if (!enabled)
+        {
+          if (aaSubscription && !aaSubscription.disabled)
+            aaSubscription.disabled = true;
+          return;
+        }
+        if (!aaSubscription)
+        {
+          aaSubscription = Subscription.fromURL(
+            Prefs.subscriptions_exceptionsurl);
+          FilterStorage.addSubscription(aaSubscription);
+        }
+        if (aaSubscription.disabled)
+          aaSubscription.disabled = false;
+        if (!aaSubscription.lastDownload)
+          Synchronizer.execute(aaSubscription);
+      });
     },
 
     isAASubscriptionEnabled()
@@ -188,19 +235,77 @@ let API = (() =>
     {
       Notification.markAsShown(id);
     },
-    checkFilterMatch(url, contentTypeMask, documentUrl)
+    checkFilterMatch,
+
+    getPageSetup(url, documentUrls, documentType, ...whitelistingTypes)
+    {
+      // Gives the same results as FilterEngine::GetWhitelistingFilter for
+      // each type but walks the frames and checks each parent document only
+      // once.
+      let whitelisted = whitelistingTypes.map(() => false);
+      let remaining = whitelistingTypes.length;
+      let currentUrl = url;
+      // documentUrls are separated by line breaks, no documents result in a
+      // single empty URL like in FilterEngine::GetWhitelistingFilter.
+      for (let parentUrl of documentUrls.split("\n"))
+      {
+        let parentWhitelisted = checkFilterMatch(
+          parentUrl, documentType, parentUrl) instanceof WhitelistFilter;
+        for (let i = 0; i < whitelistingTypes.length; i++)
+        {
+          if (whitelisted[i])
+            continue;
+          if (parentWhitelisted ||
+              checkFilterMatch(currentUrl, whitelistingTypes[i],
+                               parentUrl) instanceof WhitelistFilter)
+          {
+            whitelisted[i] = true;
+            remaining--;
+          }
+        }
+        if (!remaining)
+          break;
+        currentUrl = parentUrl;
+      }
+      return whitelisted.concat(extractHostFromURL(url));
+    },
+
+    getElementHidingStyleSheet(domain, kind)
+    {
+      let selectors;
+      if (kind == "generic")
+      {
+        selectors = ElemHide.getUnconditionalSelectors();
+      }
+      else
+      {
+        selectors = ElemHide.getSelectorsForDomain(domain,
+                                                   elemHideCriteria[kind],
+                                                   false);
+      }
+      // Selectors can't contain line breaks, the native side splits there.
+      return selectors.join(",\n");
+    },
+
+    getElementHidingEmulationSelectors(domain)
+    {
+      let result = "";
+      for (let filter of ElemHideEmulation.getRulesForDomain(domain))
+        result += filter.selector + "\n" + filter.text + "\n";
+      return result;
+    },
+
+    getStartupProgress()
     {
-      let requestHost = extractHostFromURL(url);
-      let documentHost = extractHostFromURL(documentUrl);
-      let thirdParty = isThirdParty(requestHost, documentHost);
-      return defaultMatcher.matchesAny(
-        url, contentTypeMask, documentHost, thirdParty);
+      return getStartupProgress();
     },
 
-    getElementHidingSelectors(domain)
+    getFilterState()
     {
-      return ElemHide.getSelectorsForDomain(domain,
-                                            ElemHide.ALL_MATCHING, false);
+      // The content of patterns.ini when the current filters are saved, the
+      // native side hashes it to check whether the warm cache is valid.
+      return Array.from(FilterStorage.exportData()).join(IO.lineBreak) +
+        IO.lineBreak;
     },
 
     getPref(pref)
@@ -213,9 +318,14 @@ let API = (() =>
       Prefs[pref] = value;
     },
 
-    forceUpdateCheck(eventName)
+    forceUpdateCheck(id)
+    {
+      checkForUpdates(id ? _triggerEvent.bind(null, "_updateCheckDone", id) : null);
+    },
+
+    setFilterChangeBatching(enabled, window, includeFilterTexts)
     {
-      checkForUpdates(eventName ? _triggerEvent.bind(null, eventName) : null);
+      setFilterChangeBatching(enabled, window, !!includeFilterTexts);
     },
 
     getHostFromUrl(url)
@@ -205,6 +205,34 @@ FakeTimer.prototype =
 // Fake XMLHttpRequest implementation
 //
 
+// The synchronizer of the core parses a downloaded filter list at once.
+// If file parsing is sliced the filters are created in slices beforehand,
+// the synchronizer finds them known then.
+function prepareFilterList(text, callback)
+{
+  if (typeof text != "string" || !/^\s*\[Adblock/i.test(text.substr(0, 100)))
+  {
+    callback();
+    return;
+  }
+
+  let {Filter} = require("filterClasses");
+  let isHeader = true;
+  let processLine = line =>
+  {
+    if (isHeader)
+    {
+      isHeader = false;
+      return;
+    }
+    line = Filter.normalize(line);
+    if (line)
+      Filter.fromText(line);
+  };
+  if (!_processLines(text, processLine, error => callback()))
+    callback();
+}
+
 function XMLHttpRequest()
 {
   this._requestHeaders = {};
@@ -325,13 +353,20 @@ XMLHttpRequest.prototype =
       const NS_OK = 0;
       let eventName = (this.channel.status == NS_OK ? "load" : "error");
       let event = {type: eventName};
-
-      if (this["on" + eventName])
-        this["on" + eventName].call(this, event);
-
-      let list = this["_" + eventName + "Handlers"];
-      for (let i = 0; i < list.length; i++)
-        list[i].call(this, event);
+      let notify = () =>
+      {
+        if (this["on" + eventName])
+          this["on" + eventName].call(this, event);
+
+        let list = this["_" + eventName + "Handlers"];
+        for (let i = 0; i < list.length; i++)
+          list[i].call(this, event);
+      };
+
+      if (eventName == "load")
+        prepareFilterList(this.responseText, notify);
+      else
+        notify();
     };
     // HACK (#5066): the code checking whether the connection is
     // allowed is temporary, the actual check should be in the core
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+"use strict";
+
+// The keywords of the filters in patterns.ini are found natively while the
+// file is read and passed along with the lines. Until the filters are
+// loaded the matcher takes them instead of searching for the keywords.
+
+const {FilterNotifier} = require("filterNotifier");
+const {FilterStorage} = require("filterStorage");
+const {IO} = require("io");
+const {Matcher} = require("matcher");
+
+let keywords = new Map();
+
+let {readFromFile} = IO;
+IO.readFromFile = function(fileName, listener)
+{
+  if (fileName == FilterStorage.sourceFile)
+  {
+    let parserListener = listener;
+    listener = (line, keyword) =>
+    {
+      if (typeof keyword == "string")
+      {
+        let text = line.includes("\\[") ? line.replace(/\\\[/g, "[") : line;
+        keywords.set(text, keyword);
+      }
+      parserListener(line);
+    };
+  }
+  return readFromFile.call(this, fileName, listener);
+};
+
+let {findKeyword} = Matcher.prototype;
+Matcher.prototype.findKeyword = function(filter)
+{
+  let keyword = keywords.get(filter.text);
+  if (keyword === undefined)
+    return findKeyword.call(this, filter);
+  return keyword;
+};
+
+FilterNotifier.addListener(action =>
+{
+  // The filter listener adds all filters again on "load", the keywords are
+  // dropped once it's done.
+  if (action == "load" && keywords.size)
+    Promise.resolve().then(() => keywords.clear());
+});
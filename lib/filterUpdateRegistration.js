@@ -19,7 +19,141 @@
 
 let {FilterNotifier} = require("filterNotifier");
 
-FilterNotifier.addListener((action, item) =>
+let filterChangeEventId = _getEventId("filterChange");
+let filterChangeBatchEventId = _getEventId("_filterChangeBatch");
+let filtersSavedEventId = _getEventId("_filtersSaved");
+let filterGenerationEventId = _getEventId("_filterGeneration");
+
+// Actions which can change the active filters, each of them starts a new
+// generation of the cached filtering results.
+let generationActions = new Set([
+  "load",
+  "filter.added",
+  "filter.removed",
+  "filter.moved",
+  "filter.disabled",
+  "subscription.added",
+  "subscription.removed",
+  "subscription.disabled",
+  "subscription.updated"
+]);
+
+let batchOptions = null;
+let pendingBatches = null;
+let filtersLoaded = false;
+
+function flushBatches()
+{
+  if (!pendingBatches)
+    return;
+  let batches = Array.from(pendingBatches.values());
+  pendingBatches = null;
+  _triggerEvent(filterChangeBatchEventId, batches);
+}
+
+function getBatch(subscriptionUrl)
+{
+  if (!pendingBatches)
+  {
+    pendingBatches = new Map();
+    setTimeout(flushBatches, batchOptions.window);
+  }
+  let batch = pendingBatches.get(subscriptionUrl);
+  if (!batch)
+  {
+    batch = {
+      subscriptionUrl,
+      actions: [],
+      filtersAdded: 0,
+      filtersRemoved: 0,
+      addedFilters: [],
+      removedFilters: []
+    };
+    pendingBatches.set(subscriptionUrl, batch);
+  }
+  return batch;
+}
+
+function addFilters(batch, filters)
+{
+  batch.filtersAdded += filters.length;
+  if (batchOptions.includeFilterTexts)
+    batch.addedFilters.push(...filters.map(filter => filter.text));
+}
+
+function removeFilters(batch, filters)
+{
+  batch.filtersRemoved += filters.length;
+  if (batchOptions.includeFilterTexts)
+    batch.removedFilters.push(...filters.map(filter => filter.text));
+}
+
+function recordChange(action, item, param1)
+{
+  let subscription = null;
+  if (item && typeof item.url == "string")
+    subscription = item;
+  else if (param1 && typeof param1.url == "string")
+    subscription = param1;
+
+  let batch = getBatch(subscription ? subscription.url : "");
+  if (batch.actions.indexOf(action) < 0)
+    batch.actions.push(action);
+
+  switch (action)
+  {
+    case "filter.added":
+      addFilters(batch, [item]);
+      break;
+    case "filter.removed":
+      removeFilters(batch, [item]);
+      break;
+    case "subscription.added":
+      addFilters(batch, item.filters);
+      break;
+    case "subscription.removed":
+      removeFilters(batch, item.filters);
+      break;
+    case "subscription.updated":
+      if (item.oldFilters)
+      {
+        let oldTexts = new Set(item.oldFilters.map(filter => filter.text));
+        let newTexts = new Set(item.filters.map(filter => filter.text));
+        addFilters(batch, item.filters.filter(
+          filter => !oldTexts.has(filter.text)));
+        removeFilters(batch, item.oldFilters.filter(
+          filter => !newTexts.has(filter.text)));
+      }
+      break;
+  }
+}
+
+/**
+ * Enables or disables coalescing of filter changes into summaries which are
+ * delivered via the "_filterChangeBatch" event.
+ * @param {boolean} enabled
+ * @param {number} window coalescing window in milliseconds
+ * @param {boolean} includeFilterTexts whether to collect filter texts
+ */
+exports.setFilterChangeBatching = (enabled, window, includeFilterTexts) =>
+{
+  batchOptions = enabled ? {window: window || 0, includeFilterTexts} : null;
+  pendingBatches = null;
+};
+
+FilterNotifier.addListener((action, item, param1) =>
 {
-  _triggerEvent("filterChange", action, item);
+  if (generationActions.has(action))
+  {
+    // Only the first "load" loads the filters the warm cache is saved for.
+    let isStartupLoad = action == "load" && !filtersLoaded;
+    if (action == "load")
+      filtersLoaded = true;
+    _triggerEvent(filterGenerationEventId, isStartupLoad);
+  }
+  _triggerEvent(filterChangeEventId, action, item);
+  if (action == "save")
+    _triggerEvent(filtersSavedEventId);
+  if (batchOptions)
+    recordChange(action, item, param1);
 });
@@ -21,9 +21,23 @@ let {Prefs} = require("prefs");
 let {FilterNotifier} = require("filterNotifier");
 
 let filtersInitDone = false;
+// With the progressive startup the engine is ready as soon as the priority
+// subscriptions are active, see progressiveStartup.js.
+let priorityFiltersDone = false;
+
+let checkReady = () =>
+{
+  if (Prefs.initialized && (priorityFiltersDone || filtersInitDone))
+  {
+    checkReady = () => {};
+    if (_progressiveStartup)
+      _triggerEvent("_ready");
+  }
+};
 
 let checkInitialized = () =>
 {
+  checkReady();
   if (Prefs.initialized && filtersInitDone)
   {
     checkInitialized = () => {};
@@ -31,6 +45,12 @@ let checkInitialized = () =>
   }
 };
 
+exports.setPriorityFiltersLoaded = () =>
+{
+  priorityFiltersDone = true;
+  checkReady();
+};
+
 Prefs._initListener = function()
 {
   checkInitialized();
@@ -39,10 +59,14 @@ Prefs._initListener = function()
 if (Prefs.initialized)
   checkInitialized();
 
+// The filter storage is loaded by the modules evaluated after this one.
+_triggerEvent("_startupPhase", "filters.load", true);
+
 FilterNotifier.addListener(action =>
 {
   if (action === "load")
   {
+    _triggerEvent("_startupPhase", "filters.load", false);
     let {FilterStorage} = require("filterStorage");
     if (FilterStorage.firstRun)
     {
@@ -51,8 +51,11 @@ exports.IO =
   {
     return new Promise((resolve, reject) =>
     {
+      let phase = "read " + fileName;
+      _triggerEvent("_startupPhase", phase, true);
       _fileSystem.readFromFile(fileName, listener, (error) =>
       {
+        _triggerEvent("_startupPhase", phase, false);
         if (error)
           return reject(error);
         resolve();
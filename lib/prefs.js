@@ -84,8 +84,11 @@ function defineProperty(key)
 
 function load()
 {
+  let phase = "read " + prefsFileName;
+  _triggerEvent("_startupPhase", phase, true);
   _fileSystem.read(prefsFileName, result =>
   {
+    _triggerEvent("_startupPhase", phase, false);
     // prefs.json is expected to be missing, ignore errors reading file
     if (!result.error)
     {
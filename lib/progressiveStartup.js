@@ -0,0 +1,277 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+"use strict";
+
+// With the progressive startup the subscriptions are activated one by one
+// while patterns.ini is being parsed, the filter listener replaces them with
+// the complete filter state on "load". The user's filters and the acceptable
+// ads subscription are saved first along with their count, once they are
+// active the engine is ready to be queried. Changes of the filter storage
+// are deferred until "load", see whenLoaded().
+
+const {FilterNotifier} = require("filterNotifier");
+const {FilterStorage} = require("filterStorage");
+const {Prefs} = require("prefs");
+const {IO} = require("io");
+const {setPriorityFiltersLoaded} = require("init");
+const {
+  ActiveFilter, Filter, RegExpFilter, ElemHideBase, ElemHideEmulationFilter
+} = require("filterClasses");
+const {ElemHide} = require("elemHide");
+const {ElemHideEmulation} = require("elemHideEmulation");
+const {defaultMatcher} = require("matcher");
+
+// header property of patterns.ini, the number of priority subscriptions.
+const prioritySubscriptionsProperty = "prioritySubscriptions";
+
+let progressEventId = _getEventId("_startupProgress");
+let filterGenerationEventId = _getEventId("_filterGeneration");
+
+let liveSubscriptions = [];
+let complete = false;
+let pendingChanges = [];
+
+function isPrioritySubscription(url)
+{
+  return url.startsWith("~") || url == Prefs.subscriptions_exceptionsurl;
+}
+
+function getStartupProgress()
+{
+  if (complete)
+  {
+    liveSubscriptions = FilterStorage.subscriptions
+      .filter(subscription => !subscription.disabled)
+      .map(subscription => subscription.url);
+  }
+  return [complete, ...liveSubscriptions];
+}
+exports.getStartupProgress = getStartupProgress;
+
+// The subscriptions loaded from patterns.ini replace the current ones on
+// "load", so earlier changes would be lost. They are applied once the filter
+// listener has processed "load".
+function whenLoaded(change)
+{
+  if (complete)
+    change();
+  else
+    pendingChanges.push(change);
+}
+exports.whenLoaded = whenLoaded;
+
+function addFilter(filter)
+{
+  if (!(filter instanceof ActiveFilter))
+    return;
+  if (filter instanceof RegExpFilter)
+    defaultMatcher.add(filter);
+  else if (filter instanceof ElemHideEmulationFilter)
+    ElemHideEmulation.add(filter);
+  else if (filter instanceof ElemHideBase)
+    ElemHide.add(filter);
+}
+
+// Follows the sections of patterns.ini as they are passed to the parser of
+// the filter storage.
+class SubscriptionLoader
+{
+  constructor()
+  {
+    this.section = null;
+    this.properties = {};
+    this.subscription = null;
+    this.filterTexts = [];
+    this.disabledFilters = new Set();
+    this.priorityDone = false;
+    // unknown until the header is read, files saved without the count are
+    // only ready once they are loaded completely.
+    this.pendingPrioritySubscriptions = -1;
+  }
+
+  process(line)
+  {
+    let match = line === null ? null : /^\s*\[(.+)\]\s*$/.exec(line);
+    if (line === null || match)
+    {
+      let section = match ? match[1].toLowerCase() : null;
+      this.finishSection(section);
+      this.section = section;
+      this.properties = {};
+      if (line === null)
+        this.setPriorityDone();
+      return;
+    }
+
+    if (this.section == "subscription filters")
+    {
+      if (line)
+        this.filterTexts.push(line.replace(/\\\[/g, "["));
+      return;
+    }
+
+    let property = /^(\w+)=(.*)$/.exec(line);
+    if (property)
+      this.properties[property[1]] = property[2];
+  }
+
+  finishSection(nextSection)
+  {
+    switch (this.section)
+    {
+      case null:
+        if (prioritySubscriptionsProperty in this.properties)
+        {
+          let count = parseInt(this.properties[prioritySubscriptionsProperty], 10);
+          if (count >= 0)
+            this.pendingPrioritySubscriptions = count;
+          if (this.pendingPrioritySubscriptions == 0)
+            this.setPriorityDone();
+        }
+        return;
+      case "filter":
+        if (this.properties.text && this.properties.disabled == "true")
+          this.disabledFilters.add(this.properties.text);
+        return;
+      case "subscription":
+        this.subscription = this.properties;
+        // a subscription without filters has no filters section.
+        if (nextSection == "subscription filters")
+          return;
+        break;
+      case "subscription filters":
+        break;
+      default:
+        return;
+    }
+
+    if (this.subscription && this.subscription.url)
+    {
+      this.activate(this.subscription, this.filterTexts);
+      if (isPrioritySubscription(this.subscription.url) &&
+          this.pendingPrioritySubscriptions > 0 &&
+          --this.pendingPrioritySubscriptions == 0)
+        this.setPriorityDone();
+    }
+    this.subscription = null;
+    this.filterTexts = [];
+  }
+
+  setPriorityDone()
+  {
+    if (this.priorityDone)
+      return;
+    this.priorityDone = true;
+    setPriorityFiltersLoaded();
+  }
+
+  activate(subscription, filterTexts)
+  {
+    if (subscription.disabled == "true")
+      return;
+    for (let text of filterTexts)
+    {
+      if (!this.disabledFilters.has(text))
+        addFilter(Filter.fromText(text));
+    }
+    liveSubscriptions.push(subscription.url);
+    _triggerEvent(filterGenerationEventId, true);
+    _triggerEvent(progressEventId, ...getStartupProgress());
+  }
+}
+
+if (_progressiveStartup)
+{
+  let {readFromFile} = IO;
+  IO.readFromFile = function(fileName, listener)
+  {
+    if (fileName == FilterStorage.sourceFile && !complete)
+    {
+      let loader = new SubscriptionLoader();
+      let parserListener = listener;
+      listener = line =>
+      {
+        parserListener(line);
+        loader.process(line);
+      };
+    }
+    return readFromFile.call(this, fileName, listener);
+  };
+
+  // Save the priority subscriptions first and their count in the header, so
+  // that they are active first on the next start and the loader knows when
+  // they are complete. The lines are generated at once, so nobody else can
+  // see the reordered list.
+  let {exportData} = FilterStorage;
+  FilterStorage.exportData = function*(...args)
+  {
+    let {subscriptions} = this;
+    let prioritySubscriptions =
+      subscriptions.filter(s => isPrioritySubscription(s.url));
+    this.subscriptions = prioritySubscriptions.concat(
+      subscriptions.filter(s => !isPrioritySubscription(s.url)));
+    try
+    {
+      let isHeader = true;
+      for (let line of exportData.apply(this, args))
+      {
+        if (isHeader && line.startsWith("["))
+        {
+          isHeader = false;
+          yield prioritySubscriptionsProperty + "=" +
+                prioritySubscriptions.length;
+        }
+        yield line;
+      }
+      if (isHeader)
+        yield prioritySubscriptionsProperty + "=" + prioritySubscriptions.length;
+    }
+    finally
+    {
+      this.subscriptions = subscriptions;
+    }
+  };
+}
+
+FilterNotifier.addListener(action =>
+{
+  if (action == "load" && !complete)
+  {
+    complete = true;
+    let changes = pendingChanges;
+    pendingChanges = [];
+    if (changes.length)
+    {
+      Promise.resolve().then(() =>
+      {
+        for (let change of changes)
+        {
+          try
+          {
+            change();
+          }
+          catch (e)
+          {
+            Cu.reportError(e);
+          }
+        }
+      });
+    }
+    _triggerEvent(progressEventId, ...getStartupProgress());
+  }
+});
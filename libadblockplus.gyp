@@ -13,7 +13,7 @@
       }
     }
   ]],
-  'includes': ['v8.gypi', 'shell/shell.gyp'],
+  'includes': ['v8.gypi', 'shell/shell.gyp', 'benchmarks/benchmarks.gyp'],
   'targets': [{
     'target_name': 'libadblockplus',
     'type': '<(library)',
@@ -32,24 +32,50 @@
       'src/AppInfoJsObject.cpp',
       'src/ConsoleJsObject.cpp',
       'src/DefaultLogSystem.cpp',
+      'src/DefaultMetrics.cpp',
       'src/DefaultFileSystem.h',
       'src/DefaultFileSystem.cpp',
       'src/DefaultTimer.cpp',
       'src/DefaultTimer.h',
       'src/DefaultWebRequest.h',
       'src/DefaultWebRequest.cpp',
+      'src/ElementHidingCache.cpp',
+      'src/ElementHidingCache.h',
+      'src/EmbedderTaskQueue.cpp',
+      'src/EmbedderTaskQueue.h',
+      'src/FilePrefetcher.cpp',
+      'src/FilePrefetcher.h',
       'src/FileSystemJsObject.cpp',
       'src/FilterEngine.cpp',
+      'src/FilterLineParser.cpp',
+      'src/FilterLineParser.h',
       'src/GlobalJsObject.cpp',
       'src/JsContext.cpp',
       'src/JsEngine.cpp',
       'src/JsError.cpp',
+      'src/JsEventTable.cpp',
+      'src/JsEventTable.h',
+      'src/JsExecutor.cpp',
+      'src/JsExecutor.h',
+      'src/JsLockGate.cpp',
+      'src/JsLockGate.h',
+      'src/JsLockProfiler.cpp',
+      'src/JsLockProfiler.h',
       'src/JsValue.cpp',
+      'src/JsWeakValuesTable.cpp',
+      'src/JsWeakValuesTable.h',
+      'src/MatchDecisionCache.cpp',
+      'src/MatchDecisionCache.h',
       'src/Notification.cpp',
       'src/Platform.cpp',
       'src/ReferrerMapping.cpp',
+      'src/ScopedLatency.h',
+      'src/StartupTimelineRecorder.cpp',
+      'src/StartupTimelineRecorder.h',
       'src/Thread.cpp',
       'src/Utils.cpp',
+      'src/WarmCache.cpp',
+      'src/WarmCache.h',
       'src/WebRequestJsObject.cpp',
       '<(INTERMEDIATE_DIR)/adblockplus.js.cpp'
     ],
@@ -141,6 +167,8 @@
           'adblockpluscore/lib/elemHide.js',
           'adblockpluscore/lib/elemHideEmulation.js',
           'adblockpluscore/lib/matcher.js',
+          'lib/filterKeywords.js',
+          'lib/progressiveStartup.js',
           'adblockpluscore/lib/filterListener.js',
           'adblockpluscore/lib/downloader.js',
           'adblockpluscore/lib/notification.js',
@@ -193,8 +221,10 @@
       'test/AppInfoJsObject.cpp',
       'test/ConsoleJsObject.cpp',
       'test/DefaultFileSystem.cpp',
+      'test/DefaultMetrics.cpp',
       'test/FileSystemJsObject.cpp',
       'test/FilterEngine.cpp',
+      'test/FilterLineParser.cpp',
       'test/GlobalJsObject.cpp',
       'test/JsEngine.cpp',
       'test/JsValue.cpp',
@@ -35,6 +35,7 @@
 #endif
 
 #include "../src/Utils.h"
+#include "ScopedLatency.h"
 
 using namespace AdblockPlus;
 
@@ -195,8 +196,9 @@ std::string DefaultFileSystemSync::Resolve(const std::string& path) const
   }
 }
 
-DefaultFileSystem::DefaultFileSystem(const Scheduler& scheduler, std::unique_ptr<DefaultFileSystemSync> syncImpl)
-  : scheduler(scheduler), syncImpl(std::move(syncImpl))
+DefaultFileSystem::DefaultFileSystem(const Scheduler& scheduler, std::unique_ptr<DefaultFileSystemSync> syncImpl,
+  const MetricsPtr& metrics)
+  : scheduler(scheduler), syncImpl(std::move(syncImpl)), metrics(metrics)
 {
 }
 
@@ -208,7 +210,16 @@ void DefaultFileSystem::Read(const std::string& fileName,
     std::string error;
     try
     {
-      auto data = syncImpl->Read(Resolve(fileName));
+      IOBuffer data;
+      {
+        ScopedLatency latency(metrics.get(), IMetrics::HISTOGRAM_FILE_READ);
+        data = syncImpl->Read(Resolve(fileName));
+      }
+      if (metrics)
+      {
+        metrics->Increment(IMetrics::COUNTER_FILE_READS, 1);
+        metrics->Increment(IMetrics::COUNTER_FILE_BYTES_READ, data.size());
+      }
       callback(std::move(data), error);
       return;
     }
@@ -220,6 +231,7 @@ void DefaultFileSystem::Read(const std::string& fileName,
     {
       error =  "Unknown error while reading from " + fileName + " as " + Resolve(fileName);
     }
+    CountError(error);
     callback(IOBuffer(), error);
   });
 }
@@ -233,7 +245,15 @@ void DefaultFileSystem::Write(const std::string& fileName,
     std::string error;
     try
     {
-      syncImpl->Write(Resolve(fileName), data);
+      {
+        ScopedLatency latency(metrics.get(), IMetrics::HISTOGRAM_FILE_WRITE);
+        syncImpl->Write(Resolve(fileName), data);
+      }
+      if (metrics)
+      {
+        metrics->Increment(IMetrics::COUNTER_FILE_WRITES, 1);
+        metrics->Increment(IMetrics::COUNTER_FILE_BYTES_WRITTEN, data.size());
+      }
     }
     catch (std::exception& e)
     {
@@ -243,6 +263,7 @@ void DefaultFileSystem::Write(const std::string& fileName,
     {
       error = "Unknown error while writing to " + fileName + " as " + Resolve(fileName);
     }
+    CountError(error);
     callback(error);
   });
 }
@@ -266,6 +287,7 @@ void DefaultFileSystem::Move(const std::string& fromFileName,
     {
       error = "Unknown error while moving " + fromFileName + " to " + toFileName;
     }
+    CountError(error);
     callback(error);
   });
 }
@@ -288,6 +310,7 @@ void DefaultFileSystem::Remove(const std::string& fileName,
     {
       error = "Unknown error while removing " + fileName + " as " + Resolve(fileName);
     }
+    CountError(error);
     callback(error);
   });
 }
@@ -312,6 +335,7 @@ void DefaultFileSystem::Stat(const std::string& fileName,
     {
       error = "Unknown error while calling stat on " + fileName + " as " + Resolve(fileName);
     }
+    CountError(error);
     callback(StatResult(), error);
   });
 }
@@ -320,3 +344,9 @@ std::string DefaultFileSystem::Resolve(const std::string& fileName) const
 {
   return syncImpl->Resolve(fileName);
 }
+
+void DefaultFileSystem::CountError(const std::string& error) const
+{
+  if (metrics && !error.empty())
+    metrics->Increment(IMetrics::COUNTER_FILE_ERRORS, 1);
+}
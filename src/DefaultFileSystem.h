@@ -19,6 +19,7 @@
 #define ADBLOCK_PLUS_DEFAULT_FILE_SYSTEM_H
 
 #include <AdblockPlus/IFileSystem.h>
+#include <AdblockPlus/IMetrics.h>
 #include <AdblockPlus/Scheduler.h>
 
 #ifdef _WIN32
@@ -52,7 +53,8 @@ namespace AdblockPlus
   class DefaultFileSystem : public IFileSystem
   {
   public:
-    explicit DefaultFileSystem(const Scheduler& scheduler, std::unique_ptr<DefaultFileSystemSync> syncImpl);
+    explicit DefaultFileSystem(const Scheduler& scheduler, std::unique_ptr<DefaultFileSystemSync> syncImpl,
+      const MetricsPtr& metrics = MetricsPtr());
     void Read(const std::string& fileName,
               const ReadCallback& callback) const override;
     void Write(const std::string& fileName,
@@ -68,8 +70,10 @@ namespace AdblockPlus
   private:
     // Returns the absolute path to a file.
     std::string Resolve(const std::string& fileName) const;
+    void CountError(const std::string& error) const;
     Scheduler scheduler;
     std::unique_ptr<DefaultFileSystemSync> syncImpl;
+    MetricsPtr metrics;
   };
 }
 
@@ -0,0 +1,142 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus/DefaultMetrics.h>
+
+using namespace AdblockPlus;
+
+LatencyHistogram::LatencyHistogram()
+  : count(0), max(0)
+{
+  for (auto& bucket : buckets)
+    bucket = 0;
+}
+
+int LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+  if (value < SUB_BUCKET_COUNT)
+    return static_cast<int>(value);
+  int exponent = 0;
+  for (auto rest = value; rest > 1; rest >>= 1)
+    ++exponent;
+  // exponent >= 4, the sub-bucket is given by the four bits following the
+  // highest one.
+  int subBucket = static_cast<int>((value >> (exponent - 4)) & (SUB_BUCKET_COUNT - 1));
+  return SUB_BUCKET_COUNT * (exponent - 3) + subBucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(int index)
+{
+  if (index < SUB_BUCKET_COUNT)
+    return index;
+  int exponent = index / SUB_BUCKET_COUNT + 3;
+  uint64_t subBucket = index % SUB_BUCKET_COUNT;
+  uint64_t lowerBound = (SUB_BUCKET_COUNT + subBucket) << (exponent - 4);
+  return lowerBound + (uint64_t(1) << (exponent - 4)) - 1;
+}
+
+void LatencyHistogram::Record(std::chrono::microseconds value)
+{
+  uint64_t sample = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+  buckets[GetBucketIndex(sample)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  auto currentMax = max.load(std::memory_order_relaxed);
+  while (sample > currentMax &&
+    !max.compare_exchange_weak(currentMax, sample, std::memory_order_relaxed))
+  {
+  }
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+  return count.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds LatencyHistogram::GetMax() const
+{
+  return std::chrono::microseconds(max.load(std::memory_order_relaxed));
+}
+
+std::chrono::microseconds LatencyHistogram::GetPercentile(double percentile) const
+{
+  uint64_t total = 0;
+  for (const auto& bucket : buckets)
+    total += bucket.load(std::memory_order_relaxed);
+  if (total == 0)
+    return std::chrono::microseconds(0);
+  if (percentile < 0)
+    percentile = 0;
+  if (percentile > 100)
+    percentile = 100;
+  auto threshold = static_cast<uint64_t>(percentile / 100 * total + 0.5);
+  if (threshold == 0)
+    threshold = 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKET_COUNT; ++i)
+  {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen >= threshold)
+    {
+      auto upperBound = GetBucketUpperBound(i);
+      auto currentMax = max.load(std::memory_order_relaxed);
+      return std::chrono::microseconds(upperBound < currentMax ? upperBound : currentMax);
+    }
+  }
+  return GetMax();
+}
+
+void LatencyHistogram::Reset()
+{
+  for (auto& bucket : buckets)
+    bucket.store(0, std::memory_order_relaxed);
+  count.store(0, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
+
+DefaultMetrics::DefaultMetrics()
+{
+  for (auto& counter : counters)
+    counter = 0;
+}
+
+void DefaultMetrics::Increment(Counter counter, uint64_t value)
+{
+  counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void DefaultMetrics::Record(Histogram histogram, std::chrono::microseconds value)
+{
+  histograms[histogram].Record(value);
+}
+
+uint64_t DefaultMetrics::GetCounter(Counter counter) const
+{
+  return counters[counter].load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram& DefaultMetrics::GetHistogram(Histogram histogram) const
+{
+  return histograms[histogram];
+}
+
+void DefaultMetrics::Reset()
+{
+  for (auto& counter : counters)
+    counter.store(0, std::memory_order_relaxed);
+  for (auto& histogram : histograms)
+    histogram.Reset();
+}
@@ -16,12 +16,14 @@
 */
 
 #include "DefaultWebRequest.h"
+#include "ScopedLatency.h"
 #include <thread>
 
 using namespace AdblockPlus;
 
-DefaultWebRequest::DefaultWebRequest(const Scheduler& scheduler, WebRequestSyncPtr syncImpl)
-  : scheduler(scheduler), syncImpl(std::move(syncImpl))
+DefaultWebRequest::DefaultWebRequest(const Scheduler& scheduler, WebRequestSyncPtr syncImpl,
+  const MetricsPtr& metrics)
+  : scheduler(scheduler), syncImpl(std::move(syncImpl)), metrics(metrics)
 {
 
 }
@@ -35,6 +37,17 @@ void DefaultWebRequest::GET(const std::string& url, const HeaderList& requestHea
 {
   scheduler([this, url, requestHeaders, getCallback]
   {
-    getCallback(this->syncImpl->GET(url, requestHeaders));
+    ServerResponse response;
+    {
+      ScopedLatency latency(metrics.get(), IMetrics::HISTOGRAM_WEB_REQUEST);
+      response = this->syncImpl->GET(url, requestHeaders);
+    }
+    if (metrics)
+    {
+      metrics->Increment(IMetrics::COUNTER_WEB_REQUESTS, 1);
+      if (response.status != IWebRequest::NS_OK || response.responseStatus != 200)
+        metrics->Increment(IMetrics::COUNTER_WEB_REQUEST_FAILURES, 1);
+    }
+    getCallback(response);
   });
 }
\ No newline at end of file
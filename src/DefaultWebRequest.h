@@ -18,6 +18,7 @@
 #ifndef ADBLOCK_PLUS_DEFAULT_WEB_REQUEST_H
 #define ADBLOCK_PLUS_DEFAULT_WEB_REQUEST_H
 
+#include <AdblockPlus/IMetrics.h>
 #include <AdblockPlus/IWebRequest.h>
 #include <AdblockPlus/Scheduler.h>
 
@@ -37,13 +38,15 @@ namespace AdblockPlus
   class DefaultWebRequest : public IWebRequest
   {
   public:
-    explicit DefaultWebRequest(const Scheduler& scheduler, WebRequestSyncPtr syncImpl);
+    explicit DefaultWebRequest(const Scheduler& scheduler, WebRequestSyncPtr syncImpl,
+      const MetricsPtr& metrics = MetricsPtr());
     ~DefaultWebRequest();
 
     void GET(const std::string& url, const HeaderList& requestHeaders, const GetCallback& getCallback) override;
   private:
     Scheduler scheduler;
     WebRequestSyncPtr syncImpl;
+    MetricsPtr metrics;
   };
 }
 
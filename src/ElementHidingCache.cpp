@@ -0,0 +1,213 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ElementHidingCache.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  // approximate bookkeeping costs of an entry, the list node, the map node
+  // and the control blocks of the shared pointers.
+  const size_t entryOverhead = 128;
+  const size_t rulesOverhead = 64;
+
+  size_t GetStyleSheetSize(const std::string& key, const ElementHidingStyleSheet& styleSheet)
+  {
+    return entryOverhead + 2 * key.size() + styleSheet.selectors.size() +
+      styleSheet.offsets.size() * sizeof(size_t);
+  }
+
+  size_t GetEmulationSelectorsSize(const std::string& key,
+    const ElementHidingEmulationSelectors& emulationSelectors)
+  {
+    size_t size = entryOverhead + 2 * key.size() +
+      emulationSelectors.selectors.size() * sizeof(ElementHidingEmulationSelector);
+    for (const auto& emulationSelector : emulationSelectors.selectors)
+      size += emulationSelector.selector.size() + emulationSelector.text.size();
+    return size;
+  }
+
+  size_t GetRulesSize(const ElementHidingRules& rules)
+  {
+    return rulesOverhead + rules.rules.size() + rules.offsets.size() * sizeof(size_t);
+  }
+}
+
+ElementHidingCache::ElementHidingCache(size_t maxSize)
+  : maxSize(maxSize), size(0), generation(0)
+{
+}
+
+void ElementHidingCache::SetMaxSize(size_t value)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  maxSize = value;
+  EvictToMaxSize();
+}
+
+ElementHidingStyleSheetPtr ElementHidingCache::Get(Kind kind, const std::string& domain, uint64_t filterGeneration)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto entry = Find(kind, domain, filterGeneration);
+  return entry ? entry->styleSheet : ElementHidingStyleSheetPtr();
+}
+
+void ElementHidingCache::Put(Kind kind, const std::string& domain, const ElementHidingStyleSheetPtr& styleSheet)
+{
+  if (!styleSheet)
+    return;
+  Entry entry;
+  entry.key = GetKey(kind, domain);
+  entry.styleSheet = styleSheet;
+  entry.size = GetStyleSheetSize(entry.key, *styleSheet);
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(std::move(entry), styleSheet->filterGeneration);
+}
+
+ElementHidingRulesPtr ElementHidingCache::GetRules(Kind kind, const std::string& domain,
+  uint64_t filterGeneration, size_t groupSize)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto entry = Find(kind, domain, filterGeneration);
+  if (!entry)
+    return ElementHidingRulesPtr();
+  for (const auto& rules : entry->rules)
+  {
+    if (rules->groupSize == groupSize)
+      return rules;
+  }
+  return ElementHidingRulesPtr();
+}
+
+void ElementHidingCache::PutRules(Kind kind, const std::string& domain, const ElementHidingRulesPtr& rules)
+{
+  if (!rules)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto entry = Find(kind, domain, rules->filterGeneration);
+  if (!entry)
+    return;
+  for (const auto& cachedRules : entry->rules)
+  {
+    if (cachedRules->groupSize == rules->groupSize)
+      return;
+  }
+  size_t rulesSize = GetRulesSize(*rules);
+  entry->rules.push_back(rules);
+  entry->size += rulesSize;
+  size += rulesSize;
+  EvictToMaxSize();
+}
+
+ElementHidingEmulationSelectorsPtr ElementHidingCache::GetEmulationSelectors(const std::string& domain,
+  uint64_t filterGeneration)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto entry = Find(KIND_EMULATION, domain, filterGeneration);
+  return entry ? entry->emulationSelectors : ElementHidingEmulationSelectorsPtr();
+}
+
+void ElementHidingCache::PutEmulationSelectors(const std::string& domain,
+  const ElementHidingEmulationSelectorsPtr& emulationSelectors)
+{
+  if (!emulationSelectors)
+    return;
+  Entry entry;
+  entry.key = GetKey(KIND_EMULATION, domain);
+  entry.emulationSelectors = emulationSelectors;
+  entry.size = GetEmulationSelectorsSize(entry.key, *emulationSelectors);
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(std::move(entry), emulationSelectors->filterGeneration);
+}
+
+std::vector<ElementHidingCache::StyleSheetEntry> ElementHidingCache::GetRecentStyleSheets(
+  uint64_t filterGeneration, size_t maxCount)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<StyleSheetEntry> result;
+  if (generation != filterGeneration)
+    return result;
+  for (auto it = entries.begin(); it != entries.end() && result.size() < maxCount; ++it)
+  {
+    if (!it->styleSheet)
+      continue;
+    StyleSheetEntry styleSheetEntry;
+    styleSheetEntry.kind = static_cast<Kind>(it->key[0]);
+    styleSheetEntry.domain = it->key.substr(1);
+    styleSheetEntry.styleSheet = it->styleSheet;
+    result.push_back(std::move(styleSheetEntry));
+  }
+  return result;
+}
+
+std::string ElementHidingCache::GetKey(Kind kind, const std::string& domain)
+{
+  // domains never contain control characters.
+  return static_cast<char>(kind) + domain;
+}
+
+ElementHidingCache::Entry* ElementHidingCache::Find(Kind kind, const std::string& domain,
+  uint64_t filterGeneration)
+{
+  SetGeneration(filterGeneration);
+  if (generation != filterGeneration)
+    return nullptr;
+  auto it = index.find(GetKey(kind, domain));
+  if (it == index.end())
+    return nullptr;
+  entries.splice(entries.begin(), entries, it->second);
+  return &*it->second;
+}
+
+void ElementHidingCache::SetGeneration(uint64_t filterGeneration)
+{
+  if (filterGeneration <= generation)
+    return;
+  generation = filterGeneration;
+  entries.clear();
+  index.clear();
+  size = 0;
+}
+
+void ElementHidingCache::Insert(Entry&& entry, uint64_t filterGeneration)
+{
+  SetGeneration(filterGeneration);
+  if (generation != filterGeneration || entry.size > maxSize)
+    return;
+  auto it = index.find(entry.key);
+  if (it != index.end())
+  {
+    size -= it->second->size;
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  size += entry.size;
+  entries.push_front(std::move(entry));
+  index[entries.front().key] = entries.begin();
+  EvictToMaxSize();
+}
+
+void ElementHidingCache::EvictToMaxSize()
+{
+  while (size > maxSize && !entries.empty())
+  {
+    size -= entries.back().size;
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_ELEMENT_HIDING_CACHE_H
+#define ADBLOCK_PLUS_ELEMENT_HIDING_CACHE_H
+
+#include <AdblockPlus/FilterEngine.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Least recently used cache of element hiding results keyed by kind and
+   * domain, bounded by the approximate size of the cached data in bytes.
+   * The rules formatted from a style sheet are kept in the entry of the
+   * style sheet.
+   * All entries belong to the same filter generation, entries of an older
+   * generation are dropped as soon as a newer generation is seen.
+   */
+  class ElementHidingCache
+  {
+  public:
+    /**
+     * Kinds of cached style sheets, see `FilterEngine`.
+     */
+    enum Kind
+    {
+      /// All selectors of a domain.
+      KIND_ALL,
+      /// Unconditional generic selectors, the same for all domains.
+      KIND_GENERIC,
+      /// Selectors of a domain except for the unconditional ones.
+      KIND_DELTA,
+      /// Domain specific selectors of a domain.
+      KIND_SPECIFIC,
+      /// Element hiding emulation selectors of a domain.
+      KIND_EMULATION,
+      KIND_COUNT
+    };
+
+    struct StyleSheetEntry
+    {
+      Kind kind;
+      std::string domain;
+      ElementHidingStyleSheetPtr styleSheet;
+    };
+
+    explicit ElementHidingCache(size_t maxSize);
+
+    void SetMaxSize(size_t value);
+
+    /**
+     * @return Cached entry or `null` if there is none for the generation.
+     */
+    ElementHidingStyleSheetPtr Get(Kind kind, const std::string& domain, uint64_t filterGeneration);
+
+    void Put(Kind kind, const std::string& domain, const ElementHidingStyleSheetPtr& styleSheet);
+
+    /**
+     * @return Cached rules or `null` if there are none for the generation
+     *         and the group size.
+     */
+    ElementHidingRulesPtr GetRules(Kind kind, const std::string& domain,
+      uint64_t filterGeneration, size_t groupSize);
+
+    /**
+     * Adds the rules to the entry of their style sheet, they are not cached
+     * if the style sheet is not.
+     */
+    void PutRules(Kind kind, const std::string& domain, const ElementHidingRulesPtr& rules);
+
+    /**
+     * @return Cached emulation selectors or `null` if there are none for the
+     *         generation.
+     */
+    ElementHidingEmulationSelectorsPtr GetEmulationSelectors(const std::string& domain,
+      uint64_t filterGeneration);
+
+    void PutEmulationSelectors(const std::string& domain,
+      const ElementHidingEmulationSelectorsPtr& emulationSelectors);
+
+    /**
+     * @return Cached style sheets of the generation, the most recently used
+     *         first.
+     */
+    std::vector<StyleSheetEntry> GetRecentStyleSheets(uint64_t filterGeneration, size_t maxCount);
+
+  private:
+    struct Entry
+    {
+      std::string key;
+      ElementHidingStyleSheetPtr styleSheet;
+      std::vector<ElementHidingRulesPtr> rules;
+      ElementHidingEmulationSelectorsPtr emulationSelectors;
+      size_t size;
+    };
+    typedef std::list<Entry> Entries;
+
+    static std::string GetKey(Kind kind, const std::string& domain);
+    // Require the mutex to be locked.
+    Entry* Find(Kind kind, const std::string& domain, uint64_t filterGeneration);
+    void SetGeneration(uint64_t filterGeneration);
+    void Insert(Entry&& entry, uint64_t filterGeneration);
+    void EvictToMaxSize();
+
+    std::mutex mutex;
+    size_t maxSize;
+    size_t size;
+    uint64_t generation;
+    // the most recently used entry is at the front.
+    Entries entries;
+    std::unordered_map<std::string, Entries::iterator> index;
+  };
+}
+
+#endif
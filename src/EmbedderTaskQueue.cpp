@@ -0,0 +1,172 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EmbedderTaskQueue.h"
+#include <limits>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class EmbedderTimer : public ITimer
+  {
+  public:
+    explicit EmbedderTimer(const std::weak_ptr<EmbedderTaskQueue>& queue)
+      : queue(queue)
+    {
+    }
+
+    void SetTimer(const std::chrono::milliseconds& timeout, const TimerCallback& timerCallback) override
+    {
+      if (!timerCallback)
+        return;
+      if (auto lockedQueue = queue.lock())
+        lockedQueue->PostDelayed(timeout, timerCallback);
+    }
+
+  private:
+    std::weak_ptr<EmbedderTaskQueue> queue;
+  };
+}
+
+EmbedderTaskQueue::EmbedderTaskQueue()
+  : timersCount(0)
+{
+}
+
+void EmbedderTaskQueue::Post(const SchedulerTask& task)
+{
+  if (!task)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    readyTasks.push_back(task);
+  }
+  hasTasks.notify_all();
+}
+
+void EmbedderTaskQueue::PostDelayed(const std::chrono::milliseconds& delay, const SchedulerTask& task)
+{
+  if (!task)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    timers[TimerKey(Clock::now() + delay, timersCount++)] = task;
+  }
+  hasTasks.notify_all();
+}
+
+size_t EmbedderTaskQueue::Poll()
+{
+  std::deque<SchedulerTask> tasks;
+  std::thread::id previousPollingThread;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    TakeExpiredTimers(Clock::now());
+    tasks.swap(readyTasks);
+    previousPollingThread = pollingThread;
+    pollingThread = std::this_thread::get_id();
+  }
+  for (auto& task : tasks)
+  {
+    try
+    {
+      task();
+    }
+    catch (...)
+    {
+      // do nothing, the remaining tasks should run anyway.
+    }
+    // release what the task holds before the next one starts.
+    task = SchedulerTask();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pollingThread = previousPollingThread;
+  }
+  return tasks.size();
+}
+
+size_t EmbedderTaskQueue::RunUntilIdle()
+{
+  size_t executedTasks = 0;
+  while (size_t polledTasks = Poll())
+    executedTasks += polledTasks;
+  return executedTasks;
+}
+
+void EmbedderTaskQueue::WaitForTask()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    TakeExpiredTimers(Clock::now());
+    if (!readyTasks.empty())
+      return;
+    if (timers.empty())
+      hasTasks.wait(lock);
+    else
+      hasTasks.wait_until(lock, timers.begin()->first.first);
+  }
+}
+
+std::chrono::milliseconds EmbedderTaskQueue::GetTimeUntilNextTask() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!readyTasks.empty())
+    return std::chrono::milliseconds::zero();
+  if (timers.empty())
+    return std::chrono::milliseconds::max();
+  auto now = Clock::now();
+  auto fireAt = timers.begin()->first.first;
+  if (fireAt <= now)
+    return std::chrono::milliseconds::zero();
+  // round up, otherwise the timer is not expired yet after the wait.
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(fireAt - now);
+  if (now + delay < fireAt)
+    ++delay;
+  return delay;
+}
+
+bool EmbedderTaskQueue::IsPollingOnCurrentThread() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return pollingThread == std::this_thread::get_id();
+}
+
+Scheduler EmbedderTaskQueue::GetScheduler()
+{
+  std::weak_ptr<EmbedderTaskQueue> weakQueue = shared_from_this();
+  return [weakQueue](const SchedulerTask& task)
+  {
+    if (auto queue = weakQueue.lock())
+      queue->Post(task);
+  };
+}
+
+TimerPtr EmbedderTaskQueue::CreateTimer()
+{
+  return TimerPtr(new EmbedderTimer(shared_from_this()));
+}
+
+void EmbedderTaskQueue::TakeExpiredTimers(Clock::time_point now)
+{
+  auto end = timers.upper_bound(TimerKey(now, std::numeric_limits<uint64_t>::max()));
+  for (auto it = timers.begin(); it != end; ++it)
+    readyTasks.push_back(std::move(it->second));
+  timers.erase(timers.begin(), end);
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_EMBEDDER_TASK_QUEUE_H
+#define ADBLOCK_PLUS_EMBEDDER_TASK_QUEUE_H
+
+#include <AdblockPlus/ITimer.h>
+#include <AdblockPlus/Scheduler.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+
+namespace AdblockPlus
+{
+  /**
+   * Queue of tasks and timers of the embedder-driven platform. Nothing is
+   * run by the queue itself, the tasks are run on the thread calling
+   * `Poll()`. Ready tasks run in the order they are posted, timers in the
+   * order of their expiration and of setting for equal expiration times.
+   */
+  class EmbedderTaskQueue : public std::enable_shared_from_this<EmbedderTaskQueue>
+  {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    EmbedderTaskQueue();
+
+    void Post(const SchedulerTask& task);
+    void PostDelayed(const std::chrono::milliseconds& delay, const SchedulerTask& task);
+
+    /**
+     * Runs the tasks which are ready at the moment of the call, the tasks
+     * posted meanwhile are left for the next call.
+     * @return Number of executed tasks.
+     */
+    size_t Poll();
+
+    /**
+     * Calls `Poll()` until there are no ready tasks.
+     * @return Number of executed tasks.
+     */
+    size_t RunUntilIdle();
+
+    /**
+     * Blocks until a task is ready, either posted by another thread or
+     * because a timer has expired.
+     */
+    void WaitForTask();
+
+    /**
+     * @return Time until the next task is ready, zero if there is a ready
+     *         task and `std::chrono::milliseconds::max()` if there is none.
+     */
+    std::chrono::milliseconds GetTimeUntilNextTask() const;
+
+    /**
+     * @return Whether the calling thread is running `Poll()`.
+     */
+    bool IsPollingOnCurrentThread() const;
+
+    /**
+     * @return Scheduler posting to the queue as long as the queue exists.
+     */
+    Scheduler GetScheduler();
+
+    /**
+     * @return Timer setting the timers of the queue as long as the queue
+     *         exists.
+     */
+    TimerPtr CreateTimer();
+
+  private:
+    EmbedderTaskQueue(const EmbedderTaskQueue&);
+    EmbedderTaskQueue& operator=(const EmbedderTaskQueue&);
+
+    // Moves expired timers to readyTasks, requires the mutex to be locked.
+    void TakeExpiredTimers(Clock::time_point now);
+
+    typedef std::pair<Clock::time_point, uint64_t> TimerKey;
+    mutable std::mutex mutex;
+    std::condition_variable hasTasks;
+    std::deque<SchedulerTask> readyTasks;
+    std::map<TimerKey, SchedulerTask> timers;
+    uint64_t timersCount;
+    std::thread::id pollingThread;
+  };
+}
+
+#endif
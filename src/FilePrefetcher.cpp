@@ -0,0 +1,164 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FilePrefetcher.h"
+#include "FilterLineParser.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  inline bool IsEndOfLine(uint8_t c)
+  {
+    return c == 10 || c == 13;
+  }
+}
+
+bool AdblockPlus::SplitNextLine(const IFileSystem::IOBuffer& content, uint32_t& offset,
+  std::pair<uint32_t, uint32_t>& line)
+{
+  uint32_t size = static_cast<uint32_t>(content.size());
+  while (offset < size && IsEndOfLine(content[offset]))
+    ++offset;
+  if (offset >= size)
+    return false;
+  line.first = offset;
+  while (offset < size && !IsEndOfLine(content[offset]))
+    ++offset;
+  line.second = offset;
+  return true;
+}
+
+TokenizedFilePtr AdblockPlus::TokenizeFile(IFileSystem::IOBuffer&& content, const std::string& error,
+  unsigned threadCount)
+{
+  auto file = std::make_shared<TokenizedFile>();
+  file->content = std::move(content);
+  file->error = error;
+  uint32_t offset = 0;
+  std::pair<uint32_t, uint32_t> line;
+  while (SplitNextLine(file->content, offset, line))
+    file->lines.push_back(line);
+  if (file->lines.empty())
+    file->lines.emplace_back(0, 0);
+  else
+    FindFilterKeywords(*file, threadCount);
+  return file;
+}
+
+FilePrefetcher::FilePrefetcher()
+  : readId(0)
+{
+}
+
+void FilePrefetcher::Start(IFileSystem& fileSystem, const std::string& fileName, unsigned threadCount)
+{
+  uint64_t currentReadId;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!this->fileName.empty())
+      return;
+    this->fileName = fileName;
+    currentReadId = ++readId;
+  }
+  std::weak_ptr<FilePrefetcher> weakSelf = shared_from_this();
+  try
+  {
+    fileSystem.Read(fileName, [weakSelf, currentReadId, threadCount](IFileSystem::IOBuffer&& content, const std::string& error)
+    {
+      // tokenize on the thread of the file system, not on the JS one.
+      auto file = TokenizeFile(std::move(content), error, threadCount);
+      if (auto self = weakSelf.lock())
+        self->OnRead(currentReadId, file);
+    });
+  }
+  catch (...)
+  {
+    // the file is read as usual then, which reports the error.
+    Discard(fileName);
+  }
+}
+
+bool FilePrefetcher::Take(const std::string& fileName, const Callback& callback)
+{
+  TokenizedFilePtr takenFile;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (this->fileName.empty() || this->fileName != fileName || this->callback)
+      return false;
+    if (!file)
+    {
+      this->callback = callback;
+      return true;
+    }
+    takenFile = std::move(file);
+    this->fileName.clear();
+  }
+  callback(takenFile);
+  return true;
+}
+
+void FilePrefetcher::Discard(const std::string& fileName)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  // a file being waited for is already handed over.
+  if (this->fileName != fileName || callback)
+    return;
+  this->fileName.clear();
+  file.reset();
+  ++readId;
+}
+
+void FilePrefetcher::ObserveNextRead(const std::string& fileName, const Callback& observer)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  observedFileName = fileName;
+  this->observer = observer;
+}
+
+void FilePrefetcher::NotifyRead(const std::string& fileName, const TokenizedFilePtr& readFile)
+{
+  Callback takenObserver;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!observer || observedFileName != fileName)
+      return;
+    takenObserver = std::move(observer);
+    observer = Callback();
+    observedFileName.clear();
+  }
+  takenObserver(readFile);
+}
+
+void FilePrefetcher::OnRead(uint64_t currentReadId, const TokenizedFilePtr& readFile)
+{
+  Callback takenCallback;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (currentReadId != readId || fileName.empty())
+      return;
+    if (!callback)
+    {
+      file = readFile;
+      return;
+    }
+    takenCallback = std::move(callback);
+    callback = Callback();
+    fileName.clear();
+  }
+  takenCallback(readFile);
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILE_PREFETCHER_H
+#define ADBLOCK_PLUS_FILE_PREFETCHER_H
+
+#include <AdblockPlus/IFileSystem.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Content of a read file split into lines.
+   */
+  struct TokenizedFile
+  {
+    IFileSystem::IOBuffer content;
+    /**
+     * Begin and end offsets of the lines in `content`, line breaks and empty
+     * lines are skipped. An empty file results in a single empty line.
+     */
+    std::vector<std::pair<uint32_t, uint32_t>> lines;
+    /**
+     * Keywords for the matcher of the filters in "[Subscription filters]"
+     * sections by line, see FindFilterKeywords(). Empty if there are no
+     * such sections.
+     */
+    std::vector<std::pair<uint32_t, uint32_t>> keywords;
+    /**
+     * Error of reading the file, empty on success.
+     */
+    std::string error;
+  };
+
+  typedef std::shared_ptr<const TokenizedFile> TokenizedFilePtr;
+
+  /**
+   * Finds the next line at or after `offset` in `content`, skipping line
+   * breaks, and moves `offset` past it.
+   * @return `false` if there is no further line.
+   */
+  bool SplitNextLine(const IFileSystem::IOBuffer& content, uint32_t& offset,
+    std::pair<uint32_t, uint32_t>& line);
+
+  /**
+   * Splits the content into lines and finds the keywords of the filters
+   * in it, see FindFilterKeywords() for `threadCount`.
+   */
+  TokenizedFilePtr TokenizeFile(IFileSystem::IOBuffer&& content, const std::string& error,
+    unsigned threadCount);
+
+  /**
+   * Reads and tokenizes a file in advance, e.g.\ patterns.ini while the
+   * scripts are being evaluated, and hands it over to its first reader.
+   * It also passes the next read content of a file to an observer.
+   */
+  class FilePrefetcher : public std::enable_shared_from_this<FilePrefetcher>
+  {
+  public:
+    typedef std::function<void(const TokenizedFilePtr&)> Callback;
+
+    FilePrefetcher();
+
+    /**
+     * Starts reading the file unless a file is already prefetched.
+     * @param threadCount Passed to TokenizeFile().
+     */
+    void Start(IFileSystem& fileSystem, const std::string& fileName, unsigned threadCount);
+
+    /**
+     * Takes over the prefetched file, the callback is called as soon as it
+     * is read, possibly immediately.
+     * @return `false` if the file is not prefetched, then the callback is
+     *         not called.
+     */
+    bool Take(const std::string& fileName, const Callback& callback);
+
+    /**
+     * Drops the prefetched file, e.g.\ because it is being changed.
+     */
+    void Discard(const std::string& fileName);
+
+    /**
+     * Sets a callback which is called once with the content of the file
+     * when it is read by the scripts next time, before they process it.
+     */
+    void ObserveNextRead(const std::string& fileName, const Callback& observer);
+
+    /**
+     * Called by the readers of the scripts, see ObserveNextRead().
+     */
+    void NotifyRead(const std::string& fileName, const TokenizedFilePtr& readFile);
+
+  private:
+    void OnRead(uint64_t currentReadId, const TokenizedFilePtr& readFile);
+
+    std::mutex mutex;
+    std::string fileName;
+    // identifies the current read, reads of discarded files are ignored.
+    uint64_t readId;
+    TokenizedFilePtr file;
+    Callback callback;
+    std::string observedFileName;
+    Callback observer;
+  };
+}
+
+#endif
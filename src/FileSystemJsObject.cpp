@@ -16,12 +16,18 @@
  */
 
 #include <AdblockPlus/IFileSystem.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <memory>
 #include <stdexcept>
 #include <sstream>
 #include <vector>
 
 #include <AdblockPlus/JsValue.h>
+#include "FilePrefetcher.h"
 #include "FileSystemJsObject.h"
+#include "FilterLineParser.h"
 #include "JsContext.h"
 #include "Utils.h"
 #include "JsError.h"
@@ -55,38 +61,147 @@ namespace
           [weakJsEngine, weakCallback]
           (IFileSystem::IOBuffer&& content, const std::string& error)
           {
-            auto jsEngine = weakJsEngine.lock();
-            if (!jsEngine)
-              return;
-
-            const JsContext context(*jsEngine);
-            auto result = jsEngine->NewObject();
-            result.SetStringBufferProperty("content", std::move(content));
-            if (!error.empty())
-              result.SetProperty("error", error);
-            jsEngine->TakeJsValues(weakCallback)[0].Call(result);
+            auto sharedContent = std::make_shared<IFileSystem::IOBuffer>(std::move(content));
+            JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, sharedContent, error]
+            {
+              auto jsEngine = weakJsEngine.lock();
+              if (!jsEngine)
+                return;
+
+              const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+              auto result = jsEngine->NewObject();
+              result.SetStringBufferProperty("content", std::move(*sharedContent));
+              if (!error.empty())
+                result.SetProperty("error", error);
+              jsEngine->TakeJsValues(weakCallback)[0].Call(result);
+            });
           });
       });
   }
 
-  inline bool IsEndOfLine(char c)
-  {
-    return c == 10 || c == 13;
-  }
-
-  inline StringBuffer::const_iterator SkipEndOfLine(StringBuffer::const_iterator ii, StringBuffer::const_iterator end)
+  /**
+   * Passes the lines of a read file to the listener of
+   * `_fileSystem.readFromFile` and calls the done callback afterwards.
+   * Lines of filters with a known keyword are passed with the keyword as
+   * the second argument.
+   * If a slice duration is set for the engine the lines are processed in
+   * slices of that duration, between them the engine is unlocked and the
+   * processing is resumed by a timer task.
+   * A file without lines is not tokenized, its lines are split while they
+   * are processed and passed without keywords.
+   */
+  class LinesProcessor : public std::enable_shared_from_this<LinesProcessor>
   {
-    while (ii != end && IsEndOfLine(*ii))
-      ++ii;
-    return ii;
-  }
-
-  inline StringBuffer::const_iterator AdvanceToEndOfLine(StringBuffer::const_iterator ii, StringBuffer::const_iterator end)
-  {
-    while (ii != end && !IsEndOfLine(*ii))
-      ++ii;
-    return ii;
-  }
+  public:
+    LinesProcessor(const std::weak_ptr<JsEngine>& weakJsEngine,
+      const JsEngine::JsWeakValuesID& callbacksID, const TokenizedFilePtr& file)
+      : weakJsEngine(weakJsEngine), callbacksID(callbacksID)
+      , file(file), lineIndex(0), isSplitting(file->lines.empty()), offset(0)
+      , hasNextLine(false)
+    {
+      // like TokenizeFile() an empty content results in an empty line.
+      if (isSplitting && !SplitNextLine(file->content, offset, nextLine))
+        nextLine = std::make_pair(0, 0);
+    }
+
+    void ProcessSlice()
+    {
+      auto jsEngine = weakJsEngine.lock();
+      if (!jsEngine)
+        return;
+
+      const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+      auto jsValues = jsEngine->TakeJsValues(callbacksID);
+      auto processFunc = jsValues[0].UnwrapValue().As<v8::Function>();
+
+      auto globalContext = context.GetV8Context()->Global();
+      if (!globalContext->IsObject())
+        throw std::runtime_error("`this` pointer has to be an object");
+
+      auto sliceDuration = jsEngine->GetFileParsingSliceDuration();
+      auto sliceEnd = std::chrono::steady_clock::now() + sliceDuration;
+
+      const v8::TryCatch tryCatch;
+
+      const auto contentBegin = file->content.cbegin();
+      const auto& keywords = file->keywords;
+      // A tokenized file has at least one line.
+      do
+      {
+        const auto line = TakeLine();
+        v8::Local<v8::Value> jsArgs[2];
+        jsArgs[0] = Utils::StringBufferToV8String(jsEngine->GetIsolate(),
+          StringBuffer(contentBegin + line.first, contentBegin + line.second));
+        int argc = 1;
+        if (!keywords.empty() && keywords[lineIndex].first != NO_KEYWORD)
+        {
+          const auto& keyword = keywords[lineIndex];
+          // lower cased like the matcher of the core does.
+          std::string keywordText(contentBegin + keyword.first, contentBegin + keyword.second);
+          std::transform(keywordText.begin(), keywordText.end(), keywordText.begin(), ::tolower);
+          jsArgs[argc++] = Utils::ToV8String(jsEngine->GetIsolate(), keywordText);
+        }
+        processFunc->Call(globalContext, argc, jsArgs);
+        if (tryCatch.HasCaught())
+        {
+          jsValues[1].Call(jsEngine->NewValue(JsError::ExceptionToString(tryCatch.Exception(), tryCatch.Message())));
+          return;
+        }
+        ++lineIndex;
+        if (sliceDuration.count() > 0 && HasMoreLines() &&
+            std::chrono::steady_clock::now() >= sliceEnd)
+        {
+          ScheduleNextSlice(*jsEngine, jsValues);
+          return;
+        }
+      } while (HasMoreLines());
+      jsValues[1].Call();
+    }
+
+  private:
+    bool HasMoreLines() const
+    {
+      if (isSplitting)
+        return lineIndex == 0 || hasNextLine;
+      return lineIndex < file->lines.size();
+    }
+
+    // lineIndex is advanced by the caller.
+    std::pair<uint32_t, uint32_t> TakeLine()
+    {
+      if (!isSplitting)
+        return file->lines[lineIndex];
+      auto line = nextLine;
+      hasNextLine = SplitNextLine(file->content, offset, nextLine);
+      return line;
+    }
+
+    void ScheduleNextSlice(JsEngine& jsEngine, const JsValueList& jsValues)
+    {
+      callbacksID = jsEngine.StoreJsValues(jsValues);
+      auto self = shared_from_this();
+      jsEngine.GetPlatform().WithTimer([self](ITimer& timer)
+      {
+        timer.SetTimer(std::chrono::milliseconds(0), [self]
+        {
+          JsEngine::Dispatch(self->weakJsEngine, [self]
+          {
+            self->ProcessSlice();
+          });
+        });
+      });
+    }
+
+    std::weak_ptr<JsEngine> weakJsEngine;
+    JsEngine::JsWeakValuesID callbacksID;
+    TokenizedFilePtr file;
+    size_t lineIndex;
+    bool isSplitting;
+    // position of the line after nextLine if isSplitting.
+    uint32_t offset;
+    std::pair<uint32_t, uint32_t> nextLine;
+    bool hasNextLine;
+  };
 
   void ReadFromFileCallback(const v8::FunctionCallbackInfo<v8::Value>& arguments)
   {
@@ -107,49 +222,35 @@ namespace
     auto weakCallback = jsEngine->StoreJsValues(values);
     std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
     auto fileName = converted[0].AsString();
+    auto onRead = [weakJsEngine, weakCallback, fileName](const TokenizedFilePtr& file)
+    {
+      if (auto jsEngine = weakJsEngine.lock())
+        jsEngine->GetPlatform().GetFilePrefetcher().NotifyRead(fileName, file);
+      JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, file]
+      {
+        if (!file->error.empty())
+        {
+          auto jsEngine = weakJsEngine.lock();
+          if (!jsEngine)
+            return;
+          const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+          jsEngine->TakeJsValues(weakCallback)[1].Call(jsEngine->NewValue(file->error));
+          return;
+        }
+        std::make_shared<LinesProcessor>(weakJsEngine, weakCallback, file)->ProcessSlice();
+      });
+    };
+    if (jsEngine->GetPlatform().GetFilePrefetcher().Take(fileName, onRead))
+      return;
+    auto threadCount = jsEngine->GetPlatform().GetFilterParsingThreadCount();
     jsEngine->GetPlatform().WithFileSystem(
-      [weakJsEngine, weakCallback, fileName](IFileSystem& fileSystem)
+      [onRead, fileName, threadCount](IFileSystem& fileSystem)
       {
         fileSystem.Read(fileName,
-          [weakJsEngine, weakCallback]
-          (IFileSystem::IOBuffer&& content, const std::string& error)
+          [onRead, threadCount](IFileSystem::IOBuffer&& content, const std::string& error)
           {
-            auto jsEngine = weakJsEngine.lock();
-            if (!jsEngine)
-              return;
-
-            const JsContext context(*jsEngine);
-
-            auto jsValues = jsEngine->TakeJsValues(weakCallback);
-            if (!error.empty())
-            {
-              jsValues[1].Call(jsEngine->NewValue(error));
-              return;
-            }
-
-            auto processFunc = jsValues[0].UnwrapValue().As<v8::Function>();
-
-            auto globalContext = context.GetV8Context()->Global();
-            if (!globalContext->IsObject())
-              throw std::runtime_error("`this` pointer has to be an object");
-
-            const v8::TryCatch tryCatch;
-
-            const auto contentEnd = content.cend();
-            auto stringBegin = SkipEndOfLine(content.begin(), contentEnd);
-            do
-            {
-              auto stringEnd = AdvanceToEndOfLine(stringBegin, contentEnd);
-              auto jsLine = Utils::StringBufferToV8String(jsEngine->GetIsolate(), StringBuffer(stringBegin, stringEnd)).As<v8::Value>();
-              processFunc->Call(globalContext, 1, &jsLine);
-              if (tryCatch.HasCaught())
-              {
-                jsValues[1].Call(jsEngine->NewValue(JsError::ExceptionToString(tryCatch.Exception(), tryCatch.Message())));
-                return;
-              }
-              stringBegin = SkipEndOfLine(stringEnd, contentEnd);
-            } while (stringBegin != contentEnd);
-            jsValues[1].Call();
+            // split the lines on the thread of the file system.
+            onRead(TokenizeFile(std::move(content), error, threadCount));
           });
       });
   }
@@ -171,21 +272,25 @@ namespace
     std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
     auto content = converted[1].AsStringBuffer();
     auto fileName = converted[0].AsString();
+    jsEngine->GetPlatform().GetFilePrefetcher().Discard(fileName);
     jsEngine->GetPlatform().WithFileSystem(
       [weakJsEngine, weakCallback, fileName, content](IFileSystem& fileSystem)
       {
         fileSystem.Write(fileName, content,
           [weakJsEngine, weakCallback](const std::string& error)
           {
-            auto jsEngine = weakJsEngine.lock();
-            if (!jsEngine)
-              return;
-
-            const JsContext context(*jsEngine);
-            JsValueList params;
-            if (!error.empty())
-              params.push_back(jsEngine->NewValue(error));
-            jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, error]
+            {
+              auto jsEngine = weakJsEngine.lock();
+              if (!jsEngine)
+                return;
+
+              const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+              JsValueList params;
+              if (!error.empty())
+                params.push_back(jsEngine->NewValue(error));
+              jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            });
           });
       });
   }
@@ -207,21 +312,26 @@ namespace
     std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
     auto from = converted[0].AsString();
     auto to = converted[1].AsString();
+    jsEngine->GetPlatform().GetFilePrefetcher().Discard(from);
+    jsEngine->GetPlatform().GetFilePrefetcher().Discard(to);
     jsEngine->GetPlatform().WithFileSystem(
       [weakJsEngine, weakCallback, from, to](IFileSystem& fileSystem)
       {
         fileSystem.Move(from, to,
           [weakJsEngine, weakCallback](const std::string& error)
           {
-            auto jsEngine = weakJsEngine.lock();
-            if (!jsEngine)
-              return;
-
-            const JsContext context(*jsEngine);
-            JsValueList params;
-            if (!error.empty())
-              params.push_back(jsEngine->NewValue(error));
-            jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, error]
+            {
+              auto jsEngine = weakJsEngine.lock();
+              if (!jsEngine)
+                return;
+
+              const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+              JsValueList params;
+              if (!error.empty())
+                params.push_back(jsEngine->NewValue(error));
+              jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            });
           });
       });
   }
@@ -242,21 +352,25 @@ namespace
     auto weakCallback = jsEngine->StoreJsValues(values);
     std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
     auto fileName = converted[0].AsString();
+    jsEngine->GetPlatform().GetFilePrefetcher().Discard(fileName);
     jsEngine->GetPlatform().WithFileSystem(
       [weakJsEngine, weakCallback, fileName](IFileSystem& fileSystem)
       {
         fileSystem.Remove(fileName,
           [weakJsEngine, weakCallback](const std::string& error)
           {
-            auto jsEngine = weakJsEngine.lock();
-            if (!jsEngine)
-              return;
-
-            const JsContext context(*jsEngine);
-            JsValueList params;
-            if (!error.empty())
-              params.push_back(jsEngine->NewValue(error));
-            jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, error]
+            {
+              auto jsEngine = weakJsEngine.lock();
+              if (!jsEngine)
+                return;
+
+              const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+              JsValueList params;
+              if (!error.empty())
+                params.push_back(jsEngine->NewValue(error));
+              jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+            });
           });
       });
   }
@@ -284,27 +398,60 @@ namespace
            [weakJsEngine, weakCallback]
            (const IFileSystem::StatResult& statResult, const std::string& error)
            {
-             auto jsEngine = weakJsEngine.lock();
-             if (!jsEngine)
-               return;
-
-             const JsContext context(*jsEngine);
-             auto result = jsEngine->NewObject();
-
-             result.SetProperty("exists", statResult.exists);
-             result.SetProperty("lastModified", statResult.lastModified);
-             if (!error.empty())
-               result.SetProperty("error", error);
-
-             JsValueList params;
-             params.push_back(result);
-             jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+             JsEngine::Dispatch(weakJsEngine, [weakJsEngine, weakCallback, statResult, error]
+             {
+               auto jsEngine = weakJsEngine.lock();
+               if (!jsEngine)
+                 return;
+
+               const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_FILE_SYSTEM);
+               auto result = jsEngine->NewObject();
+
+               result.SetProperty("exists", statResult.exists);
+               result.SetProperty("lastModified", statResult.lastModified);
+               if (!error.empty())
+                 result.SetProperty("error", error);
+
+               JsValueList params;
+               params.push_back(result);
+               jsEngine->TakeJsValues(weakCallback)[0].Call(params);
+             });
            });
       });
   }
 }
 
 
+void FileSystemJsObject::ProcessLines(const v8::FunctionCallbackInfo<v8::Value>& arguments)
+{
+  AdblockPlus::JsEnginePtr jsEngine = AdblockPlus::JsEngine::FromArguments(arguments);
+  AdblockPlus::JsValueList converted = jsEngine->ConvertArguments(arguments);
+
+  v8::Isolate* isolate = arguments.GetIsolate();
+  if (converted.size() != 3)
+    return ThrowExceptionInJS(isolate, "_processLines requires 3 parameters");
+  if (!converted[1].IsFunction())
+    return ThrowExceptionInJS(isolate, "Second argument to _processLines must be a function (listener callback)");
+  if (!converted[2].IsFunction())
+    return ThrowExceptionInJS(isolate, "Third argument to _processLines must be a function (done callback)");
+
+  // processing the lines at once has no advantage over processing the
+  // text, the caller does that then.
+  if (jsEngine->GetFileParsingSliceDuration().count() == 0)
+    return arguments.GetReturnValue().Set(false);
+
+  // the lines are split slice by slice, tokenizing the whole text here
+  // would keep the engine locked.
+  auto file = std::make_shared<TokenizedFile>();
+  file->content = converted[0].AsStringBuffer();
+  JsValueList values;
+  values.push_back(converted[1]);
+  values.push_back(converted[2]);
+  auto weakCallback = jsEngine->StoreJsValues(values);
+  std::make_shared<LinesProcessor>(jsEngine, weakCallback, file)->ProcessSlice();
+  arguments.GetReturnValue().Set(true);
+}
+
 JsValue& FileSystemJsObject::Setup(JsEngine& jsEngine, JsValue& obj)
 {
   obj.SetProperty("read", jsEngine.NewCallback(::ReadCallback));
@@ -25,6 +25,15 @@ namespace AdblockPlus
   namespace FileSystemJsObject
   {
     JsValue& Setup(JsEngine& jsEngine, JsValue& obj);
+
+    /**
+     * Callback of `_processLines(text, listener, done)`, it passes the lines
+     * of the text to the listener in slices like `_fileSystem.readFromFile`
+     * does, but without keywords. The lines are split slice by slice.
+     * It returns `false` and doesn't call the callbacks if no slice
+     * duration is set.
+     */
+    void ProcessLines(const v8::FunctionCallbackInfo<v8::Value>& arguments);
   }
 }
 
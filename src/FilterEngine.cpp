@@ -16,15 +16,24 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <cassert>
 #include <thread>
 
 #include <AdblockPlus.h>
+#include <AdblockPlus/Platform.h>
+#include "ElementHidingCache.h"
+#include "FilePrefetcher.h"
 #include "JsContext.h"
+#include "MatchDecisionCache.h"
+#include "ScopedLatency.h"
+#include "StartupTimelineRecorder.h"
 #include "Thread.h"
+#include "WarmCache.h"
 #include <mutex>
 #include <condition_variable>
 
@@ -32,6 +41,31 @@ using namespace AdblockPlus;
 
 extern std::string jsSources[];
 
+namespace
+{
+  void ApplyMemoryPressurePolicy(JsEngine& jsEngine,
+    const FilterEngine::MemoryPressurePolicy& policy)
+  {
+    typedef FilterEngine::MemoryPressurePolicy Policy;
+    const JsContext context(jsEngine, JsEngine::LOCK_CATEGORY_GC);
+    v8::Isolate* isolate = jsEngine.GetIsolate();
+    FilterEngine::MemoryPressureReport report;
+    report.usedHeapSizeBefore = jsEngine.GetHeapStatistics().usedHeapSize;
+    if (policy.mode == Policy::MODE_NEVER ||
+        (policy.mode == Policy::MODE_HEAP_THRESHOLD && report.usedHeapSizeBefore < policy.heapThreshold))
+      return;
+
+    auto start = std::chrono::steady_clock::now();
+    isolate->MemoryPressureNotification(policy.level == Policy::LEVEL_CRITICAL ?
+      v8::MemoryPressureLevel::kCritical : v8::MemoryPressureLevel::kModerate);
+    report.gcPause = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+    report.usedHeapSizeAfter = jsEngine.GetHeapStatistics().usedHeapSize;
+    if (policy.reportCallback)
+      policy.reportCallback(report);
+  }
+}
+
 Filter::Filter(JsValue&& value)
     : JsValue(std::move(value))
 {
@@ -145,7 +179,10 @@ bool Subscription::IsDisabled() const
 
 void Subscription::SetDisabled(bool value)
 {
-  return SetProperty("disabled", value);
+  JsValueList params;
+  params.push_back(*this);
+  params.push_back(jsEngine->NewValue(value));
+  jsEngine->Evaluate("API.setSubscriptionDisabled").Call(params);
 }
 
 void Subscription::AddToList()
@@ -182,8 +219,149 @@ bool Subscription::operator==(const Subscription& subscription) const
   return GetProperty("url").AsString() == subscription.GetProperty("url").AsString();
 }
 
+namespace
+{
+  const size_t defaultElementHidingCacheSize = 8 * 1024 * 1024;
+  const size_t matchDecisionCacheCount = 4096;
+  const size_t warmCacheStyleSheetCount = 64;
+  const size_t warmCacheMatchDecisionCount = 1024;
+  // used by the progressive startup unless a slice duration is set.
+  const std::chrono::milliseconds progressiveStartupSliceDuration(5);
+
+  FilterEngine::StartupProgress ToStartupProgress(const JsValueList& values)
+  {
+    // values[0] - bool, whether the loading is complete
+    // values[1...] - strings, URLs of the active subscriptions
+    FilterEngine::StartupProgress progress;
+    if (values.empty())
+      return progress;
+    progress.isComplete = values[0].AsBool();
+    for (size_t i = 1; i < values.size(); ++i)
+      progress.liveSubscriptions.push_back(values[i].AsString());
+    return progress;
+  }
+
+  void ComputeSelectorOffsets(ElementHidingStyleSheet& styleSheet)
+  {
+    const auto& selectors = styleSheet.selectors;
+    if (selectors.empty())
+      return;
+    styleSheet.offsets.push_back(0);
+    for (auto pos = selectors.find('\n'); pos != std::string::npos; pos = selectors.find('\n', pos + 1))
+      styleSheet.offsets.push_back(pos + 1);
+  }
+
+  // The warm cache is read in parallel with patterns.ini, it is applied as
+  // soon as both are read if it was saved for the same filters.
+  class WarmCacheStartup
+  {
+  public:
+    WarmCacheStartup()
+      : isRead(false), areFiltersRead(false)
+    {
+    }
+
+    std::shared_ptr<WarmCache> OnRead(std::shared_ptr<WarmCache> value)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      isRead = true;
+      warmCache = std::move(value);
+      return TakeIfValid();
+    }
+
+    // the hash is empty if patterns.ini couldn't be read.
+    std::shared_ptr<WarmCache> OnFiltersRead(const std::string& value)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      areFiltersRead = true;
+      filterStateHash = value;
+      return TakeIfValid();
+    }
+
+  private:
+    std::shared_ptr<WarmCache> TakeIfValid()
+    {
+      if (!isRead || !areFiltersRead)
+        return std::shared_ptr<WarmCache>();
+      auto result = std::move(warmCache);
+      if (result && (filterStateHash.empty() || result->filterStateHash != filterStateHash))
+        result.reset();
+      return result;
+    }
+
+    std::mutex mutex;
+    bool isRead;
+    bool areFiltersRead;
+    std::string filterStateHash;
+    std::shared_ptr<WarmCache> warmCache;
+  };
+}
+
+// Kept apart from FilterEngine, which stays copyable, the copies share it.
+struct FilterEngine::CacheState
+{
+  CacheState()
+    : filterGeneration(0)
+    , elementHidingCache(new ElementHidingCache(defaultElementHidingCacheSize))
+    , hasStartupFilters(true), isWarmCacheValid(false)
+  {
+  }
+
+  std::atomic<uint64_t> filterGeneration;
+  std::unique_ptr<ElementHidingCache> elementHidingCache;
+  // only created along with the warm cache.
+  std::unique_ptr<MatchDecisionCache> matchDecisionCache;
+  // false once the filters loaded at the startup are changed.
+  std::atomic<bool> hasStartupFilters;
+  // warmResults are set once before isWarmCacheValid.
+  std::atomic<bool> isWarmCacheValid;
+  std::unique_ptr<WarmResults> warmResults;
+};
+
+// Callbacks of the pending ForceUpdateCheck() calls, they all share the
+// _updateCheckDone event.
+class AdblockPlus::UpdateCheckCallbacks
+{
+public:
+  UpdateCheckCallbacks()
+    : lastId(0)
+  {
+  }
+
+  int64_t Add(const FilterEngine::UpdateCheckDoneCallback& callback)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    callbacks[++lastId] = callback;
+    return lastId;
+  }
+
+  FilterEngine::UpdateCheckDoneCallback Take(int64_t id)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    FilterEngine::UpdateCheckDoneCallback result;
+    auto it = callbacks.find(id);
+    if (it != callbacks.end())
+    {
+      result = std::move(it->second);
+      callbacks.erase(it);
+    }
+    return result;
+  }
+
+private:
+  std::mutex mutex;
+  int64_t lastId;
+  std::map<int64_t, FilterEngine::UpdateCheckDoneCallback> callbacks;
+};
+
 FilterEngine::FilterEngine(const JsEnginePtr& jsEngine)
-  : jsEngine(jsEngine), firstRun(false), updateCheckId(0)
+  : jsEngine(jsEngine), firstRun(false)
+  , updateCheckCallbacks(std::make_shared<UpdateCheckCallbacks>())
+  , cacheState(std::make_shared<CacheState>())
+{
+}
+
+FilterEngine::~FilterEngine()
 {
 }
 
@@ -191,7 +369,12 @@ void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
   const FilterEngine::OnCreatedCallback& onCreated,
   const FilterEngine::CreationParameters& params)
 {
+  auto createAsyncStart = StartupTimelineRecorder::Clock::now();
   FilterEnginePtr filterEngine(new FilterEngine(jsEngine));
+  auto startupTimeline = std::make_shared<StartupTimelineRecorder>(jsEngine->creationStart);
+  startupTimeline->Add("jsEngine.isolate", jsEngine->creationStart, jsEngine->isolateCreated);
+  startupTimeline->Add("jsEngine.context", jsEngine->isolateCreated, jsEngine->contextCreated);
+  filterEngine->startupTimeline = startupTimeline;
   {
     // TODO: replace weakFilterEngine by this when it's possible to control the
     // execution time of the asynchronous part below.
@@ -229,22 +412,147 @@ void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
     });
   }
   
-  jsEngine->SetEventCallback("_init", [jsEngine, filterEngine, onCreated](JsValueList&& params)
+  // params[0] - string, name of the phase
+  // params[1] - bool, whether the phase begins or ends
+  jsEngine->SetEventCallback("_startupPhase", [startupTimeline](JsValueList&& params)
   {
+    if (params.size() < 2)
+      return;
+    if (params[1].AsBool())
+      startupTimeline->Begin(params[0].AsString());
+    else
+      startupTimeline->End(params[0].AsString());
+  });
+
+  {
+    std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
+    // params[0] - bool, whether the filters of patterns.ini are being loaded
+    jsEngine->SetEventCallback("_filterGeneration", [weakFilterEngine](JsValueList&& params)
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine)
+        return;
+      if (params.empty() || !params[0].AsBool())
+      {
+        filterEngine->cacheState->hasStartupFilters = false;
+        filterEngine->cacheState->isWarmCacheValid = false;
+      }
+      ++filterEngine->cacheState->filterGeneration;
+    });
+  }
+
+  {
+    auto updateCheckCallbacks = filterEngine->updateCheckCallbacks;
+    // params[0] - number, ID of the update check
+    // params[1] - nullable string, the error if the check has failed
+    jsEngine->SetEventCallback("_updateCheckDone", [updateCheckCallbacks](JsValueList&& params)
+    {
+      if (params.empty())
+        return;
+      auto callback = updateCheckCallbacks->Take(params[0].AsInt());
+      if (!callback)
+        return;
+      std::string error(params.size() >= 2 && !params[1].IsNull() ? params[1].AsString() : "");
+      callback(error);
+    });
+  }
+
+  if (!params.warmCacheFileName.empty())
+  {
+    filterEngine->warmCacheFileName = params.warmCacheFileName;
+    // Only the warm cache makes it worth to remember the decisions, most
+    // of the matched URLs are unique.
+    filterEngine->cacheState->matchDecisionCache.reset(new MatchDecisionCache(matchDecisionCacheCount));
+    auto warmCacheStartup = std::make_shared<WarmCacheStartup>();
+    std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
+    std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
+    auto applyWarmCache = [weakJsEngine, weakFilterEngine](const std::shared_ptr<WarmCache>& warmCache)
+    {
+      if (!warmCache)
+        return;
+      JsEngine::Dispatch(weakJsEngine, [weakFilterEngine, warmCache]
+      {
+        if (auto filterEngine = weakFilterEngine.lock())
+          filterEngine->ApplyWarmCache(*warmCache);
+      });
+    };
+    // The hash of patterns.ini is computed on the thread reading it, the
+    // warm cache is then applied before the filters are parsed.
+    auto appVersion = jsEngine->Evaluate("_appInfo.version").AsString();
+    jsEngine->GetPlatform().GetFilePrefetcher().ObserveNextRead("patterns.ini",
+      [appVersion, warmCacheStartup, applyWarmCache](const TokenizedFilePtr& file)
+      {
+        std::string filterStateHash;
+        if (file->error.empty())
+          filterStateHash = HashFilterState(appVersion, file->content);
+        applyWarmCache(warmCacheStartup->OnFiltersRead(filterStateHash));
+      });
+    auto fileName = params.warmCacheFileName;
+    jsEngine->GetPlatform().WithFileSystem(
+      [warmCacheStartup, applyWarmCache, fileName](IFileSystem& fileSystem)
+      {
+        fileSystem.Read(fileName,
+          [warmCacheStartup, applyWarmCache]
+          (IFileSystem::IOBuffer&& content, const std::string& error)
+          {
+            std::shared_ptr<WarmCache> warmCache;
+            if (error.empty())
+            {
+              warmCache = std::make_shared<WarmCache>();
+              if (!warmCache->Parse(content))
+                warmCache.reset();
+            }
+            applyWarmCache(warmCacheStartup->OnRead(std::move(warmCache)));
+          });
+      });
+  }
+
+  bool progressiveStartup = params.progressiveStartup;
+  if (progressiveStartup)
+  {
+    // Without slices patterns.ini would be parsed at once and nobody could
+    // use the engine before the loading is complete.
+    if (jsEngine->GetFileParsingSliceDuration().count() == 0)
+      jsEngine->SetFileParsingSliceDuration(progressiveStartupSliceDuration);
+    jsEngine->SetEventCallback("_ready", [jsEngine, filterEngine, onCreated](JsValueList&&)
+    {
+      jsEngine->RemoveEventCallback("_ready");
+      // _ready is triggered while a slice is parsed, the engine is passed
+      // on after it, when it is not locked anymore.
+      jsEngine->GetPlatform().WithTimer([filterEngine, onCreated](ITimer& timer)
+      {
+        timer.SetTimer(std::chrono::milliseconds(0), [filterEngine, onCreated]
+        {
+          onCreated(filterEngine);
+        });
+      });
+    });
+  }
+
+  jsEngine->SetEventCallback("_init", [jsEngine, filterEngine, onCreated, createAsyncStart,
+    progressiveStartup](JsValueList&& params)
+  {
+    filterEngine->startupTimeline->Add("filterEngine.init", createAsyncStart,
+      StartupTimelineRecorder::Clock::now());
+    jsEngine->RemoveEventCallback("_startupPhase");
     filterEngine->firstRun = params.size() && params[0].AsBool();
-    onCreated(filterEngine);
+    if (!progressiveStartup)
+      onCreated(filterEngine);
     jsEngine->RemoveEventCallback("_init");
   });
 
-  std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
-  filterEngine->SetFilterChangeCallback([weakFilterEngine](const std::string& reason, JsValue&&)
+  if (params.memoryPressurePolicy.mode != MemoryPressurePolicy::MODE_NEVER)
   {
-    auto filterEngine = weakFilterEngine.lock();
-    if (!filterEngine)
-      return;
-    if (reason == "save")
-      filterEngine->GetJsEngine().NotifyLowMemory();
-  });
+    std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
+    auto memoryPressurePolicy = params.memoryPressurePolicy;
+    jsEngine->SetEventCallback("_filtersSaved", [weakFilterEngine, memoryPressurePolicy](JsValueList&&)
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine)
+        return;
+      ApplyMemoryPressurePolicy(filterEngine->GetJsEngine(), memoryPressurePolicy);
+    });
+  }
 
   // Lock the JS engine while we are loading scripts, no timeouts should fire
   // until we are done.
@@ -256,9 +564,15 @@ void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
     preconfiguredPrefsObject.SetProperty(pref.first, pref.second);
   }
   jsEngine->SetGlobalProperty("_preconfiguredPrefs", preconfiguredPrefsObject);
+  jsEngine->SetGlobalProperty("_progressiveStartup", jsEngine->NewValue(progressiveStartup));
   // Load adblockplus scripts
   for (int i = 0; !jsSources[i].empty(); i += 2)
+  {
+    auto evaluationStart = StartupTimelineRecorder::Clock::now();
     jsEngine->Evaluate(jsSources[i + 1], jsSources[i]);
+    startupTimeline->Add("evaluate " + jsSources[i], evaluationStart,
+      StartupTimelineRecorder::Clock::now());
+  }
 }
 
 namespace
@@ -330,6 +644,7 @@ Subscription FilterEngine::GetSubscription(const std::string& url) const
 
 std::vector<Filter> FilterEngine::GetListedFilters() const
 {
+  const JsContext context(*jsEngine);
   JsValue func = jsEngine->Evaluate("API.getListedFilters");
   JsValueList values = func.Call().AsList();
   std::vector<Filter> result;
@@ -340,6 +655,7 @@ std::vector<Filter> FilterEngine::GetListedFilters() const
 
 std::vector<Subscription> FilterEngine::GetListedSubscriptions() const
 {
+  const JsContext context(*jsEngine);
   JsValue func = jsEngine->Evaluate("API.getListedSubscriptions");
   JsValueList values = func.Call().AsList();
   std::vector<Subscription> result;
@@ -350,6 +666,7 @@ std::vector<Subscription> FilterEngine::GetListedSubscriptions() const
 
 std::vector<Subscription> FilterEngine::FetchAvailableSubscriptions() const
 {
+  const JsContext context(*jsEngine);
   JsValue func = jsEngine->Evaluate("API.getRecommendedSubscriptions");
   JsValueList values = func.Call().AsList();
   std::vector<Subscription> result;
@@ -416,6 +733,75 @@ AdblockPlus::FilterPtr FilterEngine::Matches(const std::string& url,
     ContentTypeMask contentTypeMask,
     const std::vector<std::string>& documentUrls) const
 {
+  IMetrics* metrics = jsEngine->GetPlatform().GetMetrics();
+  ScopedLatency latency(metrics, IMetrics::HISTOGRAM_MATCHES);
+  FilterPtr match;
+  if (!cacheState->matchDecisionCache)
+    match = MatchesImpl(url, contentTypeMask, documentUrls);
+  else
+  {
+    auto key = MatchDecisionCache::GetKey(url, static_cast<uint32_t>(contentTypeMask), documentUrls);
+    // read before matching, a decision for newer filters is then discarded
+    // with the older generation.
+    uint64_t generation = cacheState->filterGeneration;
+    std::string filterText;
+    if (cacheState->matchDecisionCache->Get(key, generation, filterText) ||
+        GetWarmMatchDecision(key, generation, filterText))
+    {
+      if (metrics)
+        metrics->Increment(IMetrics::COUNTER_MATCH_CACHE_HITS, 1);
+      if (!filterText.empty())
+        match.reset(new Filter(GetFilter(filterText)));
+    }
+    else
+    {
+      if (metrics)
+        metrics->Increment(IMetrics::COUNTER_MATCH_CACHE_MISSES, 1);
+      match = MatchesImpl(url, contentTypeMask, documentUrls);
+      if (match)
+        filterText = match->GetProperty("text").AsString();
+      cacheState->matchDecisionCache->Put(key, generation, filterText);
+    }
+  }
+  if (metrics)
+  {
+    metrics->Increment(IMetrics::COUNTER_MATCHES, 1);
+    if (match && match->GetType() == Filter::TYPE_BLOCKING)
+      metrics->Increment(IMetrics::COUNTER_MATCHES_BLOCKED, 1);
+  }
+  return match;
+}
+
+std::future<AdblockPlus::FilterPtr> FilterEngine::MatchesAsync(const std::string& url,
+    ContentTypeMask contentTypeMask,
+    const std::vector<std::string>& documentUrls) const
+{
+  // a dropped task breaks the promise, the future holds an exception then.
+  auto promise = std::make_shared<std::promise<FilterPtr>>();
+  auto result = promise->get_future();
+  std::weak_ptr<const FilterEngine> weakFilterEngine = shared_from_this();
+  JsEngine::Dispatch(jsEngine, [weakFilterEngine, url, contentTypeMask, documentUrls, promise]
+  {
+    try
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine)
+        throw std::runtime_error("The filter engine is destroyed");
+      promise->set_value(filterEngine->Matches(url, contentTypeMask, documentUrls));
+    }
+    catch (...)
+    {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return result;
+}
+
+AdblockPlus::FilterPtr FilterEngine::MatchesImpl(const std::string& url,
+    ContentTypeMask contentTypeMask,
+    const std::vector<std::string>& documentUrls) const
+{
+  const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_MATCH);
   if (documentUrls.empty())
     return CheckFilterMatch(url, contentTypeMask, "");
 
@@ -444,10 +830,52 @@ bool FilterEngine::IsElemhideWhitelisted(const std::string& url,
     return !!GetWhitelistingFilter(url, CONTENT_TYPE_ELEMHIDE, documentUrls);
 }
 
+FilterEngine::PageSetup FilterEngine::GetPageSetup(const std::string& url,
+    const std::vector<std::string>& documentUrls) const
+{
+  // Make sure to keep the order in sync with API.getPageSetup.
+  static const ContentType whitelistingTypes[] = {
+    CONTENT_TYPE_DOCUMENT, CONTENT_TYPE_ELEMHIDE,
+    CONTENT_TYPE_GENERICHIDE, CONTENT_TYPE_GENERICBLOCK
+  };
+  PageSetup pageSetup;
+  {
+    const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_MATCH);
+    // URLs can't contain line breaks.
+    std::string joinedDocumentUrls;
+    for (size_t i = 0; i < documentUrls.size(); ++i)
+    {
+      if (i > 0)
+        joinedDocumentUrls += '\n';
+      joinedDocumentUrls += documentUrls[i];
+    }
+    JsValueList params;
+    params.push_back(jsEngine->NewValue(url));
+    params.push_back(jsEngine->NewValue(joinedDocumentUrls));
+    params.push_back(jsEngine->NewValue(static_cast<ContentTypeMask>(CONTENT_TYPE_DOCUMENT)));
+    for (auto type : whitelistingTypes)
+      params.push_back(jsEngine->NewValue(static_cast<ContentTypeMask>(type)));
+    auto result = jsEngine->Evaluate("API.getPageSetup").Call(params).AsList();
+    pageSetup.documentWhitelisted = result[0].AsBool();
+    pageSetup.elemhideWhitelisted = result[1].AsBool();
+    pageSetup.genericHide = result[2].AsBool();
+    pageSetup.genericBlock = result[3].AsBool();
+    pageSetup.domain = result[4].AsString();
+  }
+  if (pageSetup.documentWhitelisted || pageSetup.elemhideWhitelisted)
+    return pageSetup;
+  if (!pageSetup.genericHide)
+    pageSetup.genericElementHidingStyleSheet = GetGenericElementHidingStyleSheet();
+  pageSetup.elementHidingStyleSheetDelta = GetElementHidingStyleSheetDelta(pageSetup.domain,
+    pageSetup.genericHide);
+  return pageSetup;
+}
+
 AdblockPlus::FilterPtr FilterEngine::CheckFilterMatch(const std::string& url,
     ContentTypeMask contentTypeMask,
     const std::string& documentUrl) const
 {
+  const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_MATCH);
   JsValue func = jsEngine->Evaluate("API.checkFilterMatch");
   JsValueList params;
   params.push_back(jsEngine->NewValue(url));
@@ -462,14 +890,290 @@ AdblockPlus::FilterPtr FilterEngine::CheckFilterMatch(const std::string& url,
 
 std::vector<std::string> FilterEngine::GetElementHidingSelectors(const std::string& domain) const
 {
-  JsValue func = jsEngine->Evaluate("API.getElementHidingSelectors");
-  JsValueList result = func.Call(jsEngine->NewValue(domain)).AsList();
+  auto styleSheet = GetElementHidingStyleSheet(domain);
   std::vector<std::string> selectors;
-  for (const auto& r: result)
-    selectors.push_back(r.AsString());
+  selectors.reserve(styleSheet->GetSelectorCount());
+  for (size_t i = 0; i < styleSheet->GetSelectorCount(); ++i)
+    selectors.emplace_back(styleSheet->selectors, styleSheet->offsets[i],
+      styleSheet->GetSelectorLength(i));
   return selectors;
 }
 
+ElementHidingStyleSheetPtr FilterEngine::GetElementHidingStyleSheet(const std::string& domain) const
+{
+  return GetCachedStyleSheet(ElementHidingCache::KIND_ALL, domain);
+}
+
+ElementHidingStyleSheetPtr FilterEngine::GetGenericElementHidingStyleSheet() const
+{
+  return GetCachedStyleSheet(ElementHidingCache::KIND_GENERIC, std::string());
+}
+
+ElementHidingStyleSheetPtr FilterEngine::GetElementHidingStyleSheetDelta(const std::string& domain,
+  bool specificOnly) const
+{
+  return GetCachedStyleSheet(specificOnly ? ElementHidingCache::KIND_SPECIFIC :
+    ElementHidingCache::KIND_DELTA, domain);
+}
+
+ElementHidingStyleSheetPtr FilterEngine::GetCachedStyleSheet(int kind, const std::string& domain) const
+{
+  // Make sure to keep the names in sync with elemHideCriteria from api.js.
+  static const char* kindNames[ElementHidingCache::KIND_COUNT] = {
+    "all", "generic", "delta", "specific", nullptr
+  };
+  auto cacheKind = static_cast<ElementHidingCache::Kind>(kind);
+  IMetrics* metrics = jsEngine->GetPlatform().GetMetrics();
+  uint64_t generation = cacheState->filterGeneration;
+  auto cached = cacheState->elementHidingCache->Get(cacheKind, domain, generation);
+  if (!cached)
+    cached = GetWarmStyleSheet(kind, domain, generation);
+  if (cached)
+  {
+    if (metrics)
+      metrics->Increment(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS, 1);
+    return cached;
+  }
+  if (metrics)
+    metrics->Increment(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES, 1);
+
+  auto styleSheet = std::make_shared<ElementHidingStyleSheet>();
+  {
+    const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_MATCH);
+    // filters change only while the engine is locked.
+    styleSheet->filterGeneration = cacheState->filterGeneration;
+    JsValue func = jsEngine->Evaluate("API.getElementHidingStyleSheet");
+    JsValueList params;
+    params.push_back(jsEngine->NewValue(domain));
+    params.push_back(jsEngine->NewValue(kindNames[kind]));
+    styleSheet->selectors = func.Call(params).AsString();
+  }
+  ComputeSelectorOffsets(*styleSheet);
+  cacheState->elementHidingCache->Put(cacheKind, domain, styleSheet);
+  return styleSheet;
+}
+
+ElementHidingRulesPtr FilterEngine::GetElementHidingRules(const std::string& domain,
+  size_t groupSize) const
+{
+  return GetCachedRules(ElementHidingCache::KIND_ALL, domain, groupSize);
+}
+
+ElementHidingRulesPtr FilterEngine::GetGenericElementHidingRules(size_t groupSize) const
+{
+  return GetCachedRules(ElementHidingCache::KIND_GENERIC, std::string(), groupSize);
+}
+
+ElementHidingRulesPtr FilterEngine::GetElementHidingRulesDelta(const std::string& domain,
+  size_t groupSize, bool specificOnly) const
+{
+  return GetCachedRules(specificOnly ? ElementHidingCache::KIND_SPECIFIC :
+    ElementHidingCache::KIND_DELTA, domain, groupSize);
+}
+
+ElementHidingRulesPtr FilterEngine::GetCachedRules(int kind, const std::string& domain,
+  size_t groupSize) const
+{
+  auto cacheKind = static_cast<ElementHidingCache::Kind>(kind);
+  if (auto cached = cacheState->elementHidingCache->GetRules(cacheKind, domain, cacheState->filterGeneration, groupSize))
+    return cached;
+
+  static const std::string declarationBlock = " {display: none !important;}\n";
+  auto styleSheet = GetCachedStyleSheet(kind, domain);
+  auto rules = std::make_shared<ElementHidingRules>();
+  rules->filterGeneration = styleSheet->filterGeneration;
+  rules->groupSize = groupSize;
+  size_t selectorCount = styleSheet->GetSelectorCount();
+  size_t ruleSize = groupSize > 0 ? groupSize : selectorCount;
+  if (ruleSize > 0)
+  {
+    size_t ruleCount = (selectorCount + ruleSize - 1) / ruleSize;
+    rules->rules.reserve(styleSheet->selectors.size() + ruleCount * declarationBlock.size());
+    rules->offsets.reserve(ruleCount);
+  }
+  for (size_t i = 0; i < selectorCount; ++i)
+  {
+    if (i % ruleSize == 0)
+      rules->offsets.push_back(rules->rules.size());
+    else
+      rules->rules += ", ";
+    rules->rules.append(styleSheet->selectors, styleSheet->offsets[i], styleSheet->GetSelectorLength(i));
+    if ((i + 1) % ruleSize == 0 || i + 1 == selectorCount)
+      rules->rules += declarationBlock;
+  }
+  cacheState->elementHidingCache->PutRules(cacheKind, domain, rules);
+  return rules;
+}
+
+ElementHidingEmulationSelectorsPtr FilterEngine::GetElementHidingEmulationSelectors(const std::string& domain) const
+{
+  IMetrics* metrics = jsEngine->GetPlatform().GetMetrics();
+  if (auto cached = cacheState->elementHidingCache->GetEmulationSelectors(domain, cacheState->filterGeneration))
+  {
+    if (metrics)
+      metrics->Increment(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS, 1);
+    return cached;
+  }
+  if (metrics)
+    metrics->Increment(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES, 1);
+
+  auto emulationSelectors = std::make_shared<ElementHidingEmulationSelectors>();
+  std::string selectorsAndTexts;
+  {
+    const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_MATCH);
+    emulationSelectors->filterGeneration = cacheState->filterGeneration;
+    JsValue func = jsEngine->Evaluate("API.getElementHidingEmulationSelectors");
+    selectorsAndTexts = func.Call(jsEngine->NewValue(domain)).AsString();
+  }
+  // Pairs of a selector and a filter text, each followed by a line break.
+  for (size_t pos = 0; pos < selectorsAndTexts.size();)
+  {
+    ElementHidingEmulationSelector emulationSelector;
+    auto selectorEnd = selectorsAndTexts.find('\n', pos);
+    auto textEnd = selectorsAndTexts.find('\n', selectorEnd + 1);
+    if (selectorEnd == std::string::npos || textEnd == std::string::npos)
+      break;
+    emulationSelector.selector = selectorsAndTexts.substr(pos, selectorEnd - pos);
+    emulationSelector.text = selectorsAndTexts.substr(selectorEnd + 1, textEnd - selectorEnd - 1);
+    emulationSelectors->selectors.push_back(std::move(emulationSelector));
+    pos = textEnd + 1;
+  }
+  cacheState->elementHidingCache->PutEmulationSelectors(domain, emulationSelectors);
+  return emulationSelectors;
+}
+
+void FilterEngine::SaveWarmCache(const SaveWarmCacheCallback& callback) const
+{
+  std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
+  auto onDone = [weakJsEngine, callback](const std::string& error)
+  {
+    if (callback)
+      JsEngine::Dispatch(weakJsEngine, std::bind(callback, error));
+  };
+  if (warmCacheFileName.empty())
+  {
+    onDone("The warm cache is disabled");
+    return;
+  }
+  WarmCache warmCache;
+  uint64_t generation;
+  {
+    const JsContext context(*jsEngine);
+    generation = cacheState->filterGeneration;
+    warmCache.filterStateHash = GetFilterStateHash();
+  }
+  for (const auto& entry : cacheState->elementHidingCache->GetRecentStyleSheets(generation, warmCacheStyleSheetCount))
+  {
+    WarmCache::StyleSheet styleSheet;
+    styleSheet.kind = entry.kind;
+    styleSheet.domain = entry.domain;
+    styleSheet.selectors = entry.styleSheet->selectors;
+    warmCache.styleSheets.push_back(std::move(styleSheet));
+  }
+  for (auto& decision : cacheState->matchDecisionCache->GetRecent(generation, warmCacheMatchDecisionCount))
+  {
+    WarmCache::MatchDecision matchDecision;
+    matchDecision.key = std::move(decision.first);
+    matchDecision.filterText = std::move(decision.second);
+    warmCache.matchDecisions.push_back(std::move(matchDecision));
+  }
+  auto data = warmCache.Serialize();
+  auto fileName = warmCacheFileName;
+  jsEngine->GetPlatform().WithFileSystem([&data, &fileName, &onDone](IFileSystem& fileSystem)
+  {
+    fileSystem.Write(fileName, data, onDone);
+  });
+}
+
+std::string FilterEngine::GetFilterStateHash() const
+{
+  auto appVersion = jsEngine->Evaluate("_appInfo.version").AsString();
+  JsValue func = jsEngine->Evaluate("API.getFilterState");
+  return HashFilterState(appVersion, func.Call().AsString());
+}
+
+void FilterEngine::ApplyWarmCache(const WarmCache& warmCache)
+{
+  std::unique_ptr<WarmResults> results(new WarmResults());
+  for (const auto& styleSheet : warmCache.styleSheets)
+  {
+    if (styleSheet.kind < 0 || styleSheet.kind >= ElementHidingCache::KIND_EMULATION)
+      continue;
+    results->styleSheets.emplace(std::make_pair(styleSheet.kind, styleSheet.domain),
+      styleSheet.selectors);
+  }
+  for (const auto& matchDecision : warmCache.matchDecisions)
+    results->matchDecisions.emplace(matchDecision.key, matchDecision.filterText);
+  // it is only applied once, nobody reads the results yet.
+  cacheState->warmResults = std::move(results);
+  cacheState->isWarmCacheValid = true;
+  // the filters could have changed meanwhile.
+  if (!cacheState->hasStartupFilters)
+    cacheState->isWarmCacheValid = false;
+}
+
+bool FilterEngine::GetWarmMatchDecision(const std::string& key, uint64_t generation,
+  std::string& filterText) const
+{
+  if (!cacheState->isWarmCacheValid)
+    return false;
+  auto it = cacheState->warmResults->matchDecisions.find(key);
+  if (it == cacheState->warmResults->matchDecisions.end())
+    return false;
+  filterText = it->second;
+  cacheState->matchDecisionCache->Put(key, generation, filterText);
+  return true;
+}
+
+ElementHidingStyleSheetPtr FilterEngine::GetWarmStyleSheet(int kind, const std::string& domain,
+  uint64_t generation) const
+{
+  if (!cacheState->isWarmCacheValid)
+    return ElementHidingStyleSheetPtr();
+  auto it = cacheState->warmResults->styleSheets.find(std::make_pair(kind, domain));
+  if (it == cacheState->warmResults->styleSheets.end())
+    return ElementHidingStyleSheetPtr();
+  auto styleSheet = std::make_shared<ElementHidingStyleSheet>();
+  styleSheet->filterGeneration = generation;
+  styleSheet->selectors = it->second;
+  ComputeSelectorOffsets(*styleSheet);
+  cacheState->elementHidingCache->Put(static_cast<ElementHidingCache::Kind>(kind), domain, styleSheet);
+  return styleSheet;
+}
+
+void FilterEngine::SetElementHidingCacheSize(size_t size)
+{
+  cacheState->elementHidingCache->SetMaxSize(size);
+}
+
+uint64_t FilterEngine::GetFilterGeneration() const
+{
+  return cacheState->filterGeneration;
+}
+
+std::future<std::vector<std::string>> FilterEngine::GetElementHidingSelectorsAsync(
+    const std::string& domain) const
+{
+  auto promise = std::make_shared<std::promise<std::vector<std::string>>>();
+  auto result = promise->get_future();
+  std::weak_ptr<const FilterEngine> weakFilterEngine = shared_from_this();
+  JsEngine::Dispatch(jsEngine, [weakFilterEngine, domain, promise]
+  {
+    try
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine)
+        throw std::runtime_error("The filter engine is destroyed");
+      promise->set_value(filterEngine->GetElementHidingSelectors(domain));
+    }
+    catch (...)
+    {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return result;
+}
+
 JsValue FilterEngine::GetPref(const std::string& pref) const
 {
   JsValue func = jsEngine->Evaluate("API.getPref");
@@ -512,16 +1216,7 @@ void FilterEngine::ForceUpdateCheck(
   JsValue func = jsEngine->Evaluate("API.forceUpdateCheck");
   JsValueList params;
   if (callback)
-  {
-    std::string eventName = "_updateCheckDone" + std::to_string(++updateCheckId);
-    jsEngine->SetEventCallback(eventName, [this, eventName, callback](JsValueList&& params)
-    {
-      std::string error(params.size() >= 1 && !params[0].IsNull() ? params[0].AsString() : "");
-      callback(error);
-      jsEngine->RemoveEventCallback(eventName);
-    });
-    params.push_back(jsEngine->NewValue(eventName));
-  }
+    params.push_back(jsEngine->NewValue(updateCheckCallbacks->Add(callback)));
   func.Call(params);
 }
 
@@ -538,6 +1233,32 @@ void FilterEngine::RemoveFilterChangeCallback()
   jsEngine->RemoveEventCallback("filterChange");
 }
 
+void FilterEngine::SetFilterChangeBatchCallback(const FilterChangeBatchCallback& callback,
+  const FilterChangeBatchOptions& options)
+{
+  if (!callback)
+  {
+    RemoveFilterChangeBatchCallback();
+    return;
+  }
+  jsEngine->SetEventCallback("_filterChangeBatch", [this, callback](JsValueList&& params)
+  {
+    this->FilterChangeBatchReady(callback, move(params));
+  });
+  JsValue func = jsEngine->Evaluate("API.setFilterChangeBatching");
+  JsValueList params;
+  params.push_back(jsEngine->NewValue(true));
+  params.push_back(jsEngine->NewValue(static_cast<int64_t>(options.window.count())));
+  params.push_back(jsEngine->NewValue(options.includeFilterTexts));
+  func.Call(params);
+}
+
+void FilterEngine::RemoveFilterChangeBatchCallback()
+{
+  jsEngine->Evaluate("API.setFilterChangeBatching").Call(jsEngine->NewValue(false));
+  jsEngine->RemoveEventCallback("_filterChangeBatch");
+}
+
 void FilterEngine::SetAllowedConnectionType(const std::string* value)
 {
   SetPref("allowed_connection_type", value ? jsEngine->NewValue(*value) : jsEngine->NewValue(""));
@@ -553,11 +1274,34 @@ std::unique_ptr<std::string> FilterEngine::GetAllowedConnectionType() const
 
 void FilterEngine::FilterChanged(const FilterEngine::FilterChangeCallback& callback, JsValueList&& params) const
 {
+  const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_EVENT);
   std::string action(params.size() >= 1 && !params[0].IsNull() ? params[0].AsString() : "");
   JsValue item(params.size() >= 2 ? params[1] : jsEngine->NewValue(false));
   callback(action, std::move(item));
 }
 
+void FilterEngine::FilterChangeBatchReady(const FilterEngine::FilterChangeBatchCallback& callback, JsValueList&& params) const
+{
+  std::vector<FilterChangeBatch> batches;
+  {
+    const JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_EVENT);
+    if (params.size() < 1 || !params[0].IsArray())
+      return;
+    for (const auto& item : params[0].AsList())
+    {
+      FilterChangeBatch batch;
+      batch.subscriptionUrl = item.GetProperty("subscriptionUrl").AsString();
+      batch.actions = item.GetProperty("actions").AsStringVector();
+      batch.filtersAdded = item.GetProperty("filtersAdded").AsInt();
+      batch.filtersRemoved = item.GetProperty("filtersRemoved").AsInt();
+      batch.addedFilters = item.GetProperty("addedFilters").AsStringVector();
+      batch.removedFilters = item.GetProperty("removedFilters").AsStringVector();
+      batches.push_back(std::move(batch));
+    }
+  }
+  callback(batches);
+}
+
 int FilterEngine::CompareVersions(const std::string& v1, const std::string& v2) const
 {
   JsValueList params;
@@ -582,6 +1326,7 @@ FilterPtr FilterEngine::GetWhitelistingFilter(const std::string& url,
   ContentTypeMask contentTypeMask,
   const std::vector<std::string>& documentUrls) const
 {
+  const JsContext context(*jsEngine);
   if (documentUrls.empty())
   {
     return GetWhitelistingFilter(url, contentTypeMask, "");
@@ -602,3 +1347,33 @@ FilterPtr FilterEngine::GetWhitelistingFilter(const std::string& url,
   while (urlIterator != documentUrls.end());
   return FilterPtr();
 }
+
+FilterEngine::StartupTimeline FilterEngine::GetStartupTimeline() const
+{
+  return startupTimeline->GetTimeline();
+}
+
+std::string FilterEngine::GetStartupTimelineTraceJson() const
+{
+  return startupTimeline->GetTraceJson();
+}
+
+FilterEngine::StartupProgress FilterEngine::GetStartupProgress() const
+{
+  const JsContext context(*jsEngine);
+  JsValue func = jsEngine->Evaluate("API.getStartupProgress");
+  return ToStartupProgress(func.Call().AsList());
+}
+
+void FilterEngine::SetStartupProgressCallback(const StartupProgressCallback& callback)
+{
+  jsEngine->SetEventCallback("_startupProgress", [callback](JsValueList&& params)
+  {
+    callback(ToStartupProgress(params));
+  });
+}
+
+void FilterEngine::RemoveStartupProgressCallback()
+{
+  jsEngine->RemoveEventCallback("_startupProgress");
+}
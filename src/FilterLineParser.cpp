@@ -0,0 +1,381 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include "FilePrefetcher.h"
+#include "FilterLineParser.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  // Large subscriptions are split into tasks of that many lines.
+  const size_t maxLinesPerTask = 4096;
+  // Less lines are parsed on the calling thread only.
+  const size_t minLinesForThreads = 8192;
+
+  inline bool IsKeywordChar(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') || c == '%';
+  }
+
+  inline bool IsOptionNameChar(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') || c == '_' || c == '-';
+  }
+
+  inline bool IsSpace(char c)
+  {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  }
+
+  inline char ToLower(char c)
+  {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+  }
+
+  bool EqualsIgnoreCase(const char* data, uint32_t begin, uint32_t end, const std::string& value)
+  {
+    if (end - begin != value.size())
+      return false;
+    for (uint32_t pos = begin; pos < end; ++pos)
+    {
+      if (ToLower(data[pos]) != value[pos - begin])
+        return false;
+    }
+    return true;
+  }
+
+  /*
+   * Checks whether `data[begin, end)` are options as the core parses them,
+   * ~?[\w-]+(?:=[^,]*)? separated by commas. Older cores don't accept empty
+   * values and white space in them, such options are ambiguous.
+   */
+  bool ParseOptions(const char* data, uint32_t begin, uint32_t end,
+    TextRange& domains, bool& isAmbiguous)
+  {
+    isAmbiguous = false;
+    for (uint32_t pos = begin;;)
+    {
+      uint32_t optionBegin = pos;
+      if (pos < end && data[pos] == '~')
+        ++pos;
+      uint32_t nameBegin = pos;
+      while (pos < end && IsOptionNameChar(data[pos]))
+        ++pos;
+      if (pos == nameBegin)
+        return false;
+      uint32_t nameEnd = pos;
+      if (pos < end && data[pos] == '=')
+      {
+        uint32_t valueBegin = ++pos;
+        while (pos < end && data[pos] != ',')
+        {
+          if (IsSpace(data[pos]))
+            isAmbiguous = true;
+          ++pos;
+        }
+        if (pos == valueBegin)
+          isAmbiguous = true;
+        if (EqualsIgnoreCase(data, optionBegin, nameEnd, "domain"))
+          domains = TextRange(valueBegin, pos);
+      }
+      if (pos == end)
+        return true;
+      if (data[pos] != ',')
+        return false;
+      ++pos;
+    }
+  }
+
+  bool IsSectionHeader(const char* data, uint32_t begin, uint32_t end, bool& isFilterSection)
+  {
+    while (begin < end && IsSpace(data[begin]))
+      ++begin;
+    while (end > begin && IsSpace(data[end - 1]))
+      --end;
+    if (end - begin <= 2 || data[begin] != '[' || data[end - 1] != ']')
+      return false;
+    isFilterSection = EqualsIgnoreCase(data, begin + 1, end - 1, "subscription filters");
+    return true;
+  }
+
+  uint64_t HashKeyword(const char* data, const TextRange& range)
+  {
+    // FNV-1a of the lower case keyword.
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t pos = range.first; pos < range.second; ++pos)
+    {
+      hash ^= static_cast<uint8_t>(ToLower(data[pos]));
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  struct FilterKeywords
+  {
+    size_t line;
+    bool isException;
+    // range in TaskResult::candidates
+    size_t candidatesBegin;
+    size_t candidatesEnd;
+  };
+
+  struct TaskResult
+  {
+    std::vector<FilterKeywords> filters;
+    std::vector<std::pair<TextRange, uint64_t>> candidates;
+  };
+
+  /*
+   * Runs the tasks on a pool of threads, the calling thread is one of them.
+   */
+  void RunTasks(size_t taskCount, unsigned threadCount, const std::function<void(size_t)>& task)
+  {
+    std::atomic<size_t> nextTask(0);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto worker = [&]
+    {
+      try
+      {
+        for (size_t i = nextTask++; i < taskCount; i = nextTask++)
+          task(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error)
+          error = std::current_exception();
+        nextTask = taskCount;
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min<size_t>(threadCount, taskCount); ++i)
+    {
+      try
+      {
+        threads.emplace_back(worker);
+      }
+      catch (const std::system_error&)
+      {
+        // the remaining threads do the work then.
+        break;
+      }
+    }
+    worker();
+    for (auto& thread : threads)
+      thread.join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+}
+
+ParsedFilterLine AdblockPlus::ParseFilterLine(const char* data, uint32_t begin, uint32_t end)
+{
+  ParsedFilterLine result;
+  if (begin == end || data[begin] == '!')
+    return result;
+
+  // /^([^\/*|@"!]*?)#([@?])?#(.+)$/
+  for (uint32_t pos = begin; pos < end; ++pos)
+  {
+    char c = data[pos];
+    if (c == '/' || c == '*' || c == '|' || c == '@' || c == '"' || c == '!')
+      break;
+    if (c != '#')
+      continue;
+    auto type = ParsedFilterLine::TYPE_ELEMHIDE;
+    uint32_t separatorEnd = pos + 1;
+    if (separatorEnd < end && (data[separatorEnd] == '@' || data[separatorEnd] == '?'))
+    {
+      type = data[separatorEnd] == '@' ? ParsedFilterLine::TYPE_ELEMHIDE_EXCEPTION :
+        ParsedFilterLine::TYPE_ELEMHIDE_EMULATION;
+      ++separatorEnd;
+    }
+    if (separatorEnd + 1 < end && data[separatorEnd] == '#')
+    {
+      result.type = type;
+      result.domains = TextRange(begin, pos);
+      return result;
+    }
+  }
+
+  result.type = ParsedFilterLine::TYPE_BLOCKING;
+  uint32_t patternBegin = begin;
+  if (end - begin >= 2 && data[begin] == '@' && data[begin + 1] == '@')
+  {
+    result.type = ParsedFilterLine::TYPE_EXCEPTION;
+    patternBegin += 2;
+  }
+
+  // Like a regular expression the options begin at the first `$` which
+  // is followed by valid options only.
+  uint32_t patternEnd = end;
+  bool hasAmbiguousOptions = false;
+  for (uint32_t pos = patternBegin; pos < end; ++pos)
+  {
+    TextRange domains(0, 0);
+    bool isAmbiguous = false;
+    if (data[pos] == '$' && ParseOptions(data, pos + 1, end, domains, isAmbiguous))
+    {
+      patternEnd = pos;
+      result.options = TextRange(pos + 1, end);
+      result.domains = domains;
+      hasAmbiguousOptions = isAmbiguous;
+      break;
+    }
+  }
+
+  if (hasAmbiguousOptions)
+    return result;
+  for (uint32_t pos = begin; pos < end; ++pos)
+  {
+    // the lower case of some characters is ASCII in JavaScript.
+    if (static_cast<unsigned char>(data[pos]) >= 0x80)
+      return result;
+  }
+  if (patternBegin < patternEnd && data[patternBegin] == '/')
+  {
+    // Regular expressions are filed without a keyword, the ones with
+    // options are left to the core.
+    if (patternEnd != end)
+      return result;
+    if (patternEnd - patternBegin >= 2 && data[patternEnd - 1] == '/')
+    {
+      result.hasKeywordCandidates = true;
+      return result;
+    }
+  }
+
+  // /[^a-z0-9%*][a-z0-9%]{3,}(?=[^a-z0-9%*])/g on the lower case pattern.
+  result.hasKeywordCandidates = true;
+  for (uint32_t pos = patternBegin; pos < patternEnd;)
+  {
+    if (!IsKeywordChar(data[pos]))
+    {
+      ++pos;
+      continue;
+    }
+    uint32_t candidateBegin = pos;
+    while (pos < patternEnd && IsKeywordChar(data[pos]))
+      ++pos;
+    if (pos - candidateBegin >= 3 && candidateBegin > patternBegin &&
+        data[candidateBegin - 1] != '*' && pos < patternEnd && data[pos] != '*')
+      result.keywordCandidates.emplace_back(candidateBegin, pos);
+  }
+  return result;
+}
+
+void AdblockPlus::FindFilterKeywords(TokenizedFile& file, unsigned threadCount)
+{
+  const char* data = reinterpret_cast<const char*>(file.content.data());
+  const auto& lines = file.lines;
+
+  // ranges of lines, one subscription or a chunk of it each.
+  std::vector<std::pair<size_t, size_t>> tasks;
+  size_t filterCount = 0;
+  auto addTasks = [&tasks, &filterCount](size_t begin, size_t end)
+  {
+    filterCount += end - begin;
+    for (; begin < end; begin += maxLinesPerTask)
+      tasks.emplace_back(begin, std::min(end, begin + maxLinesPerTask));
+  };
+  bool isFilterSection = false;
+  size_t sectionBegin = 0;
+  for (size_t i = 0; i < lines.size(); ++i)
+  {
+    // filters beginning with `[` are escaped.
+    bool isNextFilterSection = false;
+    if (!IsSectionHeader(data, lines[i].first, lines[i].second, isNextFilterSection))
+      continue;
+    if (isFilterSection)
+      addTasks(sectionBegin, i);
+    isFilterSection = isNextFilterSection;
+    sectionBegin = i + 1;
+  }
+  if (isFilterSection)
+    addTasks(sectionBegin, lines.size());
+  if (tasks.empty())
+    return;
+
+  if (threadCount == 0)
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  if (filterCount < minLinesForThreads)
+    threadCount = 1;
+  std::vector<TaskResult> results(tasks.size());
+  RunTasks(tasks.size(), threadCount, [&](size_t task)
+  {
+    auto& result = results[task];
+    for (size_t i = tasks[task].first; i < tasks[task].second; ++i)
+    {
+      auto parsedLine = ParseFilterLine(data, lines[i].first, lines[i].second);
+      if (!parsedLine.hasKeywordCandidates)
+        continue;
+      FilterKeywords filter;
+      filter.line = i;
+      filter.isException = parsedLine.type == ParsedFilterLine::TYPE_EXCEPTION;
+      filter.candidatesEnd = filter.candidatesBegin = result.candidates.size();
+      for (const auto& range : parsedLine.keywordCandidates)
+        result.candidates.emplace_back(range, HashKeyword(data, range));
+      filter.candidatesEnd = result.candidates.size();
+      result.filters.push_back(filter);
+    }
+  });
+
+  // The choice depends on the filters before, so it's made in order. The
+  // matcher keeps blocking filters and exceptions apart. A collision of
+  // hashes can only make the choice worse, any candidate is valid.
+  std::unordered_map<uint64_t, uint32_t> keywordCounts[2];
+  file.keywords.assign(lines.size(), TextRange(NO_KEYWORD, NO_KEYWORD));
+  for (const auto& result : results)
+  {
+    for (const auto& filter : result.filters)
+    {
+      auto& counts = keywordCounts[filter.isException ? 1 : 0];
+      TextRange keyword(0, 0);
+      uint32_t* keywordCount = nullptr;
+      for (size_t i = filter.candidatesBegin; i < filter.candidatesEnd; ++i)
+      {
+        const auto& candidate = result.candidates[i];
+        uint32_t& count = counts[candidate.second];
+        if (!keywordCount || count < *keywordCount || (count == *keywordCount &&
+            candidate.first.second - candidate.first.first > keyword.second - keyword.first))
+        {
+          keyword = candidate.first;
+          keywordCount = &count;
+        }
+      }
+      if (keywordCount)
+        ++*keywordCount;
+      file.keywords[filter.line] = keyword;
+    }
+  }
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_LINE_PARSER_H
+#define ADBLOCK_PLUS_FILTER_LINE_PARSER_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace AdblockPlus
+{
+  struct TokenizedFile;
+
+  /**
+   * Begin and end offsets of a part of a filter line.
+   */
+  typedef std::pair<uint32_t, uint32_t> TextRange;
+
+  /**
+   * Marks the lines of a `TokenizedFile` without a known keyword.
+   */
+  const uint32_t NO_KEYWORD = UINT32_MAX;
+
+  /**
+   * Result of parsing a filter line natively, the ranges refer to the
+   * parsed buffer.
+   */
+  struct ParsedFilterLine
+  {
+    enum Type {TYPE_COMMENT, TYPE_BLOCKING, TYPE_EXCEPTION,
+               TYPE_ELEMHIDE, TYPE_ELEMHIDE_EXCEPTION, TYPE_ELEMHIDE_EMULATION};
+
+    ParsedFilterLine()
+      : type(TYPE_COMMENT), domains(0, 0), options(0, 0), hasKeywordCandidates(false)
+    {
+    }
+
+    Type type;
+    /**
+     * Domains of an element hiding filter or the value of the `domain`
+     * option of a blocking filter.
+     */
+    TextRange domains;
+    /**
+     * Options of a blocking filter without the leading `$`.
+     */
+    TextRange options;
+    /**
+     * Whether `keywordCandidates` are the ones the matcher of the core
+     * would find. It's not the case for comments and element hiding
+     * filters, and the parser leaves regular expressions, texts which are
+     * not ASCII and options which older cores split differently to the
+     * matcher.
+     */
+    bool hasKeywordCandidates;
+    /**
+     * Parts of the filter the matcher can file it under, not lower cased.
+     */
+    std::vector<TextRange> keywordCandidates;
+  };
+
+  /**
+   * Classifies the filter in `data[begin, end)` the way `Filter.fromText`
+   * of the core does and extracts its domains, options and keyword
+   * candidates.
+   */
+  ParsedFilterLine ParseFilterLine(const char* data, uint32_t begin, uint32_t end);
+
+  /**
+   * Finds the keywords for the matcher of the filters in the
+   * "[Subscription filters]" sections of `file` and stores them in
+   * `TokenizedFile::keywords`. The sections are parsed by a pool of
+   * `threadCount` threads, one subscription or chunk of a large one per
+   * task, zero means a thread per core. Out of several candidates the
+   * least used one is chosen, like the matcher does when the filters are
+   * added in the order of the file.
+   */
+  void FindFilterKeywords(TokenizedFile& file, unsigned threadCount = 0);
+}
+
+#endif
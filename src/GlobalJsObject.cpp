@@ -59,9 +59,25 @@ namespace
       v8::Isolate* isolate = arguments.GetIsolate();
       return Utils::ThrowExceptionInJS(isolate, "_triggerEvent expects at least one parameter");
     }
-    std::string eventName = converted.front().AsString();
+    const JsValue event = std::move(converted.front());
     converted.erase(converted.cbegin());
-    jsEngine->TriggerEvent(eventName, move(converted));
+    if (event.IsNumber())
+      jsEngine->TriggerEvent(static_cast<JsEngine::EventID>(event.AsInt()), move(converted));
+    else
+      jsEngine->TriggerEvent(event.AsString(), move(converted));
+  }
+
+  void GetEventIdCallback(const v8::FunctionCallbackInfo<v8::Value>& arguments)
+  {
+    AdblockPlus::JsEnginePtr jsEngine = AdblockPlus::JsEngine::FromArguments(arguments);
+    AdblockPlus::JsValueList converted = jsEngine->ConvertArguments(arguments);
+    if (converted.size() != 1)
+    {
+      v8::Isolate* isolate = arguments.GetIsolate();
+      return Utils::ThrowExceptionInJS(isolate, "_getEventId expects one parameter");
+    }
+    auto eventID = jsEngine->RegisterEvent(converted[0].AsString());
+    arguments.GetReturnValue().Set(eventID);
   }
 }
 
@@ -70,6 +86,8 @@ JsValue& GlobalJsObject::Setup(JsEngine& jsEngine, const AppInfo& appInfo,
 {
   obj.SetProperty("setTimeout", jsEngine.NewCallback(::SetTimeoutCallback));
   obj.SetProperty("_triggerEvent", jsEngine.NewCallback(::TriggerEventCallback));
+  obj.SetProperty("_getEventId", jsEngine.NewCallback(::GetEventIdCallback));
+  obj.SetProperty("_processLines", jsEngine.NewCallback(FileSystemJsObject::ProcessLines));
   auto value = jsEngine.NewObject();
   obj.SetProperty("_fileSystem", FileSystemJsObject::Setup(jsEngine, value));
   value = jsEngine.NewObject();
@@ -15,12 +15,74 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <AdblockPlus/Platform.h>
 #include "JsContext.h"
+#include "JsLockGate.h"
+#include "JsLockProfiler.h"
+#include "ScopedLatency.h"
 
-AdblockPlus::JsContext::JsContext(JsEngine& jsEngine)
+using AdblockPlus::JsContext;
+
+namespace
+{
+  // The innermost JsContext of the current thread.
+  thread_local JsContext* currentJsContext = nullptr;
+}
+
+JsContext::OutermostScopes::OutermostScopes(JsEngine& jsEngine)
     : locker(jsEngine.GetIsolate()), isolateScope(jsEngine.GetIsolate()),
       handleScope(jsEngine.GetIsolate()),
       context(v8::Local<v8::Context>::New(jsEngine.GetIsolate(), *jsEngine.context)),
       contextScope(context)
 {
 }
+
+JsContext::JsContext(JsEngine& jsEngine, JsEngine::LockCategory category)
+    : jsEngine(&jsEngine), parent(currentJsContext),
+      isOutermost(!parent || parent->jsEngine != &jsEngine),
+      category(category), lockGate(nullptr), lockProfiler(nullptr)
+{
+  if (isOutermost)
+  {
+    IMetrics* metrics = jsEngine.GetPlatform().GetMetrics();
+    if (jsEngine.lockProfiler->IsEnabled())
+      lockProfiler = jsEngine.lockProfiler.get();
+    JsLockProfiler::Wait wait;
+    if (lockProfiler)
+      wait = lockProfiler->BeginWait();
+    {
+      ScopedLatency latency(metrics, IMetrics::HISTOGRAM_JS_CONTEXT_WAIT);
+      if (jsEngine.lockGate->IsEnabled())
+      {
+        lockGate = jsEngine.lockGate.get();
+        lockGate->Enter(JsLockGate::GetPriority(category));
+      }
+      context = (new (&scopes) OutermostScopes(jsEngine))->context;
+    }
+    if (lockProfiler)
+      lockAcquired = lockProfiler->Acquired(category, wait);
+    if (metrics)
+      metrics->Increment(IMetrics::COUNTER_JS_CONTEXT_ACQUISITIONS, 1);
+  }
+  else
+  {
+    new (&scopes) v8::HandleScope(jsEngine.GetIsolate());
+    context = parent->context;
+  }
+  currentJsContext = this;
+}
+
+JsContext::~JsContext()
+{
+  if (isOutermost)
+  {
+    if (lockProfiler)
+      lockProfiler->Released(category, lockAcquired);
+    reinterpret_cast<OutermostScopes*>(&scopes)->~OutermostScopes();
+    if (lockGate)
+      lockGate->Leave();
+  }
+  else
+    reinterpret_cast<v8::HandleScope*>(&scopes)->~HandleScope();
+  currentJsContext = parent;
+}
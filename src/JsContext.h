@@ -18,15 +18,30 @@
 #ifndef ADBLOCK_PLUS_JS_CONTEXT_H
 #define ADBLOCK_PLUS_JS_CONTEXT_H
 
+#include <chrono>
+#include <type_traits>
 #include <v8.h>
 #include <AdblockPlus/JsEngine.h>
 
 namespace AdblockPlus
 {
+  /**
+   * Enters the isolate and the context of a `JsEngine` on the current thread.
+   * Only the outermost JsContext of the thread for a given engine acquires
+   * the v8::Locker and enters the isolate and the context, nested instances
+   * merely open a new handle scope and reuse the context of the outer one.
+   * Instances must be destroyed in the reverse order of their construction on
+   * the thread which has constructed them.
+   * The category describes the work of the outermost instance for the lock
+   * statistics and the prioritized locking of the engine, it is ignored for
+   * nested instances.
+   */
   class JsContext
   {
   public:
-    explicit JsContext(JsEngine& jsEngine);
+    explicit JsContext(JsEngine& jsEngine,
+      JsEngine::LockCategory category = JsEngine::LOCK_CATEGORY_OTHER);
+    ~JsContext();
 
     v8::Local<v8::Context> GetV8Context() const
     {
@@ -34,11 +49,31 @@ namespace AdblockPlus
     }
 
   private:
-    const v8::Locker locker;
-    const v8::Isolate::Scope isolateScope;
-    const v8::HandleScope handleScope;
-    const v8::Local<v8::Context> context;
-    const v8::Context::Scope contextScope;
+    JsContext(const JsContext&);
+    JsContext& operator=(const JsContext&);
+
+    struct OutermostScopes
+    {
+      explicit OutermostScopes(JsEngine& jsEngine);
+      const v8::Locker locker;
+      const v8::Isolate::Scope isolateScope;
+      const v8::HandleScope handleScope;
+      const v8::Local<v8::Context> context;
+      const v8::Context::Scope contextScope;
+    };
+
+    const JsEngine* const jsEngine;
+    JsContext* const parent;
+    const bool isOutermost;
+    const JsEngine::LockCategory category;
+    // Set if the outermost instance has entered the lock gate of the engine.
+    JsLockGate* lockGate;
+    // Set if the outermost instance is recorded in the lock statistics.
+    JsLockProfiler* lockProfiler;
+    std::chrono::steady_clock::time_point lockAcquired;
+    // Contains either OutermostScopes or a v8::HandleScope of a nested context.
+    std::aligned_storage<sizeof(OutermostScopes), alignof(OutermostScopes)>::type scopes;
+    v8::Local<v8::Context> context;
   };
 }
 
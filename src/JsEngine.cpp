@@ -15,10 +15,17 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <AdblockPlus.h>
 #include "GlobalJsObject.h"
 #include "JsContext.h"
 #include "JsError.h"
+#include "JsEventTable.h"
+#include "JsExecutor.h"
+#include "JsLockGate.h"
+#include "JsLockProfiler.h"
+#include "JsWeakValuesTable.h"
 #include "Utils.h"
 #include <libplatform/libplatform.h>
 #include <AdblockPlus/Platform.h>
@@ -47,29 +54,66 @@ namespace
 
   class V8Initializer
   {
-    V8Initializer()
+    explicit V8Initializer(const AdblockPlus::JsEngine::V8Parameters& parameters)
       : platform{nullptr}
     {
-      std::string cmd = "--use_strict";
+      std::string cmd = GetProfileFlags(parameters.profile);
+      cmd += " --use_strict";
+      // V8 does not post background tasks then, so the workers of the
+      // default platform, which are created on demand, are never started.
+      if (parameters.workerThreadCount == 0)
+        cmd += " --single_threaded";
+      for (const auto& flag : parameters.flags)
+        cmd += " " + flag;
       v8::V8::SetFlagsFromString(cmd.c_str(), cmd.length());
-      platform = v8::platform::CreateDefaultPlatform();
+      platform = v8::platform::CreateDefaultPlatform(
+        parameters.workerThreadCount < 0 ? 0 : std::max(parameters.workerThreadCount, 1));
       v8::V8::InitializePlatform(platform);
       v8::V8::Initialize();
     }
 
+    v8::Platform* platform;
+  public:
     ~V8Initializer()
     {
       v8::V8::Dispose();
       v8::V8::ShutdownPlatform();
       delete platform;
     }
-    v8::Platform* platform;
-  public:
-    static void Init()
+
+    static std::string GetProfileFlags(const std::string& profile)
+    {
+      if (profile.empty())
+        return std::string();
+      if (profile == "low-memory")
+        return "--optimize_for_size --lazy --min_semi_space_size=1 --max_semi_space_size=1";
+      if (profile == "throughput")
+        return "--min_semi_space_size=4 --max_semi_space_size=16";
+      throw std::invalid_argument("Unknown V8 profile: " + profile);
+    }
+
+    /**
+     * Initializes V8 unless it is already initialized. It is destroyed at
+     * the application exit.
+     * @return `false` if V8 is already initialized.
+     */
+    static bool Init(const AdblockPlus::JsEngine::V8Parameters& parameters)
     {
-      // it's threadsafe since C++11 and it will be instantiated only once and
-      // destroyed at the application exit
-      static V8Initializer initializer;
+      static std::mutex mutex;
+      static std::unique_ptr<V8Initializer> initializer;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (initializer)
+        return false;
+      initializer.reset(new V8Initializer(parameters));
+      return true;
+    }
+
+    static void Init(bool singleThreaded)
+    {
+      AdblockPlus::JsEngine::V8Parameters parameters;
+      if (singleThreaded)
+        parameters.workerThreadCount = 0;
+      Init(parameters);
     }
   };
 
@@ -80,11 +124,17 @@ namespace
   class ScopedV8Isolate : public AdblockPlus::IV8IsolateProvider
   {
   public:
-    ScopedV8Isolate()
+    explicit ScopedV8Isolate(bool singleThreaded,
+      const AdblockPlus::JsEngine::IsolateParameters& parameters =
+        AdblockPlus::JsEngine::IsolateParameters())
     {
-      V8Initializer::Init();
+      V8Initializer::Init(singleThreaded);
       v8::Isolate::CreateParams isolateParams;
       isolateParams.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+      if (parameters.maxOldGenerationSizeMB > 0)
+        isolateParams.constraints.set_max_old_space_size(parameters.maxOldGenerationSizeMB);
+      if (parameters.maxSemiSpaceSizeMB > 0)
+        isolateParams.constraints.set_max_semi_space_size(parameters.maxSemiSpaceSizeMB);
       isolate = v8::Isolate::New(isolateParams);
     }
 
@@ -106,18 +156,192 @@ namespace
   };
 }
 
-using namespace AdblockPlus;
-
-JsEngine::JsWeakValuesList::~JsWeakValuesList()
+namespace AdblockPlus
 {
+  /**
+   * Counts garbage collections of an isolate and reports when the used heap
+   * size approaches the limit.
+   */
+  class JsHeapObserver
+  {
+  public:
+    JsHeapObserver(v8::Isolate* isolate, const JsEngine::IsolateParameters& parameters)
+      : isolate(isolate)
+      , majorGcCount(0)
+      , minorGcCount(0)
+      , nearHeapLimitCallback(parameters.nearHeapLimitCallback)
+      , nearHeapLimitRatio(parameters.nearHeapLimitRatio)
+    {
+      const v8::Locker locker(isolate);
+      isolate->AddGCEpilogueCallback(&JsHeapObserver::OnGcEpilogue, this);
+    }
+
+    ~JsHeapObserver()
+    {
+      const v8::Locker locker(isolate);
+      isolate->RemoveGCEpilogueCallback(&JsHeapObserver::OnGcEpilogue, this);
+    }
+
+    JsEngine::HeapStatistics GetHeapStatistics()
+    {
+      // No context is entered because it's also called from the GC callback
+      // which can happen while the context is not created yet.
+      const v8::Locker locker(isolate);
+      v8::HeapStatistics v8HeapStatistics;
+      isolate->GetHeapStatistics(&v8HeapStatistics);
+      JsEngine::HeapStatistics heapStatistics;
+      heapStatistics.usedHeapSize = v8HeapStatistics.used_heap_size();
+      heapStatistics.totalHeapSize = v8HeapStatistics.total_heap_size();
+      heapStatistics.heapSizeLimit = v8HeapStatistics.heap_size_limit();
+      // Adjusting by zero just returns the currently registered amount.
+      heapStatistics.externalMemorySize = static_cast<size_t>(
+        isolate->AdjustAmountOfExternalAllocatedMemory(0));
+      heapStatistics.majorGcCount = majorGcCount;
+      heapStatistics.minorGcCount = minorGcCount;
+      return heapStatistics;
+    }
+
+  private:
+    static void OnGcEpilogue(v8::Isolate* isolate, v8::GCType type,
+      v8::GCCallbackFlags flags, void* data)
+    {
+      auto observer = static_cast<JsHeapObserver*>(data);
+      if (type == v8::kGCTypeMarkSweepCompact)
+        ++observer->majorGcCount;
+      else if (type == v8::kGCTypeScavenge)
+        ++observer->minorGcCount;
+      else
+        return;
+      if (!observer->nearHeapLimitCallback)
+        return;
+      auto heapStatistics = observer->GetHeapStatistics();
+      if (heapStatistics.usedHeapSize >= heapStatistics.heapSizeLimit * observer->nearHeapLimitRatio)
+        observer->nearHeapLimitCallback(heapStatistics);
+    }
+
+    v8::Isolate* isolate;
+    std::atomic<uint32_t> majorGcCount;
+    std::atomic<uint32_t> minorGcCount;
+    JsEngine::NearHeapLimitCallback nearHeapLimitCallback;
+    double nearHeapLimitRatio;
+  };
 }
 
+using namespace AdblockPlus;
+
 void JsEngine::NotifyLowMemory()
 {
-  const JsContext context(*this);
+  const JsContext context(*this, LOCK_CATEGORY_GC);
   GetIsolate()->MemoryPressureNotification(v8::MemoryPressureLevel::kCritical);
 }
 
+AdblockPlus::JsEngine::HeapStatistics AdblockPlus::JsEngine::GetHeapStatistics()
+{
+  return heapObserver->GetHeapStatistics();
+}
+
+void JsEngine::SetFileParsingSliceDuration(std::chrono::microseconds duration)
+{
+  fileParsingSliceDuration = duration.count();
+}
+
+std::chrono::microseconds JsEngine::GetFileParsingSliceDuration() const
+{
+  return std::chrono::microseconds(fileParsingSliceDuration.load());
+}
+
+void JsEngine::InitializeV8(const V8Parameters& parameters)
+{
+  V8Initializer::GetProfileFlags(parameters.profile);
+  if (!V8Initializer::Init(parameters))
+    throw std::logic_error("V8 is already initialized");
+}
+
+void JsEngine::StartJsThread()
+{
+  std::lock_guard<std::mutex> lock(jsThreadMutex);
+  if (!jsThread)
+    jsThread.reset(new JsExecutor());
+}
+
+bool JsEngine::HasJsThread() const
+{
+  std::lock_guard<std::mutex> lock(jsThreadMutex);
+  return !!jsThread;
+}
+
+void JsEngine::Dispatch(const std::weak_ptr<JsEngine>& weakJsEngine,
+  const std::function<void()>& task)
+{
+  {
+    auto jsEngine = weakJsEngine.lock();
+    if (!jsEngine)
+      return;
+    std::lock_guard<std::mutex> lock(jsEngine->jsThreadMutex);
+    if (jsEngine->jsThread)
+    {
+      if (!jsEngine->jsThread->IsCurrentThread())
+      {
+        jsEngine->jsThread->Post(task);
+        return;
+      }
+    }
+    else if (jsEngine->platform.PostEmbedderTask(task))
+      return;
+  }
+  task();
+}
+
+void JsEngine::SetLockPriorityParameters(const LockPriorityParameters& parameters)
+{
+  lockGate->SetParameters(parameters);
+}
+
+unsigned JsEngine::GetLockWaitingCount() const
+{
+  if (lockGate->IsEnabled())
+    return lockGate->GetWaitingCount();
+  return lockProfiler->GetWaitingCount();
+}
+
+void JsEngine::SetLockProfilingEnabled(bool enabled)
+{
+  lockProfiler->SetEnabled(enabled);
+}
+
+std::vector<JsEngine::LockStatistics> JsEngine::GetLockStatistics() const
+{
+  return lockProfiler->GetStatistics();
+}
+
+void JsEngine::ResetLockStatistics()
+{
+  lockProfiler->Reset();
+}
+
+std::string JsEngine::LockCategoryToString(LockCategory category)
+{
+  switch (category)
+  {
+  case LOCK_CATEGORY_OTHER:
+    return "other";
+  case LOCK_CATEGORY_MATCH:
+    return "match";
+  case LOCK_CATEGORY_TIMER:
+    return "timer";
+  case LOCK_CATEGORY_FILE_SYSTEM:
+    return "fileSystem";
+  case LOCK_CATEGORY_WEB_REQUEST:
+    return "webRequest";
+  case LOCK_CATEGORY_EVENT:
+    return "event";
+  case LOCK_CATEGORY_GC:
+    return "gc";
+  default:
+    throw std::invalid_argument("Invalid lock category");
+  }
+}
+
 void JsEngine::ScheduleTimer(const v8::FunctionCallbackInfo<v8::Value>& arguments)
 {
   auto jsEngine = FromArguments(arguments);
@@ -138,14 +362,18 @@ void JsEngine::ScheduleTimer(const v8::FunctionCallbackInfo<v8::Value>& argument
         std::chrono::milliseconds(
           arguments[1]->IntegerValue()), [weakJsEngine, timerParamsID]
           {
-            if (auto jsEngine = weakJsEngine.lock())
-              jsEngine->CallTimerTask(timerParamsID);
+            Dispatch(weakJsEngine, [weakJsEngine, timerParamsID]
+            {
+              if (auto jsEngine = weakJsEngine.lock())
+                jsEngine->CallTimerTask(timerParamsID);
+            });
           });
     });
 }
 
 void JsEngine::CallTimerTask(const JsWeakValuesID& timerParamsID)
 {
+  const JsContext context(*this, LOCK_CATEGORY_TIMER);
   auto timerParams = TakeJsValues(timerParamsID);
   JsValue callback = std::move(timerParams[0]);
 
@@ -157,17 +385,46 @@ void JsEngine::CallTimerTask(const JsWeakValuesID& timerParamsID)
 AdblockPlus::JsEngine::JsEngine(Platform& platform, std::unique_ptr<IV8IsolateProvider> isolate)
   : platform(platform)
   , isolate(std::move(isolate))
+  , lockGate(new JsLockGate())
+  , lockProfiler(new JsLockProfiler())
+  , eventCallbacks(new JsEventTable())
+  , jsWeakValues(new JsWeakValuesTable())
+  , fileParsingSliceDuration(0)
+{
+}
+
+AdblockPlus::JsEngine::~JsEngine()
 {
 }
 
 AdblockPlus::JsEnginePtr AdblockPlus::JsEngine::New(const AppInfo& appInfo,
   Platform& platform, std::unique_ptr<IV8IsolateProvider> isolate)
 {
+  auto creationStart = std::chrono::steady_clock::now();
   if (!isolate)
   {
-    isolate.reset(new ScopedV8Isolate());
+    isolate.reset(new ScopedV8Isolate(platform.IsEmbedderDriven()));
   }
+  return New(appInfo, platform, std::move(isolate), IsolateParameters(), creationStart);
+}
+
+AdblockPlus::JsEnginePtr AdblockPlus::JsEngine::New(const AppInfo& appInfo,
+  Platform& platform, const IsolateParameters& isolateParameters)
+{
+  auto creationStart = std::chrono::steady_clock::now();
+  std::unique_ptr<IV8IsolateProvider> isolate(new ScopedV8Isolate(platform.IsEmbedderDriven(), isolateParameters));
+  return New(appInfo, platform, std::move(isolate), isolateParameters, creationStart);
+}
+
+AdblockPlus::JsEnginePtr AdblockPlus::JsEngine::New(const AppInfo& appInfo,
+  Platform& platform, std::unique_ptr<IV8IsolateProvider> isolate,
+  const IsolateParameters& isolateParameters,
+  std::chrono::steady_clock::time_point creationStart)
+{
   JsEnginePtr result(new JsEngine(platform, std::move(isolate)));
+  result->creationStart = creationStart;
+  result->isolateCreated = std::chrono::steady_clock::now();
+  result->heapObserver.reset(new JsHeapObserver(result->GetIsolate(), isolateParameters));
 
   const v8::Locker locker(result->GetIsolate());
   const v8::Isolate::Scope isolateScope(result->GetIsolate());
@@ -177,9 +434,19 @@ AdblockPlus::JsEnginePtr AdblockPlus::JsEngine::New(const AppInfo& appInfo,
     v8::Context::New(result->GetIsolate())));
   auto global = result->GetGlobalObject();
   AdblockPlus::GlobalJsObject::Setup(*result, appInfo, global);
+  result->contextCreated = std::chrono::steady_clock::now();
   return result;
 }
 
+JsEngineSession::JsEngineSession(JsEngine& jsEngine)
+  : context(new JsContext(jsEngine))
+{
+}
+
+JsEngineSession::~JsEngineSession()
+{
+}
+
 AdblockPlus::JsValue AdblockPlus::JsEngine::GetGlobalObject()
 {
   JsContext context(*this);
@@ -202,32 +469,38 @@ AdblockPlus::JsValue AdblockPlus::JsEngine::Evaluate(const std::string& source,
 void AdblockPlus::JsEngine::SetEventCallback(const std::string& eventName,
     const AdblockPlus::JsEngine::EventCallback& callback)
 {
-  if (!callback)
-  {
-    RemoveEventCallback(eventName);
-    return;
-  }
-  std::lock_guard<std::mutex> lock(eventCallbacksMutex);
-  eventCallbacks[eventName] = callback;
+  SetEventCallback(RegisterEvent(eventName), callback);
 }
 
 void AdblockPlus::JsEngine::RemoveEventCallback(const std::string& eventName)
 {
-  std::lock_guard<std::mutex> lock(eventCallbacksMutex);
-  eventCallbacks.erase(eventName);
+  RemoveEventCallback(RegisterEvent(eventName));
 }
 
 void AdblockPlus::JsEngine::TriggerEvent(const std::string& eventName, AdblockPlus::JsValueList&& params)
 {
-  EventCallback callback;
-  {
-    std::lock_guard<std::mutex> lock(eventCallbacksMutex);
-    auto it = eventCallbacks.find(eventName);
-    if (it == eventCallbacks.end())
-      return;
-    callback = it->second;
-  }
-  callback(move(params));
+  TriggerEvent(RegisterEvent(eventName), move(params));
+}
+
+AdblockPlus::JsEngine::EventID AdblockPlus::JsEngine::RegisterEvent(const std::string& eventName)
+{
+  return eventCallbacks->Register(eventName);
+}
+
+void AdblockPlus::JsEngine::SetEventCallback(EventID eventID,
+    const AdblockPlus::JsEngine::EventCallback& callback)
+{
+  eventCallbacks->SetCallback(eventID, callback);
+}
+
+void AdblockPlus::JsEngine::RemoveEventCallback(EventID eventID)
+{
+  eventCallbacks->SetCallback(eventID, EventCallback());
+}
+
+void AdblockPlus::JsEngine::TriggerEvent(EventID eventID, AdblockPlus::JsValueList&& params)
+{
+  eventCallbacks->Trigger(eventID, move(params));
 }
 
 void AdblockPlus::JsEngine::Gc()
@@ -287,37 +560,29 @@ AdblockPlus::JsEnginePtr AdblockPlus::JsEngine::FromArguments(const v8::Function
 
 JsEngine::JsWeakValuesID JsEngine::StoreJsValues(const JsValueList& values)
 {
-  JsWeakValuesLists::iterator it;
-  {
-    std::lock_guard<std::mutex> lock(jsWeakValuesListsMutex);
-    it = jsWeakValuesLists.emplace(jsWeakValuesLists.end());
-  }
+  JsWeakValuesTable::Values* storedValues;
+  JsWeakValuesID retValue;
+  retValue.id = jsWeakValues->Acquire(storedValues);
+  const JsContext context(*this);
+  for (const auto& value : values)
   {
-    JsContext context(*this);
-    for (const auto& value : values)
-    {
-      it->values.emplace_back(GetIsolate(), value.UnwrapValue());
-    }
+    storedValues->emplace_back(GetIsolate(), value.UnwrapValue());
   }
-  JsWeakValuesID retValue;
-  retValue.iterator = it;
   return retValue;
 }
 
 JsValueList JsEngine::TakeJsValues(const JsWeakValuesID& id)
 {
   JsValueList retValue;
+  const JsContext context(*this);
+  auto& storedValues = jsWeakValues->Claim(id.id);
+  auto self = shared_from_this();
+  for (const auto& v8Value : storedValues)
   {
-    JsContext context(*this);
-    for (const auto& v8Value : id.iterator->values)
-    {
-      retValue.emplace_back(JsValue(shared_from_this(), v8::Local<v8::Value>::New(GetIsolate(), v8Value)));
-    }
-  }
-  {
-    std::lock_guard<std::mutex> lock(jsWeakValuesListsMutex);
-    jsWeakValuesLists.erase(id.iterator);
+    retValue.emplace_back(JsValue(self, v8::Local<v8::Value>::New(GetIsolate(), v8Value)));
   }
+  storedValues.clear();
+  jsWeakValues->Release(id.id);
   return retValue;
 }
 
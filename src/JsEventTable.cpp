@@ -0,0 +1,155 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <stdexcept>
+#include "JsEventTable.h"
+
+using AdblockPlus::JsEventTable;
+
+namespace
+{
+  class TriggerGuard
+  {
+  public:
+    explicit TriggerGuard(std::atomic<uint32_t>& activeTriggers)
+      : activeTriggers(activeTriggers)
+    {
+      activeTriggers.fetch_add(1);
+    }
+
+    ~TriggerGuard()
+    {
+      activeTriggers.fetch_sub(1);
+    }
+  private:
+    std::atomic<uint32_t>& activeTriggers;
+  };
+}
+
+JsEventTable::JsEventTable()
+  : activeTriggers(0), hasRetiredCallbacks(false)
+{
+  for (auto& chunk : chunks)
+    chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+JsEventTable::~JsEventTable()
+{
+  for (auto& chunk : chunks)
+  {
+    Slot* slots = chunk.load(std::memory_order_relaxed);
+    if (!slots)
+      break;
+    for (uint32_t i = 0; i < kSlotsPerChunk; ++i)
+      delete slots[i].callback.load(std::memory_order_relaxed);
+    delete[] slots;
+  }
+  for (auto callback : retiredCallbacks)
+    delete callback;
+}
+
+JsEventTable::ID JsEventTable::Register(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = ids.find(name);
+  if (it != ids.end())
+    return it->second;
+
+  ID id = static_cast<ID>(ids.size());
+  if (id % kSlotsPerChunk == 0)
+  {
+    if (id / kSlotsPerChunk >= kMaxChunks)
+      throw std::runtime_error("Too many events registered");
+    chunks[id / kSlotsPerChunk].store(new Slot[kSlotsPerChunk], std::memory_order_release);
+  }
+  ids.emplace(name, id);
+  return id;
+}
+
+void JsEventTable::SetCallback(ID id, const Callback& callback)
+{
+  std::unique_ptr<Callback> newCallback(callback ? new Callback(callback) : nullptr);
+  std::vector<const Callback*> deletedCallbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot* slot = id < ids.size() ? FindSlot(id) : nullptr;
+    if (!slot)
+      throw std::runtime_error("Unknown event ID");
+    const Callback* oldCallback = slot->callback.exchange(newCallback.release());
+    if (oldCallback)
+    {
+      retiredCallbacks.push_back(oldCallback);
+      hasRetiredCallbacks = true;
+    }
+    deletedCallbacks = TakeRetiredCallbacks();
+  }
+  DeleteCallbacks(deletedCallbacks);
+}
+
+void JsEventTable::Trigger(ID id, JsValueList&& params)
+{
+  Slot* slot = FindSlot(id);
+  if (!slot)
+    return;
+  {
+    TriggerGuard guard(activeTriggers);
+    const Callback* callback = slot->callback.load();
+    if (callback)
+      (*callback)(std::move(params));
+  }
+  // A callback removing itself, like the one of "_init", is only retired,
+  // it could keep the engine owning this table alive otherwise.
+  if (!hasRetiredCallbacks)
+    return;
+  std::vector<const Callback*> deletedCallbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    deletedCallbacks = TakeRetiredCallbacks();
+  }
+  DeleteCallbacks(deletedCallbacks);
+}
+
+std::vector<const JsEventTable::Callback*> JsEventTable::TakeRetiredCallbacks()
+{
+  // A trigger which has started before a callback was retired is still
+  // counted here, so retired callbacks can only be deleted when there is
+  // none.
+  std::vector<const Callback*> result;
+  if (activeTriggers.load() == 0)
+  {
+    result.swap(retiredCallbacks);
+    hasRetiredCallbacks = false;
+  }
+  return result;
+}
+
+void JsEventTable::DeleteCallbacks(const std::vector<const Callback*>& callbacks)
+{
+  // Outside of the lock, the callbacks can hold the last reference to the
+  // engine and so to this table.
+  for (auto callback : callbacks)
+    delete callback;
+}
+
+JsEventTable::Slot* JsEventTable::FindSlot(ID id) const
+{
+  if (id / kSlotsPerChunk >= kMaxChunks)
+    return nullptr;
+  Slot* slots = chunks[id / kSlotsPerChunk].load(std::memory_order_acquire);
+  return slots ? slots + id % kSlotsPerChunk : nullptr;
+}
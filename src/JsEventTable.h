@@ -0,0 +1,102 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_JS_EVENT_TABLE_H
+#define ADBLOCK_PLUS_JS_EVENT_TABLE_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <AdblockPlus/JsEngine.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Event callbacks of `JsEngine` addressed by interned event IDs.
+   *
+   * Triggering an event does not take any lock and does not copy the
+   * callback, it only loads the callback pointer from the slot of the event.
+   * Callbacks replaced while an event is being triggered are not destroyed
+   * immediately but retired and deleted as soon as no trigger is in
+   * progress, either by the last trigger or by a later modification.
+   */
+  class JsEventTable
+  {
+  public:
+    typedef JsEngine::EventID ID;
+    typedef JsEngine::EventCallback Callback;
+
+    JsEventTable();
+    ~JsEventTable();
+
+    /**
+     * Returns the ID of the event, the same name always yields the same ID.
+     * @param name Event name.
+     * @return Event ID.
+     */
+    ID Register(const std::string& name);
+
+    /**
+     * Sets the callback for the event.
+     * @param id Event ID returned by `Register()`.
+     * @param callback Event callback, an empty callback removes the current
+     *        one.
+     * @throw `std::runtime_error` if the ID is unknown.
+     */
+    void SetCallback(ID id, const Callback& callback);
+
+    /**
+     * Calls the callback of the event if there is any, unknown IDs are
+     * ignored.
+     * @param id Event ID.
+     * @param params Event parameters.
+     */
+    void Trigger(ID id, JsValueList&& params);
+
+  private:
+    JsEventTable(const JsEventTable&);
+    JsEventTable& operator=(const JsEventTable&);
+
+    static const uint32_t kSlotsPerChunk = 1024;
+    static const uint32_t kMaxChunks = 1024;
+
+    struct Slot
+    {
+      Slot()
+        : callback(nullptr)
+      {
+      }
+      std::atomic<const Callback*> callback;
+    };
+
+    Slot* FindSlot(ID id) const;
+    // Requires the mutex to be locked.
+    std::vector<const Callback*> TakeRetiredCallbacks();
+    static void DeleteCallbacks(const std::vector<const Callback*>& callbacks);
+
+    std::atomic<Slot*> chunks[kMaxChunks];
+    std::atomic<uint32_t> activeTriggers;
+    std::mutex mutex;
+    std::map<std::string, ID> ids;
+    std::vector<const Callback*> retiredCallbacks;
+    std::atomic<bool> hasRetiredCallbacks;
+  };
+}
+
+#endif
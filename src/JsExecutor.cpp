@@ -0,0 +1,84 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JsExecutor.h"
+
+using namespace AdblockPlus;
+
+JsExecutor::JsExecutor()
+  : state(std::make_shared<State>())
+{
+  auto threadState = state;
+  thread = std::thread([threadState]
+  {
+    ThreadFunc(threadState);
+  });
+}
+
+JsExecutor::~JsExecutor()
+{
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->shouldStop = true;
+    state->tasks.clear();
+  }
+  state->hasTasks.notify_one();
+  if (IsCurrentThread())
+    thread.detach();
+  else if (thread.joinable())
+    thread.join();
+}
+
+void JsExecutor::Post(const Task& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->shouldStop)
+      return;
+    state->tasks.push_back(task);
+  }
+  state->hasTasks.notify_one();
+}
+
+void JsExecutor::ThreadFunc(const std::shared_ptr<State>& state)
+{
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (true)
+  {
+    state->hasTasks.wait(lock, [&state]
+    {
+      return state->shouldStop || !state->tasks.empty();
+    });
+    if (state->shouldStop)
+      return;
+    auto task = std::move(state->tasks.front());
+    state->tasks.pop_front();
+    lock.unlock();
+    try
+    {
+      task();
+    }
+    catch (...)
+    {
+      // do nothing, but the thread will be alive.
+    }
+    // the task has to release its captures before the lock is taken again,
+    // they may destroy the executor
+    task = Task();
+    lock.lock();
+  }
+}
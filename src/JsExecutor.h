@@ -0,0 +1,74 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_JS_EXECUTOR_H
+#define ADBLOCK_PLUS_JS_EXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace AdblockPlus
+{
+  /**
+   * Runs posted tasks one after another on a thread of its own.
+   * Tasks which have not started when the executor is destroyed are
+   * discarded. The executor may be destroyed by one of its tasks, then the
+   * thread finishes after the task returns.
+   */
+  class JsExecutor
+  {
+  public:
+    typedef std::function<void()> Task;
+
+    JsExecutor();
+    ~JsExecutor();
+
+    void Post(const Task& task);
+
+    bool IsCurrentThread() const
+    {
+      return std::this_thread::get_id() == thread.get_id();
+    }
+
+  private:
+    JsExecutor(const JsExecutor&);
+    JsExecutor& operator=(const JsExecutor&);
+
+    struct State
+    {
+      State()
+        : shouldStop(false)
+      {
+      }
+      std::mutex mutex;
+      std::condition_variable hasTasks;
+      std::deque<Task> tasks;
+      bool shouldStop;
+    };
+
+    static void ThreadFunc(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> state;
+    std::thread thread;
+  };
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JsLockGate.h"
+
+using namespace AdblockPlus;
+
+JsLockGate::JsLockGate()
+  : enabled(false), busy(false), waitingForeground(0), waitingBackground(0)
+  , foregroundBurst(0), maxForegroundBurst(JsEngine::LockPriorityParameters().maxForegroundBurst)
+{
+}
+
+void JsLockGate::SetParameters(const JsEngine::LockPriorityParameters& parameters)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxForegroundBurst = parameters.maxForegroundBurst;
+  }
+  enabled.store(parameters.enabled, std::memory_order_relaxed);
+  admitted.notify_all();
+}
+
+void JsLockGate::Enter(Priority priority)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (priority == PRIORITY_FOREGROUND)
+  {
+    ++waitingForeground;
+    admitted.wait(lock, [this]
+    {
+      return !busy && (waitingBackground == 0 || foregroundBurst < maxForegroundBurst);
+    });
+    --waitingForeground;
+    ++foregroundBurst;
+  }
+  else
+  {
+    ++waitingBackground;
+    admitted.wait(lock, [this]
+    {
+      return !busy && (waitingForeground == 0 || foregroundBurst >= maxForegroundBurst);
+    });
+    --waitingBackground;
+    foregroundBurst = 0;
+  }
+  busy = true;
+}
+
+void JsLockGate::Leave()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    busy = false;
+  }
+  admitted.notify_all();
+}
+
+unsigned JsLockGate::GetWaitingCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return waitingForeground + waitingBackground;
+}
+
+JsLockGate::Priority JsLockGate::GetPriority(JsEngine::LockCategory category)
+{
+  switch (category)
+  {
+  case JsEngine::LOCK_CATEGORY_OTHER:
+  case JsEngine::LOCK_CATEGORY_MATCH:
+    return PRIORITY_FOREGROUND;
+  default:
+    return PRIORITY_BACKGROUND;
+  }
+}
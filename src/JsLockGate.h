@@ -0,0 +1,84 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_JS_LOCK_GATE_H
+#define ADBLOCK_PLUS_JS_LOCK_GATE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <AdblockPlus/JsEngine.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Admits one thread at a time to the lock of a `JsEngine`, threads doing
+   * foreground work are admitted before the ones doing background work.
+   * To avoid the starvation of the background work, a waiting background
+   * thread is admitted after `maxForegroundBurst` consecutive foreground
+   * admissions.
+   * While the gate is disabled `JsContext` does not enter it and threads
+   * compete for the `v8::Locker` directly.
+   */
+  class JsLockGate
+  {
+  public:
+    enum Priority
+    {
+      PRIORITY_FOREGROUND,
+      PRIORITY_BACKGROUND
+    };
+
+    JsLockGate();
+
+    void SetParameters(const JsEngine::LockPriorityParameters& parameters);
+
+    bool IsEnabled() const
+    {
+      return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Blocks until the thread is admitted.
+     */
+    void Enter(Priority priority);
+
+    /**
+     * Admits the next thread.
+     */
+    void Leave();
+
+    /**
+     * @return Number of threads waiting to be admitted.
+     */
+    unsigned GetWaitingCount() const;
+
+    static Priority GetPriority(JsEngine::LockCategory category);
+  private:
+    std::atomic<bool> enabled;
+    mutable std::mutex mutex;
+    std::condition_variable admitted;
+    bool busy;
+    unsigned waitingForeground;
+    unsigned waitingBackground;
+    // Foreground admissions since the last background admission.
+    unsigned foregroundBurst;
+    unsigned maxForegroundBurst;
+  };
+}
+
+#endif
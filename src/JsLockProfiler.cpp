@@ -0,0 +1,121 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "JsLockProfiler.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  uint64_t ToMicroseconds(JsLockProfiler::Clock::duration duration)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  }
+
+  void UpdateMax(std::atomic<uint64_t>& max, uint64_t value)
+  {
+    auto current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+      !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+  }
+}
+
+JsLockProfiler::JsLockProfiler()
+  : enabled(false), holder(-1), waiting(0)
+{
+  Reset();
+}
+
+void JsLockProfiler::SetEnabled(bool value)
+{
+  enabled.store(value, std::memory_order_relaxed);
+}
+
+JsLockProfiler::Wait JsLockProfiler::BeginWait()
+{
+  Wait wait;
+  wait.holder = holder.load(std::memory_order_relaxed);
+  wait.start = Clock::now();
+  ++waiting;
+  return wait;
+}
+
+JsLockProfiler::Clock::time_point JsLockProfiler::Acquired(Category category, const Wait& wait)
+{
+  auto now = Clock::now();
+  --waiting;
+  holder.store(category, std::memory_order_relaxed);
+  auto waitTime = ToMicroseconds(now - wait.start);
+  auto& entry = entries[category];
+  entry.acquisitions.fetch_add(1, std::memory_order_relaxed);
+  entry.totalWaitTime.fetch_add(waitTime, std::memory_order_relaxed);
+  UpdateMax(entry.maxWaitTime, waitTime);
+  if (wait.holder >= 0)
+    entries[wait.holder].blockingTime.fetch_add(waitTime, std::memory_order_relaxed);
+  return now;
+}
+
+void JsLockProfiler::Released(Category category, Clock::time_point acquired)
+{
+  auto holdTime = ToMicroseconds(Clock::now() - acquired);
+  holder.store(-1, std::memory_order_relaxed);
+  auto& entry = entries[category];
+  entry.totalHoldTime.fetch_add(holdTime, std::memory_order_relaxed);
+  UpdateMax(entry.maxHoldTime, holdTime);
+}
+
+std::vector<JsEngine::LockStatistics> JsLockProfiler::GetStatistics() const
+{
+  std::vector<JsEngine::LockStatistics> result;
+  for (int i = 0; i < JsEngine::LOCK_CATEGORY_COUNT; ++i)
+  {
+    const auto& entry = entries[i];
+    JsEngine::LockStatistics statistics;
+    statistics.category = static_cast<Category>(i);
+    statistics.acquisitions = entry.acquisitions.load(std::memory_order_relaxed);
+    statistics.totalWaitTime = std::chrono::microseconds(entry.totalWaitTime.load(std::memory_order_relaxed));
+    statistics.maxWaitTime = std::chrono::microseconds(entry.maxWaitTime.load(std::memory_order_relaxed));
+    statistics.totalHoldTime = std::chrono::microseconds(entry.totalHoldTime.load(std::memory_order_relaxed));
+    statistics.maxHoldTime = std::chrono::microseconds(entry.maxHoldTime.load(std::memory_order_relaxed));
+    statistics.blockingTime = std::chrono::microseconds(entry.blockingTime.load(std::memory_order_relaxed));
+    result.push_back(statistics);
+  }
+  std::stable_sort(result.begin(), result.end(),
+    [](const JsEngine::LockStatistics& lhs, const JsEngine::LockStatistics& rhs)
+    {
+      if (lhs.blockingTime != rhs.blockingTime)
+        return lhs.blockingTime > rhs.blockingTime;
+      return lhs.totalHoldTime > rhs.totalHoldTime;
+    });
+  return result;
+}
+
+void JsLockProfiler::Reset()
+{
+  for (auto& entry : entries)
+  {
+    entry.acquisitions.store(0, std::memory_order_relaxed);
+    entry.totalWaitTime.store(0, std::memory_order_relaxed);
+    entry.maxWaitTime.store(0, std::memory_order_relaxed);
+    entry.totalHoldTime.store(0, std::memory_order_relaxed);
+    entry.maxHoldTime.store(0, std::memory_order_relaxed);
+    entry.blockingTime.store(0, std::memory_order_relaxed);
+  }
+}
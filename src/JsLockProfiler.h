@@ -0,0 +1,100 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_JS_LOCK_PROFILER_H
+#define ADBLOCK_PLUS_JS_LOCK_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <AdblockPlus/JsEngine.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Records the wait and hold times of the lock of a `JsEngine` per
+   * category of the acquiring work, see `JsEngine::GetLockStatistics()`.
+   * The time a thread waits is attributed to the category holding the lock
+   * when the wait begins.
+   */
+  class JsLockProfiler
+  {
+  public:
+    typedef std::chrono::steady_clock Clock;
+    typedef JsEngine::LockCategory Category;
+
+    struct Wait
+    {
+      Clock::time_point start;
+      // Category holding the lock when the wait began, negative if none.
+      int holder;
+    };
+
+    JsLockProfiler();
+
+    void SetEnabled(bool enabled);
+
+    bool IsEnabled() const
+    {
+      return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Called before acquiring the lock.
+     */
+    Wait BeginWait();
+
+    /**
+     * Called after acquiring the lock.
+     * @return The point in time the lock has been acquired at.
+     */
+    Clock::time_point Acquired(Category category, const Wait& wait);
+
+    /**
+     * Called before releasing the lock.
+     */
+    void Released(Category category, Clock::time_point acquired);
+
+    std::vector<JsEngine::LockStatistics> GetStatistics() const;
+    void Reset();
+
+    /**
+     * @return Number of threads between `BeginWait()` and `Acquired()`.
+     */
+    unsigned GetWaitingCount() const
+    {
+      return waiting.load();
+    }
+  private:
+    struct Entry
+    {
+      std::atomic<uint64_t> acquisitions;
+      std::atomic<uint64_t> totalWaitTime;
+      std::atomic<uint64_t> maxWaitTime;
+      std::atomic<uint64_t> totalHoldTime;
+      std::atomic<uint64_t> maxHoldTime;
+      std::atomic<uint64_t> blockingTime;
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<int> holder;
+    std::atomic<unsigned> waiting;
+    Entry entries[JsEngine::LOCK_CATEGORY_COUNT];
+  };
+}
+
+#endif
@@ -15,6 +15,7 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iterator>
 #include <vector>
 #include <AdblockPlus.h>
 
@@ -24,6 +25,18 @@
 
 using namespace AdblockPlus;
 
+namespace
+{
+  std::vector<std::string> ToStringVector(v8::Local<v8::Array> array)
+  {
+    uint32_t length = array->Length();
+    std::vector<std::string> result(length);
+    for (uint32_t i = 0; i < length; i++)
+      Utils::AppendV8String(array->Get(i), result[i]);
+    return result;
+  }
+}
+
 AdblockPlus::JsValue::JsValue(AdblockPlus::JsEnginePtr jsEngine,
       v8::Handle<v8::Value> value)
     : jsEngine(jsEngine),
@@ -147,10 +160,10 @@ bool AdblockPlus::JsValue::AsBool() const
 
 AdblockPlus::JsValueList AdblockPlus::JsValue::AsList() const
 {
+  const JsContext context(*jsEngine);
   if (!IsArray())
     throw std::runtime_error("Cannot convert a non-array to list");
 
-  const JsContext context(*jsEngine);
   JsValueList result;
   v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(UnwrapValue());
   uint32_t length = array->Length();
@@ -162,27 +175,59 @@ AdblockPlus::JsValueList AdblockPlus::JsValue::AsList() const
   return result;
 }
 
+std::vector<std::string> AdblockPlus::JsValue::AsStringVector() const
+{
+  const JsContext context(*jsEngine);
+  if (!IsArray())
+    throw std::runtime_error("Cannot convert a non-array to list");
+
+  return ToStringVector(v8::Local<v8::Array>::Cast(UnwrapValue()));
+}
+
+std::map<std::string, std::string> AdblockPlus::JsValue::AsStringMap() const
+{
+  auto pairs = AsStringPairs();
+  return std::map<std::string, std::string>(std::make_move_iterator(pairs.begin()),
+    std::make_move_iterator(pairs.end()));
+}
+
+std::vector<std::pair<std::string, std::string>> AdblockPlus::JsValue::AsStringPairs() const
+{
+  const JsContext context(*jsEngine);
+  if (!IsObject())
+    throw std::runtime_error("Cannot convert a non-object to map");
+
+  v8::Local<v8::Object> object = v8::Local<v8::Object>::Cast(UnwrapValue());
+  v8::Local<v8::Array> properties = object->GetOwnPropertyNames();
+  std::vector<std::pair<std::string, std::string>> result;
+  uint32_t length = properties->Length();
+  result.reserve(length);
+  for (uint32_t i = 0; i < length; i++)
+  {
+    v8::Local<v8::Value> property = properties->Get(i);
+    result.emplace_back(Utils::FromV8String(property), std::string());
+    Utils::AppendV8String(object->Get(property), result.back().second);
+  }
+  return result;
+}
+
 std::vector<std::string> AdblockPlus::JsValue::GetOwnPropertyNames() const
 {
+  const JsContext context(*jsEngine);
   if (!IsObject())
     throw std::runtime_error("Attempting to get propert list for a non-object");
 
-  const JsContext context(*jsEngine);
   v8::Local<v8::Object> object = v8::Local<v8::Object>::Cast(UnwrapValue());
-  JsValueList properties = JsValue(jsEngine, object->GetOwnPropertyNames()).AsList();
-  std::vector<std::string> result;
-  for (const auto& property : properties)
-    result.push_back(property.AsString());
-  return result;
+  return ToStringVector(object->GetOwnPropertyNames());
 }
 
 
 AdblockPlus::JsValue AdblockPlus::JsValue::GetProperty(const std::string& name) const
 {
+  const JsContext context(*jsEngine);
   if (!IsObject())
     throw std::runtime_error("Attempting to get property of a non-object");
 
-  const JsContext context(*jsEngine);
   v8::Local<v8::String> property = Utils::ToV8String(jsEngine->GetIsolate(), name);
   v8::Local<v8::Object> obj = v8::Local<v8::Object>::Cast(UnwrapValue());
   return JsValue(jsEngine, obj->Get(property));
@@ -235,10 +280,10 @@ void AdblockPlus::JsValue::SetProperty(const std::string& name, bool val)
 
 std::string AdblockPlus::JsValue::GetClass() const
 {
+  const JsContext context(*jsEngine);
   if (!IsObject())
     throw std::runtime_error("Cannot get constructor of a non-object");
 
-  const JsContext context(*jsEngine);
   v8::Local<v8::Object> obj = v8::Local<v8::Object>::Cast(UnwrapValue());
   return Utils::FromV8String(obj->GetConstructorName());
 }
@@ -277,13 +322,12 @@ JsValue JsValue::Call(const JsValue& arg) const
 
 JsValue JsValue::Call(std::vector<v8::Handle<v8::Value>>& args, v8::Local<v8::Object> thisObj) const
 {
+  const JsContext context(*jsEngine);
   if (!IsFunction())
     throw std::runtime_error("Attempting to call a non-function");
   if (!thisObj->IsObject())
     throw std::runtime_error("`this` pointer has to be an object");
 
-  const JsContext context(*jsEngine);
-
   const v8::TryCatch tryCatch;
   v8::Local<v8::Function> func = v8::Local<v8::Function>::Cast(UnwrapValue());
   v8::Local<v8::Value> result = func->Call(thisObj, args.size(),
@@ -0,0 +1,130 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include "JsWeakValuesTable.h"
+
+using AdblockPlus::JsWeakValuesTable;
+
+namespace
+{
+  uint32_t IndexFromID(JsWeakValuesTable::ID id)
+  {
+    return static_cast<uint32_t>(id);
+  }
+
+  uint32_t GenerationFromID(JsWeakValuesTable::ID id)
+  {
+    return static_cast<uint32_t>(id >> 32);
+  }
+}
+
+JsWeakValuesTable::JsWeakValuesTable()
+  : pageCount(0)
+{
+  for (auto& page : pages)
+    page.store(nullptr, std::memory_order_relaxed);
+}
+
+JsWeakValuesTable::~JsWeakValuesTable()
+{
+  for (uint32_t i = 0; i < pageCount; ++i)
+    delete[] pages[i].load(std::memory_order_relaxed);
+}
+
+JsWeakValuesTable::ID JsWeakValuesTable::Acquire(Values*& values)
+{
+  FreeList& freeList = CurrentFreeList();
+  uint32_t index;
+  if (!PopFreeIndex(freeList, index))
+  {
+    bool found = false;
+    for (auto& otherFreeList : freeLists)
+    {
+      if (&otherFreeList != &freeList && PopFreeIndex(otherFreeList, index))
+      {
+        found = true;
+        break;
+      }
+    }
+    if (!found)
+      index = AddPage(freeList);
+  }
+  Slot* slot = FindSlot(index);
+  uint32_t generation = slot->generation.fetch_add(1) + 1;
+  values = &slot->values;
+  return (static_cast<ID>(generation) << 32) | index;
+}
+
+JsWeakValuesTable::Values& JsWeakValuesTable::Claim(ID id)
+{
+  Slot* slot = FindSlot(IndexFromID(id));
+  uint32_t generation = GenerationFromID(id);
+  if (!slot || !(generation & 1) ||
+      !slot->generation.compare_exchange_strong(generation, generation + 1))
+    throw std::runtime_error("Stored JsValues are already taken or unknown");
+  return slot->values;
+}
+
+void JsWeakValuesTable::Release(ID id)
+{
+  FreeList& freeList = CurrentFreeList();
+  std::lock_guard<std::mutex> lock(freeList.mutex);
+  freeList.indices.push_back(IndexFromID(id));
+}
+
+JsWeakValuesTable::Slot* JsWeakValuesTable::FindSlot(uint32_t index)
+{
+  if (index / kSlotsPerPage >= kMaxPages)
+    return nullptr;
+  Slot* page = pages[index / kSlotsPerPage].load(std::memory_order_acquire);
+  return page ? page + index % kSlotsPerPage : nullptr;
+}
+
+bool JsWeakValuesTable::PopFreeIndex(FreeList& freeList, uint32_t& index)
+{
+  std::lock_guard<std::mutex> lock(freeList.mutex);
+  if (freeList.indices.empty())
+    return false;
+  index = freeList.indices.back();
+  freeList.indices.pop_back();
+  return true;
+}
+
+uint32_t JsWeakValuesTable::AddPage(FreeList& freeList)
+{
+  uint32_t firstIndex;
+  {
+    std::lock_guard<std::mutex> lock(pagesMutex);
+    if (pageCount == kMaxPages)
+      throw std::runtime_error("Too many stored JsValues");
+    pages[pageCount].store(new Slot[kSlotsPerPage], std::memory_order_release);
+    firstIndex = pageCount++ * kSlotsPerPage;
+  }
+  std::lock_guard<std::mutex> lock(freeList.mutex);
+  for (uint32_t index = firstIndex + kSlotsPerPage - 1; index > firstIndex; --index)
+    freeList.indices.push_back(index);
+  return firstIndex;
+}
+
+JsWeakValuesTable::FreeList& JsWeakValuesTable::CurrentFreeList()
+{
+  size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return freeLists[hash % kFreeListCount];
+}
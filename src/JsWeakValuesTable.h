@@ -0,0 +1,111 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_JS_WEAK_VALUES_TABLE_H
+#define ADBLOCK_PLUS_JS_WEAK_VALUES_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <v8.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Storage of value lists for `JsEngine::StoreJsValues`.
+   *
+   * Value lists live in slots which are allocated in pages and addressed by
+   * compact IDs combining the slot index with the generation of the slot.
+   * The generation changes whenever a slot is acquired or claimed, so a
+   * stale ID is detected instead of touching a reused slot.
+   * Free slots are kept in several free lists, each with its own mutex and
+   * chosen by the current thread, what keeps the contention low. Slots are
+   * never deallocated before the table and keep the capacity of their value
+   * lists, so in the steady state storing and taking values does not
+   * allocate memory.
+   */
+  class JsWeakValuesTable
+  {
+  public:
+    typedef std::vector<v8::Global<v8::Value>> Values;
+    typedef uint64_t ID;
+
+    JsWeakValuesTable();
+    ~JsWeakValuesTable();
+
+    /**
+     * Reserves a free slot.
+     * @param values Receives the empty value list of the slot.
+     * @return ID of the slot.
+     */
+    ID Acquire(Values*& values);
+
+    /**
+     * Claims the slot for taking its values, the ID becomes stale after
+     * that. Once the values are extracted the slot should be released.
+     * @param id ID of the slot.
+     * @return Value list of the slot.
+     * @throw `std::runtime_error` if the ID is stale or unknown.
+     */
+    Values& Claim(ID id);
+
+    /**
+     * Returns a claimed slot to the free list, the values of the slot
+     * should be cleared before that.
+     * @param id ID of the claimed slot.
+     */
+    void Release(ID id);
+
+  private:
+    JsWeakValuesTable(const JsWeakValuesTable&);
+    JsWeakValuesTable& operator=(const JsWeakValuesTable&);
+
+    static const uint32_t kSlotsPerPage = 256;
+    static const uint32_t kMaxPages = 1024;
+    static const uint32_t kFreeListCount = 8;
+
+    struct Slot
+    {
+      Slot()
+        : generation(0)
+      {
+      }
+      // Odd while the slot is in use, even while it is free or claimed.
+      std::atomic<uint32_t> generation;
+      Values values;
+    };
+
+    struct FreeList
+    {
+      std::mutex mutex;
+      std::vector<uint32_t> indices;
+    };
+
+    Slot* FindSlot(uint32_t index);
+    bool PopFreeIndex(FreeList& freeList, uint32_t& index);
+    uint32_t AddPage(FreeList& freeList);
+    FreeList& CurrentFreeList();
+
+    std::atomic<Slot*> pages[kMaxPages];
+    std::mutex pagesMutex;
+    uint32_t pageCount;
+    FreeList freeLists[kFreeListCount];
+  };
+}
+
+#endif
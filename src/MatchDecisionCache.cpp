@@ -0,0 +1,99 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MatchDecisionCache.h"
+
+using namespace AdblockPlus;
+
+MatchDecisionCache::MatchDecisionCache(size_t maxCount)
+  : maxCount(maxCount), generation(0)
+{
+}
+
+bool MatchDecisionCache::Get(const std::string& key, uint64_t filterGeneration, std::string& filterText)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!SetGeneration(filterGeneration))
+    return false;
+  auto it = index.find(key);
+  if (it == index.end())
+    return false;
+  entries.splice(entries.begin(), entries, it->second);
+  filterText = it->second->second;
+  return true;
+}
+
+void MatchDecisionCache::Put(const std::string& key, uint64_t filterGeneration, const std::string& filterText)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!SetGeneration(filterGeneration) || maxCount == 0)
+    return;
+  auto it = index.find(key);
+  if (it != index.end())
+  {
+    it->second->second = filterText;
+    entries.splice(entries.begin(), entries, it->second);
+    return;
+  }
+  entries.emplace_front(key, filterText);
+  index[key] = entries.begin();
+  if (entries.size() > maxCount)
+  {
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+std::vector<MatchDecisionCache::Decision> MatchDecisionCache::GetRecent(uint64_t filterGeneration,
+  size_t maxCount)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<Decision> result;
+  if (!SetGeneration(filterGeneration))
+    return result;
+  for (auto it = entries.begin(); it != entries.end() && result.size() < maxCount; ++it)
+    result.push_back(*it);
+  return result;
+}
+
+std::string MatchDecisionCache::GetKey(const std::string& url, uint32_t contentTypeMask,
+  const std::vector<std::string>& documentUrls)
+{
+  // URLs never contain line breaks.
+  std::string key = std::to_string(contentTypeMask);
+  key += '\n';
+  key += url;
+  for (const auto& documentUrl : documentUrls)
+  {
+    key += '\n';
+    key += documentUrl;
+  }
+  return key;
+}
+
+bool MatchDecisionCache::SetGeneration(uint64_t filterGeneration)
+{
+  if (filterGeneration < generation)
+    return false;
+  if (filterGeneration > generation)
+  {
+    generation = filterGeneration;
+    entries.clear();
+    index.clear();
+  }
+  return true;
+}
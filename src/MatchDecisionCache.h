@@ -0,0 +1,76 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_MATCH_DECISION_CACHE_H
+#define ADBLOCK_PLUS_MATCH_DECISION_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Least recently used cache of the texts of the filters matched by
+   * `FilterEngine::Matches()`, bounded by the number of entries.
+   * Like `ElementHidingCache` it only keeps the entries of the newest filter
+   * generation.
+   */
+  class MatchDecisionCache
+  {
+  public:
+    typedef std::pair<std::string, std::string> Decision;
+
+    explicit MatchDecisionCache(size_t maxCount);
+
+    /**
+     * @param filterText Receives the text of the matching filter, empty if
+     *        nothing matches.
+     * @return `false` if there is no entry for the key and generation.
+     */
+    bool Get(const std::string& key, uint64_t filterGeneration, std::string& filterText);
+
+    void Put(const std::string& key, uint64_t filterGeneration, const std::string& filterText);
+
+    /**
+     * @return Keys and filter texts of the entries of the generation, the
+     *         most recently used first.
+     */
+    std::vector<Decision> GetRecent(uint64_t filterGeneration, size_t maxCount);
+
+    static std::string GetKey(const std::string& url, uint32_t contentTypeMask,
+      const std::vector<std::string>& documentUrls);
+
+  private:
+    typedef std::list<Decision> Entries;
+
+    // Requires the mutex to be locked.
+    bool SetGeneration(uint64_t filterGeneration);
+
+    std::mutex mutex;
+    size_t maxCount;
+    uint64_t generation;
+    Entries entries;
+    std::unordered_map<std::string, Entries::iterator> index;
+  };
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include <AdblockPlus/JsEngine.h>
 #include <AdblockPlus/Notification.h>
 #include <algorithm>
+#include "JsContext.h"
 
 using namespace AdblockPlus;
 
@@ -109,18 +110,13 @@ NotificationTexts Notification::GetTexts() const
 
 std::vector<std::string> Notification::GetLinks() const
 {
-  std::vector<std::string> retValue;
+  const JsContext context(*jsEngine);
   JsValue jsLinks = GetProperty("links");
   if (!jsLinks.IsArray())
   {
-    return retValue;
-  }
-  JsValueList urlLinksList = jsLinks.AsList();
-  for (const auto& link : urlLinksList)
-  {
-    retValue.push_back(link.AsString());
+    return std::vector<std::string>();
   }
-  return retValue;
+  return jsLinks.AsStringVector();
 }
 
 void Notification::MarkAsShown()
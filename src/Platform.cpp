@@ -21,6 +21,8 @@
 #include "DefaultTimer.h"
 #include "DefaultWebRequest.h"
 #include "DefaultFileSystem.h"
+#include "EmbedderTaskQueue.h"
+#include "FilePrefetcher.h"
 #include <stdexcept>
 
 using namespace AdblockPlus;
@@ -43,11 +45,13 @@ namespace
 #define ASSIGN_PLATFORM_PARAM(param) ValidatePlatformCreationParameter(param = std::move(creationParameters.param), #param)
 
 Platform::Platform(CreationParameters&& creationParameters)
+  : filePrefetcher(std::make_shared<FilePrefetcher>())
 {
   ASSIGN_PLATFORM_PARAM(logSystem);
   ASSIGN_PLATFORM_PARAM(timer);
   ASSIGN_PLATFORM_PARAM(fileSystem);
   ASSIGN_PLATFORM_PARAM(webRequest);
+  metrics = std::move(creationParameters.metrics);
 }
 
 Platform::~Platform()
@@ -62,6 +66,14 @@ void Platform::SetUpJsEngine(const AppInfo& appInfo, std::unique_ptr<IV8IsolateP
   jsEngine = JsEngine::New(appInfo, *this, std::move(isolate));
 }
 
+void Platform::SetUpJsEngine(const AppInfo& appInfo, const JsEngine::IsolateParameters& isolateParameters)
+{
+  std::lock_guard<std::mutex> lock(modulesMutex);
+  if (jsEngine)
+    return;
+  jsEngine = JsEngine::New(appInfo, *this, isolateParameters);
+}
+
 JsEngine& Platform::GetJsEngine()
 {
   SetUpJsEngine();
@@ -80,6 +92,12 @@ void Platform::CreateFilterEngineAsync(const FilterEngine::CreationParameters& p
     filterEngine = filterEnginePromise->get_future();
   }
 
+  // patterns.ini is read and split into lines while V8 is being initialized
+  // and the scripts are being evaluated, they read it then at once.
+  WithFileSystem([this](IFileSystem& fileSystem)
+  {
+    filePrefetcher->Start(fileSystem, "patterns.ini", GetFilterParsingThreadCount());
+  });
   GetJsEngine(); // ensures that JsEngine is instantiated
   FilterEngine::CreateAsync(jsEngine, [this, onCreated, filterEnginePromise](const FilterEnginePtr& filterEngine)
   {
@@ -92,7 +110,51 @@ void Platform::CreateFilterEngineAsync(const FilterEngine::CreationParameters& p
 FilterEngine& Platform::GetFilterEngine()
 {
   CreateFilterEngineAsync();
-  return *std::shared_future<FilterEnginePtr>(filterEngine).get();
+  std::shared_future<FilterEnginePtr> result(filterEngine);
+  if (taskQueue)
+  {
+    // nobody else runs the tasks creating FilterEngine.
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      if (taskQueue->RunUntilIdle() == 0)
+        taskQueue->WaitForTask();
+    }
+  }
+  return *result.get();
+}
+
+unsigned Platform::GetFilterParsingThreadCount() const
+{
+  // an embedder-driven platform has no threads of its own.
+  return IsEmbedderDriven() ? 1 : 0;
+}
+
+FilePrefetcher& Platform::GetFilePrefetcher()
+{
+  return *filePrefetcher;
+}
+
+size_t Platform::Poll()
+{
+  return taskQueue ? taskQueue->Poll() : 0;
+}
+
+size_t Platform::RunUntilIdle()
+{
+  return taskQueue ? taskQueue->RunUntilIdle() : 0;
+}
+
+std::chrono::milliseconds Platform::GetTimeUntilNextTask() const
+{
+  return taskQueue ? taskQueue->GetTimeUntilNextTask() : std::chrono::milliseconds::max();
+}
+
+bool Platform::PostEmbedderTask(const SchedulerTask& task)
+{
+  if (!taskQueue || taskQueue->IsPollingOnCurrentThread())
+    return false;
+  taskQueue->Post(task);
+  return true;
 }
 
 void Platform::WithTimer(const WithTimerCallback& callback)
@@ -125,9 +187,12 @@ namespace
   {
   public:
     typedef std::shared_ptr<Scheduler> AsyncExecutorPtr;
-    explicit DefaultPlatform(const AsyncExecutorPtr& asyncExecutor, CreationParameters&& creationParams)
+    explicit DefaultPlatform(const AsyncExecutorPtr& asyncExecutor,
+      const std::shared_ptr<EmbedderTaskQueue>& embedderTaskQueue,
+      CreationParameters&& creationParams)
       : Platform(std::move(creationParams)), asyncExecutor(asyncExecutor)
     {
+      taskQueue = embedderTaskQueue;
     }
     ~DefaultPlatform();
 
@@ -184,6 +249,8 @@ namespace
 
 Scheduler DefaultPlatformBuilder::GetDefaultAsyncExecutor()
 {
+  if (!defaultScheduler && taskQueue)
+    defaultScheduler = taskQueue->GetScheduler();
   if (!defaultScheduler)
   {
     asyncExecutor = std::make_shared<Scheduler>(::DummyScheduler);
@@ -199,21 +266,33 @@ Scheduler DefaultPlatformBuilder::GetDefaultAsyncExecutor()
   return defaultScheduler;
 }
 
+void DefaultPlatformBuilder::EnableEmbedderDrivenMode()
+{
+  if (taskQueue)
+    return;
+  if (defaultScheduler)
+    throw std::logic_error("EnableEmbedderDrivenMode must be called before constructing default implementations");
+  taskQueue = std::make_shared<EmbedderTaskQueue>();
+}
+
 void DefaultPlatformBuilder::CreateDefaultTimer()
 {
-  timer.reset(new DefaultTimer());
+  if (taskQueue)
+    timer = taskQueue->CreateTimer();
+  else
+    timer.reset(new DefaultTimer());
 }
 
 void DefaultPlatformBuilder::CreateDefaultFileSystem(const std::string& basePath)
 {
-  fileSystem.reset(new DefaultFileSystem(GetDefaultAsyncExecutor(), std::unique_ptr<DefaultFileSystemSync>(new DefaultFileSystemSync(basePath))));
+  fileSystem.reset(new DefaultFileSystem(GetDefaultAsyncExecutor(), std::unique_ptr<DefaultFileSystemSync>(new DefaultFileSystemSync(basePath)), metrics));
 }
 
 void DefaultPlatformBuilder::CreateDefaultWebRequest(std::unique_ptr<IWebRequestSync> webRequest)
 {
   if (!webRequest)
     webRequest.reset(new DefaultWebRequestSync());
-  this->webRequest.reset(new DefaultWebRequest(GetDefaultAsyncExecutor(), std::move(webRequest)));
+  this->webRequest.reset(new DefaultWebRequest(GetDefaultAsyncExecutor(), std::move(webRequest), metrics));
 }
 
 void DefaultPlatformBuilder::CreateDefaultLogSystem()
@@ -232,7 +311,8 @@ std::unique_ptr<Platform> DefaultPlatformBuilder::CreatePlatform()
   if (!webRequest)
     CreateDefaultWebRequest();
 
-  std::unique_ptr<Platform> platform(new DefaultPlatform(asyncExecutor, std::move(*this)));
+  std::unique_ptr<Platform> platform(new DefaultPlatform(asyncExecutor, taskQueue, std::move(*this)));
   asyncExecutor.reset();
+  taskQueue.reset();
   return platform;
 }
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_SCOPED_LATENCY_H
+#define ADBLOCK_PLUS_SCOPED_LATENCY_H
+
+#include <chrono>
+#include <AdblockPlus/IMetrics.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Records the lifetime of the instance into a histogram of the metrics.
+   * Without metrics it does not even read the clock.
+   */
+  class ScopedLatency
+  {
+  public:
+    ScopedLatency(IMetrics* metrics, IMetrics::Histogram histogram)
+      : metrics(metrics), histogram(histogram)
+    {
+      if (metrics)
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedLatency()
+    {
+      if (metrics)
+        metrics->Record(histogram, std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start));
+    }
+
+  private:
+    ScopedLatency(const ScopedLatency&);
+    ScopedLatency& operator=(const ScopedLatency&);
+
+    IMetrics* const metrics;
+    const IMetrics::Histogram histogram;
+    std::chrono::steady_clock::time_point start;
+  };
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include "StartupTimelineRecorder.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  std::string EscapeJsonString(const std::string& value)
+  {
+    std::string result;
+    for (auto c : value)
+    {
+      switch (c)
+      {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          result += ' ';
+        else
+          result += c;
+      }
+    }
+    return result;
+  }
+}
+
+StartupTimelineRecorder::StartupTimelineRecorder(Clock::time_point origin)
+  : origin(origin)
+{
+}
+
+void StartupTimelineRecorder::Add(const std::string& name,
+  Clock::time_point start, Clock::time_point end)
+{
+  FilterEngine::StartupPhase phase;
+  phase.name = name;
+  phase.start = std::chrono::duration_cast<std::chrono::microseconds>(start - origin);
+  phase.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::lock_guard<std::mutex> lock(mutex);
+  phases.push_back(phase);
+}
+
+void StartupTimelineRecorder::Begin(const std::string& name)
+{
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mutex);
+  startedPhases[name] = now;
+}
+
+void StartupTimelineRecorder::End(const std::string& name)
+{
+  auto now = Clock::now();
+  Clock::time_point start;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = startedPhases.find(name);
+    if (it == startedPhases.end())
+      return;
+    start = it->second;
+    startedPhases.erase(it);
+  }
+  Add(name, start, now);
+}
+
+FilterEngine::StartupTimeline StartupTimelineRecorder::GetTimeline() const
+{
+  FilterEngine::StartupTimeline result;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    result = phases;
+  }
+  std::stable_sort(result.begin(), result.end(),
+    [](const FilterEngine::StartupPhase& lhs, const FilterEngine::StartupPhase& rhs)
+    {
+      return lhs.start < rhs.start;
+    });
+  return result;
+}
+
+std::string StartupTimelineRecorder::GetTraceJson() const
+{
+  std::stringstream json;
+  json << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& phase : GetTimeline())
+  {
+    if (!first)
+      json << ",";
+    first = false;
+    json << "{\"name\":\"" << EscapeJsonString(phase.name) << "\""
+         << ",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+         << ",\"ts\":" << phase.start.count()
+         << ",\"dur\":" << phase.duration.count() << "}";
+  }
+  json << "],\"displayTimeUnit\":\"ms\"}";
+  return json.str();
+}
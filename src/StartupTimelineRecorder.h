@@ -0,0 +1,67 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_STARTUP_TIMELINE_RECORDER_H
+#define ADBLOCK_PLUS_STARTUP_TIMELINE_RECORDER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <AdblockPlus/FilterEngine.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Collects the phases of the filter engine startup. Phases are either
+   * added with known bounds or started and finished by name, e.g. by the
+   * JS code via the `_startupPhase` event.
+   */
+  class StartupTimelineRecorder
+  {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param origin Point in time all phases are relative to.
+     */
+    explicit StartupTimelineRecorder(Clock::time_point origin);
+
+    void Add(const std::string& name, Clock::time_point start, Clock::time_point end);
+
+    /**
+     * Starts the phase, restarting an unfinished phase of the same name
+     * discards it.
+     */
+    void Begin(const std::string& name);
+
+    /**
+     * Finishes the phase, it is ignored if the phase has not been started.
+     */
+    void End(const std::string& name);
+
+    FilterEngine::StartupTimeline GetTimeline() const;
+    std::string GetTraceJson() const;
+  private:
+    const Clock::time_point origin;
+    mutable std::mutex mutex;
+    std::map<std::string, Clock::time_point> startedPhases;
+    FilterEngine::StartupTimeline phases;
+  };
+}
+
+#endif
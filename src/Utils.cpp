@@ -28,11 +28,28 @@ using namespace AdblockPlus;
 
 std::string Utils::FromV8String(const v8::Handle<v8::Value>& value)
 {
-  v8::String::Utf8Value stringValue(value);
-  if (stringValue.length())
-    return std::string(*stringValue, stringValue.length());
-  else
-    return std::string();
+  std::string result;
+  AppendV8String(value, result);
+  return result;
+}
+
+void Utils::AppendV8String(const v8::Handle<v8::Value>& value, std::string& output)
+{
+  if (!value->IsString())
+  {
+    v8::String::Utf8Value stringValue(value);
+    if (stringValue.length())
+      output.append(*stringValue, stringValue.length());
+    return;
+  }
+  v8::Local<v8::String> stringValue = v8::Local<v8::String>::Cast(value);
+  int length = stringValue->Utf8Length();
+  if (!length)
+    return;
+  size_t offset = output.size();
+  output.resize(offset + length);
+  stringValue->WriteUtf8(&output[offset], length, nullptr,
+    v8::String::NO_NULL_TERMINATION);
 }
 
 StringBuffer Utils::StringBufferFromV8String(const v8::Handle<v8::Value>& value)
@@ -32,6 +32,9 @@ namespace AdblockPlus
   namespace Utils
   {
     std::string FromV8String(const v8::Handle<v8::Value>& value);
+    // Appends the UTF-8 representation of the value to the output, strings
+    // are written directly into the output without intermediate copies.
+    void AppendV8String(const v8::Handle<v8::Value>& value, std::string& output);
     StringBuffer StringBufferFromV8String(const v8::Handle<v8::Value>& value);
     v8::Local<v8::String> ToV8String(v8::Isolate* isolate, const std::string& str);
     v8::Local<v8::String> StringBufferToV8String(v8::Isolate* isolate, const StringBuffer& bytes);
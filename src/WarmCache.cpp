@@ -0,0 +1,197 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include "WarmCache.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const std::string header = "[Adblock Plus warm cache 2]";
+
+  // Records are "<tag> <numbers...>\n" followed by the strings which lengths
+  // are given by the numbers and a line break, so no escaping is necessary.
+  class Reader
+  {
+  public:
+    explicit Reader(const IFileSystem::IOBuffer& data)
+      : data(data), pos(0)
+    {
+    }
+
+    bool AtEnd() const
+    {
+      return pos >= data.size();
+    }
+
+    bool ReadLine(std::string& line)
+    {
+      size_t end = pos;
+      while (end < data.size() && data[end] != '\n')
+        ++end;
+      if (end >= data.size())
+        return false;
+      line.assign(data.begin() + pos, data.begin() + end);
+      pos = end + 1;
+      return true;
+    }
+
+    bool ReadString(size_t length, std::string& value)
+    {
+      if (data.size() - pos < length)
+        return false;
+      value.assign(data.begin() + pos, data.begin() + pos + length);
+      pos += length;
+      return true;
+    }
+
+    bool ReadLineBreak()
+    {
+      if (AtEnd() || data[pos] != '\n')
+        return false;
+      ++pos;
+      return true;
+    }
+
+  private:
+    const IFileSystem::IOBuffer& data;
+    size_t pos;
+  };
+
+  bool ParseNumbers(const std::string& line, size_t count, size_t* numbers)
+  {
+    const char* current = line.c_str() + 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (*current != ' ')
+        return false;
+      char* end;
+      numbers[i] = std::strtoul(current + 1, &end, 10);
+      if (end == current + 1)
+        return false;
+      current = end;
+    }
+    return *current == 0;
+  }
+
+  void Append(IFileSystem::IOBuffer& data, const std::string& value)
+  {
+    data.insert(data.end(), value.begin(), value.end());
+  }
+
+  // 64-bit FNV-1a, unlike std::hash it is the same for every build.
+  const uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+
+  uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+  {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  std::string HashPatternsIni(const std::string& appVersion, const void* patternsIni, size_t size)
+  {
+    uint64_t hash = HashBytes(fnvOffsetBasis, appVersion.data(), appVersion.size());
+    // the version can't contain a line break.
+    hash = HashBytes(hash, "\n", 1);
+    hash = HashBytes(hash, patternsIni, size);
+    char result[17];
+    std::snprintf(result, sizeof(result), "%08x%08x",
+      static_cast<unsigned>(hash >> 32), static_cast<unsigned>(hash & 0xFFFFFFFF));
+    return result;
+  }
+}
+
+IFileSystem::IOBuffer WarmCache::Serialize() const
+{
+  IFileSystem::IOBuffer data;
+  Append(data, header + "\n" + filterStateHash + "\n");
+  for (const auto& styleSheet : styleSheets)
+  {
+    Append(data, "S " + std::to_string(styleSheet.kind) + " " +
+      std::to_string(styleSheet.domain.size()) + " " +
+      std::to_string(styleSheet.selectors.size()) + "\n");
+    Append(data, styleSheet.domain);
+    Append(data, styleSheet.selectors);
+    data.push_back('\n');
+  }
+  for (const auto& matchDecision : matchDecisions)
+  {
+    Append(data, "M " + std::to_string(matchDecision.key.size()) + " " +
+      std::to_string(matchDecision.filterText.size()) + "\n");
+    Append(data, matchDecision.key);
+    Append(data, matchDecision.filterText);
+    data.push_back('\n');
+  }
+  return data;
+}
+
+bool WarmCache::Parse(const IFileSystem::IOBuffer& data)
+{
+  Reader reader(data);
+  std::string line;
+  if (!reader.ReadLine(line) || line != header || !reader.ReadLine(filterStateHash))
+    return false;
+  styleSheets.clear();
+  matchDecisions.clear();
+  while (!reader.AtEnd())
+  {
+    if (!reader.ReadLine(line) || line.empty())
+      return false;
+    size_t numbers[3];
+    if (line[0] == 'S' && ParseNumbers(line, 3, numbers))
+    {
+      StyleSheet styleSheet;
+      styleSheet.kind = static_cast<int>(numbers[0]);
+      if (!reader.ReadString(numbers[1], styleSheet.domain) ||
+          !reader.ReadString(numbers[2], styleSheet.selectors))
+        return false;
+      styleSheets.push_back(std::move(styleSheet));
+    }
+    else if (line[0] == 'M' && ParseNumbers(line, 2, numbers))
+    {
+      MatchDecision matchDecision;
+      if (!reader.ReadString(numbers[0], matchDecision.key) ||
+          !reader.ReadString(numbers[1], matchDecision.filterText))
+        return false;
+      matchDecisions.push_back(std::move(matchDecision));
+    }
+    else
+      return false;
+    if (!reader.ReadLineBreak())
+      return false;
+  }
+  return true;
+}
+
+std::string AdblockPlus::HashFilterState(const std::string& appVersion,
+  const IFileSystem::IOBuffer& patternsIni)
+{
+  return HashPatternsIni(appVersion, patternsIni.data(), patternsIni.size());
+}
+
+std::string AdblockPlus::HashFilterState(const std::string& appVersion,
+  const std::string& patternsIni)
+{
+  return HashPatternsIni(appVersion, patternsIni.data(), patternsIni.size());
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_WARM_CACHE_H
+#define ADBLOCK_PLUS_WARM_CACHE_H
+
+#include <AdblockPlus/IFileSystem.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Filtering results persisted across restarts, they are only valid for
+   * the filters loaded from patterns.ini with the same hash, see
+   * `HashFilterState()`.
+   */
+  struct WarmCache
+  {
+    struct StyleSheet
+    {
+      // ElementHidingCache::Kind
+      int kind;
+      std::string domain;
+      std::string selectors;
+    };
+
+    struct MatchDecision
+    {
+      std::string key;
+      // empty if nothing matches.
+      std::string filterText;
+    };
+
+    std::string filterStateHash;
+    // the most recently used results come first.
+    std::vector<StyleSheet> styleSheets;
+    std::vector<MatchDecision> matchDecisions;
+
+    IFileSystem::IOBuffer Serialize() const;
+
+    /**
+     * @return `false` if the data is not a warm cache of the current format.
+     */
+    bool Parse(const IFileSystem::IOBuffer& data);
+  };
+
+  /**
+   * Results of an applied warm cache by key, they are used while the filters
+   * are the ones loaded at the startup.
+   */
+  struct WarmResults
+  {
+    // by ElementHidingCache::Kind and domain
+    std::map<std::pair<int, std::string>, std::string> styleSheets;
+    // by MatchDecisionCache::GetKey()
+    std::unordered_map<std::string, std::string> matchDecisions;
+  };
+
+  /**
+   * @param patternsIni Content of patterns.ini, either as read or as it is
+   *        written when the current filters are saved.
+   * @return Hash of the filters loaded from patterns.ini by the given
+   *         version of the application, stable across restarts.
+   */
+  std::string HashFilterState(const std::string& appVersion, const IFileSystem::IOBuffer& patternsIni);
+  std::string HashFilterState(const std::string& appVersion, const std::string& patternsIni);
+}
+
+#endif
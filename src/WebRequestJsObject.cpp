@@ -28,6 +28,7 @@ using namespace AdblockPlus;
 void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arguments)
 {
   AdblockPlus::JsEnginePtr jsEngine = AdblockPlus::JsEngine::FromArguments(arguments);
+  const AdblockPlus::JsContext context(*jsEngine);
   AdblockPlus::JsValueList converted = jsEngine->ConvertArguments(arguments);
   if (converted.size() != 3u)
     throw std::runtime_error("GET requires exactly 3 arguments");
@@ -42,12 +43,11 @@ void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arg
     if (!headersObj.IsObject())
       throw std::runtime_error("Second argument to GET must be an object");
 
-    std::vector<std::string> properties = headersObj.GetOwnPropertyNames();
-    for (const auto& header : properties)
+    // in the order of the properties, not sorted.
+    for (auto& header : headersObj.AsStringPairs())
     {
-      std::string headerValue = headersObj.GetProperty(header).AsString();
-      if (header.length() && headerValue.length())
-        headers.push_back(std::pair<std::string, std::string>(header, headerValue));
+      if (header.first.length() && header.second.length())
+        headers.push_back(std::move(header));
     }
   }
 
@@ -56,15 +56,14 @@ void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arg
 
   auto paramsID = jsEngine->StoreJsValues(converted);
   std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
-  auto getCallback = [weakJsEngine, paramsID](const ServerResponse& response)
+  auto onResponse = [weakJsEngine, paramsID](const ServerResponse& response)
   {
     auto jsEngine = weakJsEngine.lock();
     if (!jsEngine)
       return;
+    const AdblockPlus::JsContext context(*jsEngine, JsEngine::LOCK_CATEGORY_WEB_REQUEST);
     auto webRequestParams = jsEngine->TakeJsValues(paramsID);
 
-    AdblockPlus::JsContext context(*jsEngine);
-
     auto resultObject = jsEngine->NewObject();
     resultObject.SetProperty("status", response.status);
     resultObject.SetProperty("responseStatus", response.responseStatus);
@@ -79,6 +78,10 @@ void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arg
 
     webRequestParams[2].Call(resultObject);
   };
+  auto getCallback = [weakJsEngine, onResponse](const ServerResponse& response)
+  {
+    JsEngine::Dispatch(weakJsEngine, std::bind(onResponse, response));
+  };
   jsEngine->GetPlatform().WithWebRequest(
     [url, headers, getCallback](IWebRequest& webRequest)
     {
@@ -0,0 +1,119 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <gtest/gtest.h>
+#include "BaseJsTest.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class MetricsFilterEngineTest : public BaseJsTest
+  {
+  protected:
+    std::shared_ptr<DefaultMetrics> metrics;
+
+    void SetUp() override
+    {
+      LazyFileSystem* fileSystem;
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new LazyLogSystem());
+      platformParams.timer.reset(new NoopTimer());
+      platformParams.fileSystem.reset(fileSystem = new LazyFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platformParams.metrics = metrics = std::make_shared<DefaultMetrics>();
+      platform.reset(new Platform(std::move(platformParams)));
+      ::CreateFilterEngine(*fileSystem, *platform);
+    }
+  };
+}
+
+TEST(LatencyHistogramTest, EmptyHistogram)
+{
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.GetCount());
+  EXPECT_EQ(0, histogram.GetMax().count());
+  EXPECT_EQ(0, histogram.GetPercentile(50).count());
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact)
+{
+  LatencyHistogram histogram;
+  for (int i = 0; i < 10; ++i)
+    histogram.Record(std::chrono::microseconds(i));
+  EXPECT_EQ(10u, histogram.GetCount());
+  EXPECT_EQ(9, histogram.GetMax().count());
+  EXPECT_EQ(4, histogram.GetPercentile(50).count());
+  EXPECT_EQ(9, histogram.GetPercentile(100).count());
+}
+
+TEST(LatencyHistogramTest, PercentilesHaveBoundedError)
+{
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 100000; ++i)
+    histogram.Record(std::chrono::microseconds(i));
+  EXPECT_EQ(100000u, histogram.GetCount());
+  EXPECT_EQ(100000, histogram.GetMax().count());
+  for (auto percentile : {50.0, 90.0, 99.0, 99.9})
+  {
+    auto expected = percentile * 1000;
+    auto actual = histogram.GetPercentile(percentile).count();
+    EXPECT_GE(actual, expected);
+    EXPECT_LE(actual, expected * (1 + 1.0 / 16)) << percentile;
+  }
+  EXPECT_EQ(100000, histogram.GetPercentile(100).count());
+
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.GetCount());
+  EXPECT_EQ(0, histogram.GetPercentile(99).count());
+}
+
+TEST(DefaultMetricsTest, CountersAndHistograms)
+{
+  DefaultMetrics metrics;
+  metrics.Increment(IMetrics::COUNTER_FILE_READS, 1);
+  metrics.Increment(IMetrics::COUNTER_FILE_BYTES_READ, 42);
+  metrics.Record(IMetrics::HISTOGRAM_FILE_READ, std::chrono::microseconds(7));
+  EXPECT_EQ(1u, metrics.GetCounter(IMetrics::COUNTER_FILE_READS));
+  EXPECT_EQ(42u, metrics.GetCounter(IMetrics::COUNTER_FILE_BYTES_READ));
+  EXPECT_EQ(0u, metrics.GetCounter(IMetrics::COUNTER_FILE_WRITES));
+  EXPECT_EQ(1u, metrics.GetHistogram(IMetrics::HISTOGRAM_FILE_READ).GetCount());
+  EXPECT_EQ(0u, metrics.GetHistogram(IMetrics::HISTOGRAM_FILE_WRITE).GetCount());
+
+  metrics.Reset();
+  EXPECT_EQ(0u, metrics.GetCounter(IMetrics::COUNTER_FILE_BYTES_READ));
+  EXPECT_EQ(0u, metrics.GetHistogram(IMetrics::HISTOGRAM_FILE_READ).GetCount());
+}
+
+TEST_F(MetricsFilterEngineTest, MatchesAndJsContextAreMeasured)
+{
+  auto& filterEngine = platform->GetFilterEngine();
+  EXPECT_LT(0u, metrics->GetCounter(IMetrics::COUNTER_JS_CONTEXT_ACQUISITIONS));
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_MATCHES));
+
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  metrics->Reset();
+  EXPECT_TRUE(filterEngine.Matches("http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  EXPECT_FALSE(filterEngine.Matches("http://example.org/image.gif", FilterEngine::CONTENT_TYPE_IMAGE, ""));
+
+  EXPECT_EQ(2u, metrics->GetCounter(IMetrics::COUNTER_MATCHES));
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_MATCHES_BLOCKED));
+  EXPECT_EQ(2u, metrics->GetHistogram(IMetrics::HISTOGRAM_MATCHES).GetCount());
+  EXPECT_LE(2u, metrics->GetCounter(IMetrics::COUNTER_JS_CONTEXT_ACQUISITIONS));
+  EXPECT_LE(2u, metrics->GetHistogram(IMetrics::HISTOGRAM_JS_CONTEXT_WAIT).GetCount());
+}
@@ -361,6 +361,21 @@ TEST_F(FileSystemJsObject_ReadFromFileTest, Lines)
     {"first", "second", "third"});
 }
 
+TEST_F(FileSystemJsObject_ReadFromFileTest, KeywordsOfFilters)
+{
+  std::string content =
+    "[Subscription filters]\n"
+    "||Example.com/ad.png\n"
+    "example.com##.ad\n";
+  mockFileSystem->contentToRead.assign(content.begin(), content.end());
+  GetJsEngine().Evaluate(R"js(
+let keywords = [];
+_fileSystem.readFromFile("foo",
+  (line, keyword) => keywords.push(String(keyword)),
+  (error) => {});)js");
+  EXPECT_EQ("undefined,example,undefined", GetJsEngine().Evaluate("keywords.join()").AsString());
+}
+
 TEST_F(FileSystemJsObject_ReadFromFileTest, ProcessLineThrowsException)
 {
   std::string content = "1\n2\n3";
@@ -401,4 +416,102 @@ _fileSystem.readFromFile("foo",
 });)js");
   EXPECT_EQ(2u, readLines.size());
   EXPECT_EQ("Error: my-error at undefined:8", error);
-}
\ No newline at end of file
+}
+
+TEST_F(FileSystemJsObjectTest, ProcessLinesWithoutSlices)
+{
+  GetJsEngine().Evaluate("let lines = []; let result = _processLines('a\\nb', (line) => lines.push(line), () => {});");
+  EXPECT_FALSE(GetJsEngine().Evaluate("result").AsBool());
+  EXPECT_EQ(0, GetJsEngine().Evaluate("lines.length").AsInt());
+}
+
+namespace
+{
+  class FileSystemJsObjectWithTimerTest : public FileSystemJsObjectTest
+  {
+  protected:
+    DelayedTimer::SharedTasks timerTasks;
+
+    void SetUp() override
+    {
+      ThrowingPlatformCreationParameters params;
+      params.fileSystem.reset(mockFileSystem = new MockFileSystem());
+      params.timer = DelayedTimer::New(timerTasks);
+      platform.reset(new AdblockPlus::Platform(std::move(params)));
+    }
+  };
+}
+
+TEST_F(FileSystemJsObjectWithTimerTest, ReadFromFileInSlices)
+{
+  const int lineCount = 1000;
+  std::string content;
+  for (int i = 0; i < lineCount; ++i)
+    content += "line" + std::to_string(i) + "\n";
+  mockFileSystem->contentToRead.assign(content.begin(), content.end());
+
+  auto& jsEngine = GetJsEngine();
+  jsEngine.SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  std::vector<std::string> readLines;
+  bool isOnDoneCalled = false;
+  jsEngine.SetEventCallback("onLine", [&readLines](JsValueList&& jsArgs)
+  {
+    readLines.push_back(jsArgs[0].AsString());
+  });
+  jsEngine.SetEventCallback("onDone", [&isOnDoneCalled](JsValueList&& jsArgs)
+  {
+    EXPECT_EQ(0u, jsArgs.size());
+    isOnDoneCalled = true;
+  });
+  jsEngine.Evaluate(R"js(_fileSystem.readFromFile("foo",
+  (line) => _triggerEvent("onLine", line),
+  (error) => error ? _triggerEvent("onDone", error) : _triggerEvent("onDone"));)js");
+
+  EXPECT_FALSE(isOnDoneCalled);
+  EXPECT_LT(readLines.size(), static_cast<size_t>(lineCount));
+  EXPECT_FALSE(timerTasks->empty());
+
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  EXPECT_TRUE(isOnDoneCalled);
+  ASSERT_EQ(static_cast<size_t>(lineCount), readLines.size());
+  for (int i = 0; i < lineCount; ++i)
+    EXPECT_EQ("line" + std::to_string(i), readLines[i]);
+}
+
+TEST_F(FileSystemJsObjectWithTimerTest, ProcessLinesInSlices)
+{
+  const int lineCount = 1000;
+  auto& jsEngine = GetJsEngine();
+  jsEngine.SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  jsEngine.Evaluate(R"js(
+let text = "";
+for (let i = 0; i < )js" + std::to_string(lineCount) + R"js(; i++)
+  text += "line" + i + "\r\n";
+let lines = [];
+let isDone = false;
+let result = _processLines(text, (line) => lines.push(line), () => isDone = true);)js");
+
+  EXPECT_TRUE(jsEngine.Evaluate("result").AsBool());
+  EXPECT_FALSE(jsEngine.Evaluate("isDone").AsBool());
+  EXPECT_LT(jsEngine.Evaluate("lines.length").AsInt(), lineCount);
+
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  EXPECT_TRUE(jsEngine.Evaluate("isDone").AsBool());
+  ASSERT_EQ(lineCount, jsEngine.Evaluate("lines.length").AsInt());
+  EXPECT_EQ("line999", jsEngine.Evaluate("lines[999]").AsString());
+}
+
+TEST_F(FileSystemJsObjectWithTimerTest, ProcessLinesPassesNoKeywords)
+{
+  auto& jsEngine = GetJsEngine();
+  jsEngine.SetFileParsingSliceDuration(std::chrono::milliseconds(100));
+  jsEngine.Evaluate(R"js(
+let lines = [];
+_processLines("\n[Subscription filters]\r\n\r\n||example.com/ad.png\n",
+  (...args) => lines.push(args), () => {});)js");
+
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  ASSERT_EQ(2, jsEngine.Evaluate("lines.length").AsInt());
+  EXPECT_EQ("[Subscription filters]", jsEngine.Evaluate("lines[0].join()").AsString());
+  EXPECT_EQ("||example.com/ad.png", jsEngine.Evaluate("lines[1].join()").AsString());
+}
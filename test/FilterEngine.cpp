@@ -17,8 +17,12 @@
 
 #include "BaseJsTest.h"
 #include <AdblockPlus/DefaultLogSystem.h>
+#include <algorithm>
+#include <limits>
+#include <list>
 #include <thread>
 #include <condition_variable>
+#include <future>
 
 using namespace AdblockPlus;
 
@@ -74,15 +78,31 @@ namespace
 
   class FilterEngineWithInMemoryFS : public BaseJsTest
   {
-    LazyFileSystem* fileSystem;
+    InMemoryFileSystem* fileSystem;
   protected:
+    std::shared_ptr<DefaultMetrics> metrics;
+
     void InitPlatformAndAppInfo(const AppInfo& appInfo = AppInfo())
+    {
+      InitPlatform(new InMemoryFileSystem(), appInfo);
+    }
+
+    // Recreates the platform keeping the files, like a restart.
+    void RestartPlatform(const AppInfo& appInfo = AppInfo())
+    {
+      std::unique_ptr<InMemoryFileSystem> files(new InMemoryFileSystem(*fileSystem));
+      platform.reset();
+      InitPlatform(files.release(), appInfo);
+    }
+
+    void InitPlatform(InMemoryFileSystem* files, const AppInfo& appInfo)
     {
       ThrowingPlatformCreationParameters platformParams;
       platformParams.logSystem.reset(new LazyLogSystem());
       platformParams.timer.reset(new NoopTimer());
-      platformParams.fileSystem.reset(fileSystem = new InMemoryFileSystem());
+      platformParams.fileSystem.reset(fileSystem = files);
       platformParams.webRequest.reset(new NoopWebRequest());
+      platformParams.metrics = metrics = std::make_shared<DefaultMetrics>();
       platform.reset(new Platform(std::move(platformParams)));
       platform->SetUpJsEngine(appInfo);
     }
@@ -92,6 +112,126 @@ namespace
       ::CreateFilterEngine(*fileSystem, *platform, creationParams);
       return platform->GetFilterEngine();
     }
+
+    // Without subscriptions chosen on the first run patterns.ini only keeps
+    // the filters added by the test, the prefs belong to the current
+    // platform.
+    FilterEngine::CreationParameters WarmCacheCreationParameters()
+    {
+      FilterEngine::CreationParameters createParams;
+      createParams.preconfiguredPrefs.emplace("first_run_subscription_auto_select", GetJsEngine().NewValue(false));
+      createParams.warmCacheFileName = "warmcache.dat";
+      return createParams;
+    }
+  };
+
+  class TwoSubscriptionsFileSystem : public LazyFileSystem
+  {
+  public:
+    // saved with the priority subscriptions first, like the progressive
+    // startup does.
+    TwoSubscriptionsFileSystem()
+      : patternsIni("# Adblock Plus preferences\nversion=5\nprioritySubscriptions=1\n"
+          "[Subscription]\nurl=~user~0000\n"
+          "[Subscription filters]\n||example.com/user-ad.png\n"
+          "[Subscription]\nurl=https://example.org/list.txt\n"
+          "[Subscription filters]\n||example.com/list-ad.png\n")
+    {
+    }
+
+    void Read(const std::string& fileName, const ReadCallback& callback) const override
+    {
+      if (fileName != "patterns.ini")
+        return LazyFileSystem::Read(fileName, callback);
+      std::string data = patternsIni;
+      scheduler([callback, data]
+      {
+        callback(IOBuffer(data.cbegin(), data.cend()), "");
+      });
+    }
+
+    std::string patternsIni;
+  };
+
+  class ReadRecordingFileSystem : public LazyFileSystem
+  {
+  public:
+    void Read(const std::string& fileName, const ReadCallback& callback) const override
+    {
+      readFileNames.push_back(fileName);
+      LazyFileSystem::Read(fileName, callback);
+    }
+
+    mutable std::vector<std::string> readFileNames;
+  };
+
+  class FilterEngineProgressiveStartupTest : public BaseJsTest
+  {
+  protected:
+    TwoSubscriptionsFileSystem* fileSystem;
+    std::list<LazyFileSystem::Task> fileSystemTasks;
+    DelayedTimer::SharedTasks timerTasks;
+
+    void SetUp() override
+    {
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new LazyLogSystem());
+      platformParams.timer = DelayedTimer::New(timerTasks);
+      platformParams.fileSystem.reset(fileSystem = new TwoSubscriptionsFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platform.reset(new Platform(std::move(platformParams)));
+      fileSystem->scheduler = [this](const LazyFileSystem::Task& task)
+      {
+        fileSystemTasks.emplace_back(task);
+      };
+    }
+
+    // Runs the first pending file system task or otherwise the first
+    // immediate timer, e.g. the next slice of patterns.ini.
+    bool RunNextTask()
+    {
+      if (!fileSystemTasks.empty())
+      {
+        auto task = fileSystemTasks.front();
+        fileSystemTasks.pop_front();
+        task();
+        return true;
+      }
+      auto ii = std::find_if(timerTasks->begin(), timerTasks->end(),
+        [](const DelayedTimerTask& task)
+        {
+          return task.timeout.count() == 0;
+        });
+      if (ii == timerTasks->end())
+        return false;
+      auto task = *ii;
+      timerTasks->erase(ii);
+      task.callback();
+      return true;
+    }
+  };
+
+  class FilterEngineWithDelayedTimerTest : public BaseJsTest
+  {
+  protected:
+    DelayedTimer::SharedTasks timerTasks;
+
+    void SetUp() override
+    {
+      LazyFileSystem* fileSystem;
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new LazyLogSystem());
+      platformParams.timer = DelayedTimer::New(timerTasks);
+      platformParams.fileSystem.reset(fileSystem = new LazyFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platform.reset(new Platform(std::move(platformParams)));
+      ::CreateFilterEngine(*fileSystem, *platform);
+    }
+
+    FilterEngine& GetFilterEngine()
+    {
+      return platform->GetFilterEngine();
+    }
   };
 
   class FilterEngineIsSubscriptionDownloadAllowedTest : public BaseJsTest
@@ -383,6 +523,167 @@ TEST_F(FilterEngineTest, Matches)
   ASSERT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, match12->GetType());
 }
 
+TEST_F(FilterEngineTest, AsyncCallsRunOnJsThread)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  filterEngine.GetFilter("##.ad").AddToList();
+  std::mutex mutex;
+  std::thread::id matchingThreadId;
+  GetJsEngine().SetEventCallback("matching", [&mutex, &matchingThreadId](JsValueList&&)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    matchingThreadId = std::this_thread::get_id();
+  });
+  GetJsEngine().Evaluate("let checkFilterMatch = API.checkFilterMatch;"
+    "API.checkFilterMatch = (...args) => {_triggerEvent('matching'); return checkFilterMatch(...args);}");
+  EXPECT_FALSE(GetJsEngine().HasJsThread());
+  GetJsEngine().StartJsThread();
+  GetJsEngine().StartJsThread();
+  EXPECT_TRUE(GetJsEngine().HasJsThread());
+
+  auto matchFuture = filterEngine.MatchesAsync("http://example.org/adbanner.gif",
+    AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, std::vector<std::string>());
+  ASSERT_EQ(std::future_status::ready, matchFuture.wait_for(std::chrono::seconds(10)));
+  auto match = matchFuture.get();
+  ASSERT_TRUE(match);
+  EXPECT_EQ("adbanner.gif", match->GetProperty("text").AsString());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_NE(std::thread::id(), matchingThreadId);
+    EXPECT_NE(std::this_thread::get_id(), matchingThreadId);
+  }
+
+  auto selectorsFuture = filterEngine.GetElementHidingSelectorsAsync("example.org");
+  ASSERT_EQ(std::future_status::ready, selectorsFuture.wait_for(std::chrono::seconds(10)));
+  auto selectors = selectorsFuture.get();
+  ASSERT_EQ(1u, selectors.size());
+  EXPECT_EQ(".ad", selectors[0]);
+}
+
+TEST_F(FilterEngineTest, AsyncCallsPassExceptions)
+{
+  auto& filterEngine = GetFilterEngine();
+  GetJsEngine().Evaluate("API.checkFilterMatch = () => {throw new Error('matching failed');};"
+    "API.getElementHidingStyleSheet = () => {throw new Error('hiding failed');};");
+  GetJsEngine().StartJsThread();
+
+  auto matchFuture = filterEngine.MatchesAsync("http://example.org/adbanner.gif",
+    AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, std::vector<std::string>());
+  ASSERT_EQ(std::future_status::ready, matchFuture.wait_for(std::chrono::seconds(10)));
+  EXPECT_THROW(matchFuture.get(), std::exception);
+
+  auto selectorsFuture = filterEngine.GetElementHidingSelectorsAsync("example.org");
+  ASSERT_EQ(std::future_status::ready, selectorsFuture.wait_for(std::chrono::seconds(10)));
+  EXPECT_THROW(selectorsFuture.get(), std::exception);
+}
+
+TEST(FilterEngineEmbedderDrivenTest, TasksRunOnlyWhenPolled)
+{
+  AdblockPlus::DefaultPlatformBuilder platformBuilder;
+  platformBuilder.EnableEmbedderDrivenMode();
+  platformBuilder.logSystem.reset(new LazyLogSystem());
+  platformBuilder.fileSystem.reset(new LazyFileSystem());
+  platformBuilder.webRequest.reset(new NoopWebRequest());
+  auto platform = platformBuilder.CreatePlatform();
+  ASSERT_TRUE(platform->IsEmbedderDriven());
+  // the filters are parsed without internal threads as well.
+  EXPECT_EQ(1u, platform->GetFilterParsingThreadCount());
+
+  // drives the loop internally until the engine is created
+  auto& filterEngine = platform->GetFilterEngine();
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  platform->RunUntilIdle();
+
+  auto& jsEngine = platform->GetJsEngine();
+  jsEngine.Evaluate("var timerFired = false; setTimeout(function() {timerFired = true;}, 0)");
+  auto matchFuture = filterEngine.MatchesAsync("http://example.org/adbanner.gif",
+    AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, std::vector<std::string>());
+  EXPECT_FALSE(jsEngine.Evaluate("timerFired").AsBool());
+  EXPECT_EQ(std::future_status::timeout, matchFuture.wait_for(std::chrono::seconds(0)));
+  EXPECT_EQ(std::chrono::milliseconds::zero(), platform->GetTimeUntilNextTask());
+
+  EXPECT_LE(2u, platform->RunUntilIdle());
+  EXPECT_TRUE(jsEngine.Evaluate("timerFired").AsBool());
+  ASSERT_EQ(std::future_status::ready, matchFuture.wait_for(std::chrono::seconds(0)));
+  EXPECT_TRUE(matchFuture.get());
+  EXPECT_EQ(0u, platform->Poll());
+}
+
+TEST(FilterEngineEmbedderDrivenTest, ModeIsEnabledBeforeDefaultImplementations)
+{
+  AdblockPlus::DefaultPlatformBuilder platformBuilder;
+  platformBuilder.CreateDefaultFileSystem();
+  EXPECT_THROW(platformBuilder.EnableEmbedderDrivenMode(), std::logic_error);
+}
+
+TEST_F(FilterEngineTest, ElementHidingStyleSheetCache)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("##.ad").AddToList();
+  filterEngine.GetFilter("example.org##div.local, span.local").AddToList();
+
+  auto styleSheet = filterEngine.GetElementHidingStyleSheet("example.org");
+  ASSERT_EQ(2u, styleSheet->GetSelectorCount());
+  std::vector<std::string> selectors;
+  for (size_t i = 0; i < styleSheet->GetSelectorCount(); ++i)
+    selectors.push_back(styleSheet->selectors.substr(styleSheet->offsets[i], styleSheet->GetSelectorLength(i)));
+  std::sort(selectors.begin(), selectors.end());
+  EXPECT_EQ(".ad", selectors[0]);
+  EXPECT_EQ("div.local, span.local", selectors[1]);
+  EXPECT_EQ(filterEngine.GetFilterGeneration(), styleSheet->filterGeneration);
+  EXPECT_EQ(styleSheet, filterEngine.GetElementHidingStyleSheet("example.org"));
+  EXPECT_EQ(1u, filterEngine.GetElementHidingStyleSheet("example.com")->GetSelectorCount());
+
+  auto filterGeneration = filterEngine.GetFilterGeneration();
+  filterEngine.GetFilter("##.banner").AddToList();
+  EXPECT_LT(filterGeneration, filterEngine.GetFilterGeneration());
+  auto updatedStyleSheet = filterEngine.GetElementHidingStyleSheet("example.org");
+  EXPECT_NE(styleSheet, updatedStyleSheet);
+  EXPECT_EQ(3u, updatedStyleSheet->GetSelectorCount());
+  EXPECT_EQ(3u, filterEngine.GetElementHidingSelectors("example.org").size());
+
+  filterEngine.SetElementHidingCacheSize(0);
+  EXPECT_NE(updatedStyleSheet, filterEngine.GetElementHidingStyleSheet("example.org"));
+}
+
+TEST_F(FilterEngineTest, GenericElementHidingStyleSheetAndDelta)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("##.generic").AddToList();
+  filterEngine.GetFilter("~example.com##.conditional").AddToList();
+  filterEngine.GetFilter("example.org##.specific").AddToList();
+
+  auto toSelectors = [](const AdblockPlus::ElementHidingStyleSheetPtr& styleSheet)
+  {
+    std::vector<std::string> selectors;
+    for (size_t i = 0; i < styleSheet->GetSelectorCount(); ++i)
+      selectors.push_back(styleSheet->selectors.substr(styleSheet->offsets[i], styleSheet->GetSelectorLength(i)));
+    std::sort(selectors.begin(), selectors.end());
+    return selectors;
+  };
+
+  auto generic = filterEngine.GetGenericElementHidingStyleSheet();
+  EXPECT_EQ(std::vector<std::string>({".generic"}), toSelectors(generic));
+  EXPECT_EQ(filterEngine.GetFilterGeneration(), generic->filterGeneration);
+  EXPECT_EQ(generic, filterEngine.GetGenericElementHidingStyleSheet());
+
+  EXPECT_EQ(std::vector<std::string>({".conditional", ".specific"}),
+    toSelectors(filterEngine.GetElementHidingStyleSheetDelta("example.org")));
+  EXPECT_EQ(std::vector<std::string>({".specific"}),
+    toSelectors(filterEngine.GetElementHidingStyleSheetDelta("example.org", true)));
+  EXPECT_TRUE(toSelectors(filterEngine.GetElementHidingStyleSheetDelta("example.com")).empty());
+  EXPECT_EQ(std::vector<std::string>({".conditional", ".generic", ".specific"}),
+    toSelectors(filterEngine.GetElementHidingStyleSheet("example.org")));
+
+  filterEngine.GetFilter("example.net#@#.generic").AddToList();
+  auto updatedGeneric = filterEngine.GetGenericElementHidingStyleSheet();
+  EXPECT_LT(generic->filterGeneration, updatedGeneric->filterGeneration);
+  EXPECT_TRUE(toSelectors(updatedGeneric).empty());
+  EXPECT_EQ(std::vector<std::string>({".conditional", ".generic", ".specific"}),
+    toSelectors(filterEngine.GetElementHidingStyleSheetDelta("example.org")));
+}
+
 TEST_F(FilterEngineTest, MatchesOnWhitelistedDomain)
 {
   auto& filterEngine = GetFilterEngine();
@@ -561,6 +862,45 @@ TEST_F(FilterEngineTestNoData, FirstRunFlag)
   ASSERT_TRUE(GetFilterEngine().IsFirstRun());
 }
 
+TEST_F(FilterEngineTest, JsEngineIsDestroyedWithPlatform)
+{
+  // Callbacks of the initialization hold the engines, they must not outlive
+  // the events which have removed them.
+  std::weak_ptr<JsEngine> jsEngine = platform->GetJsEngine().shared_from_this();
+  platform.reset();
+  EXPECT_TRUE(jsEngine.expired());
+}
+
+TEST_F(FilterEngineTest, StartupTimeline)
+{
+  auto timeline = GetFilterEngine().GetStartupTimeline();
+  auto findPhase = [&timeline](const std::string& name) -> const FilterEngine::StartupPhase*
+  {
+    auto it = std::find_if(timeline.begin(), timeline.end(),
+      [&name](const FilterEngine::StartupPhase& phase)
+      {
+        return phase.name == name;
+      });
+    return it != timeline.end() ? &*it : nullptr;
+  };
+
+  for (const auto& name : {"jsEngine.isolate", "jsEngine.context",
+    "evaluate compat.js", "evaluate filterStorage.js", "evaluate api.js",
+    "read prefs.json", "read patterns.ini", "filters.load", "filterEngine.init"})
+    EXPECT_TRUE(findPhase(name)) << name;
+
+  for (size_t i = 1; i < timeline.size(); ++i)
+    EXPECT_LE(timeline[i - 1].start, timeline[i].start);
+  auto init = findPhase("filterEngine.init");
+  auto patterns = findPhase("read patterns.ini");
+  ASSERT_TRUE(init && patterns);
+  EXPECT_LE(patterns->start + patterns->duration, init->start + init->duration);
+
+  auto traceJson = GetFilterEngine().GetStartupTimelineTraceJson();
+  EXPECT_EQ(0u, traceJson.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, traceJson.find("\"name\":\"read patterns.ini\""));
+}
+
 TEST_F(FilterEngineTest, SetRemoveFilterChangeCallback)
 {
   auto& filterEngine = GetFilterEngine();
@@ -578,6 +918,39 @@ TEST_F(FilterEngineTest, SetRemoveFilterChangeCallback)
   EXPECT_EQ(1, timesCalled);
 }
 
+TEST_F(FilterEngineWithDelayedTimerTest, FilterChangeBatchCallback)
+{
+  auto& filterEngine = GetFilterEngine();
+  std::vector<std::vector<FilterEngine::FilterChangeBatch>> calls;
+  FilterEngine::FilterChangeBatchOptions options;
+  options.includeFilterTexts = true;
+  filterEngine.SetFilterChangeBatchCallback([&calls](const std::vector<FilterEngine::FilterChangeBatch>& batches)
+  {
+    calls.push_back(batches);
+  }, options);
+  filterEngine.GetFilter("foo").AddToList();
+  filterEngine.GetFilter("bar").AddToList();
+  filterEngine.GetFilter("foo").RemoveFromList();
+  EXPECT_TRUE(calls.empty());
+
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  ASSERT_EQ(1u, calls.size());
+  auto batch = std::find_if(calls[0].begin(), calls[0].end(), [](const FilterEngine::FilterChangeBatch& batch)
+  {
+    return !batch.subscriptionUrl.empty();
+  });
+  ASSERT_NE(calls[0].end(), batch);
+  EXPECT_EQ(2, batch->filtersAdded);
+  EXPECT_EQ(1, batch->filtersRemoved);
+  EXPECT_EQ(std::vector<std::string>({"foo", "bar"}), batch->addedFilters);
+  EXPECT_EQ(std::vector<std::string>({"foo"}), batch->removedFilters);
+
+  filterEngine.RemoveFilterChangeBatchCallback();
+  filterEngine.GetFilter("bar").RemoveFromList();
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  EXPECT_EQ(1u, calls.size());
+}
+
 TEST_F(FilterEngineTest, DocumentWhitelisting)
 {
   auto& filterEngine = GetFilterEngine();
@@ -608,6 +981,111 @@ TEST_F(FilterEngineTest, DocumentWhitelisting)
       documentUrls1));
 }
 
+TEST_F(FilterEngineTest, ElementHidingRules)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("##.a").AddToList();
+  filterEngine.GetFilter("##.b").AddToList();
+  filterEngine.GetFilter("##.c").AddToList();
+  filterEngine.GetFilter("example.org##.d").AddToList();
+
+  auto rules = filterEngine.GetElementHidingRules("example.org", 3);
+  EXPECT_EQ(3u, rules->groupSize);
+  ASSERT_EQ(2u, rules->GetRuleCount());
+  auto firstRule = rules->rules.substr(rules->offsets[0], rules->GetRuleLength(0));
+  auto secondRule = rules->rules.substr(rules->offsets[1], rules->GetRuleLength(1));
+  EXPECT_EQ(2u, std::count(firstRule.begin(), firstRule.end(), ','));
+  EXPECT_EQ(" {display: none !important;}", firstRule.substr(firstRule.size() - 28));
+  EXPECT_EQ(0u, std::count(secondRule.begin(), secondRule.end(), ','));
+  EXPECT_EQ('\n', rules->rules.back());
+  EXPECT_EQ(rules, filterEngine.GetElementHidingRules("example.org", 3));
+
+  auto singleRule = filterEngine.GetElementHidingRules("example.org", 0);
+  ASSERT_EQ(1u, singleRule->GetRuleCount());
+  EXPECT_EQ(4u, filterEngine.GetElementHidingRules("example.org", 1)->GetRuleCount());
+
+  auto generic = filterEngine.GetGenericElementHidingRules(2);
+  EXPECT_EQ(2u, generic->GetRuleCount());
+  auto delta = filterEngine.GetElementHidingRulesDelta("example.org", 2);
+  ASSERT_EQ(1u, delta->GetRuleCount());
+  EXPECT_EQ(".d {display: none !important;}\n", delta->rules);
+  EXPECT_EQ(0u, filterEngine.GetElementHidingRulesDelta("example.com", 2)->GetRuleCount());
+
+  filterEngine.GetFilter("##.e").AddToList();
+  auto updatedRules = filterEngine.GetElementHidingRules("example.org", 3);
+  EXPECT_NE(rules, updatedRules);
+  EXPECT_LT(rules->filterGeneration, updatedRules->filterGeneration);
+  EXPECT_EQ(2u, updatedRules->GetRuleCount());
+}
+
+TEST_F(FilterEngineTest, ElementHidingEmulationSelectors)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("example.org#?#div:-abp-properties(width: 213px)").AddToList();
+  filterEngine.GetFilter("example.org##.ad").AddToList();
+
+  auto emulationSelectors = filterEngine.GetElementHidingEmulationSelectors("example.org");
+  ASSERT_EQ(1u, emulationSelectors->selectors.size());
+  EXPECT_EQ("div:-abp-properties(width: 213px)", emulationSelectors->selectors[0].selector);
+  EXPECT_EQ("example.org#?#div:-abp-properties(width: 213px)", emulationSelectors->selectors[0].text);
+  EXPECT_EQ(emulationSelectors, filterEngine.GetElementHidingEmulationSelectors("example.org"));
+  EXPECT_TRUE(filterEngine.GetElementHidingEmulationSelectors("example.com")->selectors.empty());
+
+  filterEngine.GetFilter("example.org#?#span:-abp-has(.ad)").AddToList();
+  auto updatedSelectors = filterEngine.GetElementHidingEmulationSelectors("example.org");
+  EXPECT_NE(emulationSelectors, updatedSelectors);
+  EXPECT_EQ(2u, updatedSelectors->selectors.size());
+}
+
+TEST_F(FilterEngineTest, PageSetup)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("##.generic").AddToList();
+  filterEngine.GetFilter("example.org##.specific").AddToList();
+  filterEngine.GetFilter("@@||example.org^$generichide").AddToList();
+  filterEngine.GetFilter("@@||example.org^$genericblock").AddToList();
+  filterEngine.GetFilter("@@||example.com^$document").AddToList();
+  filterEngine.GetFilter("@@||example.net^$elemhide").AddToList();
+
+  auto pageSetup = filterEngine.GetPageSetup("http://example.org/page", std::vector<std::string>());
+  EXPECT_FALSE(pageSetup.documentWhitelisted);
+  EXPECT_FALSE(pageSetup.elemhideWhitelisted);
+  EXPECT_TRUE(pageSetup.genericHide);
+  EXPECT_TRUE(pageSetup.genericBlock);
+  EXPECT_EQ("example.org", pageSetup.domain);
+  EXPECT_FALSE(pageSetup.genericElementHidingStyleSheet);
+  ASSERT_TRUE(pageSetup.elementHidingStyleSheetDelta);
+  EXPECT_EQ(".specific", pageSetup.elementHidingStyleSheetDelta->selectors);
+
+  pageSetup = filterEngine.GetPageSetup("http://example.de/", std::vector<std::string>());
+  EXPECT_FALSE(pageSetup.genericHide);
+  EXPECT_FALSE(pageSetup.genericBlock);
+  EXPECT_EQ(filterEngine.GetGenericElementHidingStyleSheet(), pageSetup.genericElementHidingStyleSheet);
+  ASSERT_TRUE(pageSetup.elementHidingStyleSheetDelta);
+  EXPECT_EQ(0u, pageSetup.elementHidingStyleSheetDelta->GetSelectorCount());
+
+  // the same results as the separate calls, also for frames
+  std::vector<std::pair<std::string, std::vector<std::string>>> pages = {
+    {"http://example.com/", {}},
+    {"http://example.net/", {}},
+    {"http://example.de/frame", {"http://example.net/", "http://example.de/"}},
+    {"http://example.de/frame", {"http://example.de/", "http://example.com/"}},
+    {"http://example.de/frame", {"http://example.de/", "http://example.de/"}}
+  };
+  for (const auto& page : pages)
+  {
+    pageSetup = filterEngine.GetPageSetup(page.first, page.second);
+    EXPECT_EQ(filterEngine.IsDocumentWhitelisted(page.first, page.second), pageSetup.documentWhitelisted);
+    EXPECT_EQ(filterEngine.IsElemhideWhitelisted(page.first, page.second), pageSetup.elemhideWhitelisted);
+    if (pageSetup.documentWhitelisted || pageSetup.elemhideWhitelisted)
+    {
+      EXPECT_FALSE(pageSetup.elementHidingStyleSheetDelta);
+    }
+  }
+  EXPECT_TRUE(filterEngine.GetPageSetup("http://example.com/", std::vector<std::string>()).documentWhitelisted);
+  EXPECT_TRUE(filterEngine.GetPageSetup("http://example.net/", std::vector<std::string>()).elemhideWhitelisted);
+}
+
 TEST_F(FilterEngineTest, ElemhideWhitelisting)
 {
   auto& filterEngine = GetFilterEngine();
@@ -676,6 +1154,309 @@ TEST_F(FilterEngineWithInMemoryFS, DisableSubscriptionsAutoSelectOnFirstRun)
   EXPECT_FALSE(filterEngine.IsAAEnabled());
 }
 
+TEST_F(FilterEngineWithInMemoryFS, MemoryPressureOnSave)
+{
+  InitPlatformAndAppInfo();
+  FilterEngine::CreationParameters createParams;
+  std::vector<FilterEngine::MemoryPressureReport> reports;
+  createParams.memoryPressurePolicy.reportCallback = [&reports](const FilterEngine::MemoryPressureReport& report)
+  {
+    reports.push_back(report);
+  };
+  CreateFilterEngine(createParams);
+  reports.clear();
+  GetJsEngine().Evaluate("_triggerEvent('_filtersSaved')");
+  ASSERT_EQ(1u, reports.size());
+  EXPECT_LT(0u, reports[0].usedHeapSizeBefore);
+  EXPECT_LT(0u, reports[0].usedHeapSizeAfter);
+}
+
+TEST_F(FilterEngineWithInMemoryFS, MemoryPressureHeapThreshold)
+{
+  InitPlatformAndAppInfo();
+  FilterEngine::CreationParameters createParams;
+  int reportCount = 0;
+  createParams.memoryPressurePolicy.mode = FilterEngine::MemoryPressurePolicy::MODE_HEAP_THRESHOLD;
+  createParams.memoryPressurePolicy.heapThreshold = std::numeric_limits<size_t>::max();
+  createParams.memoryPressurePolicy.reportCallback = [&reportCount](const FilterEngine::MemoryPressureReport&)
+  {
+    ++reportCount;
+  };
+  CreateFilterEngine(createParams);
+  GetJsEngine().Evaluate("_triggerEvent('_filtersSaved')");
+  EXPECT_EQ(0, reportCount);
+}
+
+TEST_F(FilterEngineWithInMemoryFS, WarmCacheIsUsedAfterRestart)
+{
+  InitPlatformAndAppInfo();
+  {
+    auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+    // the filters are saved to patterns.ini when they are added.
+    filterEngine.GetFilter("||example.org/ad.png").AddToList();
+    filterEngine.GetFilter("example.org##.ad").AddToList();
+    filterEngine.GetElementHidingStyleSheet("example.org");
+    filterEngine.Matches("http://example.org/ad.png", FilterEngine::CONTENT_TYPE_IMAGE, "http://example.org/");
+    std::string saveError = "not called";
+    filterEngine.SaveWarmCache([&saveError](const std::string& error)
+    {
+      saveError = error;
+    });
+    EXPECT_EQ("", saveError);
+  }
+
+  RestartPlatform();
+  auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+  auto styleSheet = filterEngine.GetElementHidingStyleSheet("example.org");
+  auto match = filterEngine.Matches("http://example.org/ad.png", FilterEngine::CONTENT_TYPE_IMAGE, "http://example.org/");
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS));
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES));
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_MATCH_CACHE_HITS));
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_MATCH_CACHE_MISSES));
+  EXPECT_EQ(".ad", styleSheet->selectors);
+  ASSERT_TRUE(match);
+  EXPECT_EQ("||example.org/ad.png", match->GetProperty("text").AsString());
+}
+
+TEST_F(FilterEngineWithInMemoryFS, MatchesIsNotCachedWithoutWarmCache)
+{
+  InitPlatformAndAppInfo();
+  auto& filterEngine = CreateFilterEngine();
+  filterEngine.GetFilter("||example.org/ad.png").AddToList();
+  for (int i = 0; i < 2; ++i)
+    EXPECT_TRUE(filterEngine.Matches("http://example.org/ad.png", FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  EXPECT_EQ(2u, metrics->GetCounter(IMetrics::COUNTER_MATCHES));
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_MATCH_CACHE_HITS));
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_MATCH_CACHE_MISSES));
+}
+
+TEST_F(FilterEngineWithInMemoryFS, WarmCacheIsDiscardedForOtherAppVersion)
+{
+  InitPlatformAndAppInfo();
+  FilterEngine::CreationParameters createParams;
+  createParams.warmCacheFileName = "warmcache.dat";
+  {
+    auto& filterEngine = CreateFilterEngine(createParams);
+    filterEngine.GetElementHidingStyleSheet("example.org");
+    filterEngine.SaveWarmCache();
+  }
+
+  AppInfo appInfo;
+  appInfo.version = "2.0";
+  RestartPlatform(appInfo);
+  auto& filterEngine = CreateFilterEngine(createParams);
+  filterEngine.GetElementHidingStyleSheet("example.org");
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS));
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES));
+}
+
+TEST_F(FilterEngineWithInMemoryFS, WarmCacheIsDiscardedForOtherFilters)
+{
+  InitPlatformAndAppInfo();
+  {
+    auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+    auto filter = filterEngine.GetFilter("example.org##.ad");
+    filter.AddToList();
+    filterEngine.GetElementHidingStyleSheet("example.org");
+    filterEngine.SaveWarmCache();
+    // patterns.ini is saved again without the filter.
+    filter.RemoveFromList();
+  }
+
+  RestartPlatform();
+  auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+  auto styleSheet = filterEngine.GetElementHidingStyleSheet("example.org");
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS));
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES));
+  EXPECT_EQ("", styleSheet->selectors);
+}
+
+TEST_F(FilterEngineWithInMemoryFS, WarmCacheIsNotUsedAfterFiltersChange)
+{
+  InitPlatformAndAppInfo();
+  {
+    auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+    filterEngine.GetFilter("example.org##.ad").AddToList();
+    filterEngine.GetElementHidingStyleSheet("example.org");
+    filterEngine.SaveWarmCache();
+  }
+
+  RestartPlatform();
+  auto& filterEngine = CreateFilterEngine(WarmCacheCreationParameters());
+  filterEngine.GetFilter("example.org##.ad").RemoveFromList();
+  auto styleSheet = filterEngine.GetElementHidingStyleSheet("example.org");
+  EXPECT_EQ(0u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_HITS));
+  EXPECT_EQ(1u, metrics->GetCounter(IMetrics::COUNTER_ELEMHIDE_CACHE_MISSES));
+  EXPECT_EQ("", styleSheet->selectors);
+}
+
+TEST(FilterEnginePrefetchTest, PatternsIniIsReadOnceBeforeScriptsAreEvaluated)
+{
+  ReadRecordingFileSystem* fileSystem;
+  ThrowingPlatformCreationParameters platformParams;
+  platformParams.logSystem.reset(new LazyLogSystem());
+  platformParams.timer.reset(new NoopTimer());
+  platformParams.fileSystem.reset(fileSystem = new ReadRecordingFileSystem());
+  platformParams.webRequest.reset(new NoopWebRequest());
+  Platform platform(std::move(platformParams));
+  CreateFilterEngine(*fileSystem, platform);
+
+  ASSERT_FALSE(fileSystem->readFileNames.empty());
+  EXPECT_EQ("patterns.ini", fileSystem->readFileNames[0]);
+  EXPECT_EQ(1, std::count(fileSystem->readFileNames.begin(), fileSystem->readFileNames.end(), "patterns.ini"));
+}
+
+TEST_F(FilterEngineProgressiveStartupTest, PrioritySubscriptionsAreActiveFirst)
+{
+  // one line per slice.
+  GetJsEngine().SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  FilterEngine::CreationParameters createParams;
+  createParams.progressiveStartup = true;
+  bool isReady = false;
+  FilterEngine::StartupProgress progressWhenReady;
+  bool isUserFilterActive = false;
+  bool isListFilterActive = true;
+  platform->CreateFilterEngineAsync(createParams, [&](const FilterEngine& filterEngine)
+  {
+    isReady = true;
+    progressWhenReady = filterEngine.GetStartupProgress();
+    isUserFilterActive = !!filterEngine.Matches("http://example.com/user-ad.png",
+      FilterEngine::CONTENT_TYPE_IMAGE, "");
+    isListFilterActive = !!filterEngine.Matches("http://example.com/list-ad.png",
+      FilterEngine::CONTENT_TYPE_IMAGE, "");
+  });
+  while (RunNextTask())
+  {
+  }
+
+  ASSERT_TRUE(isReady);
+  EXPECT_FALSE(progressWhenReady.isComplete);
+  ASSERT_EQ(1u, progressWhenReady.liveSubscriptions.size());
+  EXPECT_EQ("~user~0000", progressWhenReady.liveSubscriptions[0]);
+  EXPECT_TRUE(isUserFilterActive);
+  EXPECT_FALSE(isListFilterActive);
+
+  auto& filterEngine = platform->GetFilterEngine();
+  auto progress = filterEngine.GetStartupProgress();
+  EXPECT_TRUE(progress.isComplete);
+  EXPECT_EQ(2u, progress.liveSubscriptions.size());
+  EXPECT_TRUE(filterEngine.Matches("http://example.com/list-ad.png",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+}
+
+TEST_F(FilterEngineProgressiveStartupTest, FilesWithoutPriorityCountAreReadyWhenLoaded)
+{
+  // saved before the progressive startup, EasyList comes first.
+  fileSystem->patternsIni = "# Adblock Plus preferences\nversion=5\n"
+    "[Subscription]\nurl=https://example.org/list.txt\n"
+    "[Subscription filters]\n||example.com/list-ad.png\n"
+    "[Subscription]\nurl=~user~0000\n"
+    "[Subscription filters]\n||example.com/user-ad.png\n";
+  GetJsEngine().SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  FilterEngine::CreationParameters createParams;
+  createParams.progressiveStartup = true;
+  bool isReady = false;
+  bool isUserFilterActive = false;
+  platform->CreateFilterEngineAsync(createParams, [&](const FilterEngine& filterEngine)
+  {
+    isReady = true;
+    isUserFilterActive = !!filterEngine.Matches("http://example.com/user-ad.png",
+      FilterEngine::CONTENT_TYPE_IMAGE, "");
+  });
+  while (RunNextTask())
+  {
+  }
+
+  ASSERT_TRUE(isReady);
+  EXPECT_TRUE(isUserFilterActive);
+  EXPECT_TRUE(platform->GetFilterEngine().Matches("http://example.com/list-ad.png",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+}
+
+TEST_F(FilterEngineProgressiveStartupTest, FiltersAreParsedInSlicesByDefault)
+{
+  FilterEngine::CreationParameters createParams;
+  createParams.progressiveStartup = true;
+  platform->CreateFilterEngineAsync(createParams);
+  EXPECT_LT(0, GetJsEngine().GetFileParsingSliceDuration().count());
+  while (RunNextTask())
+  {
+  }
+  EXPECT_TRUE(platform->GetFilterEngine().GetStartupProgress().isComplete);
+}
+
+TEST_F(FilterEngineProgressiveStartupTest, EngineIsUsableFromOtherThreadsWhileLoading)
+{
+  GetJsEngine().SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  FilterEngine::CreationParameters createParams;
+  createParams.progressiveStartup = true;
+  const FilterEngine* readyFilterEngine = nullptr;
+  platform->CreateFilterEngineAsync(createParams, [&](const FilterEngine& filterEngine)
+  {
+    readyFilterEngine = &filterEngine;
+  });
+  while (!readyFilterEngine && RunNextTask())
+  {
+  }
+  ASSERT_TRUE(readyFilterEngine);
+
+  // The remaining slices are pending, the engine is not locked meanwhile.
+  FilterEngine::StartupProgress progress;
+  bool isUserFilterActive = false;
+  std::thread([&]
+  {
+    progress = readyFilterEngine->GetStartupProgress();
+    isUserFilterActive = !!readyFilterEngine->Matches("http://example.com/user-ad.png",
+      FilterEngine::CONTENT_TYPE_IMAGE, "");
+  }).join();
+  EXPECT_FALSE(progress.isComplete);
+  EXPECT_TRUE(isUserFilterActive);
+
+  while (RunNextTask())
+  {
+  }
+  EXPECT_TRUE(readyFilterEngine->GetStartupProgress().isComplete);
+}
+
+TEST_F(FilterEngineProgressiveStartupTest, ChangesWhileLoadingAreAppliedAfterwards)
+{
+  GetJsEngine().SetFileParsingSliceDuration(std::chrono::microseconds(1));
+  FilterEngine::CreationParameters createParams;
+  createParams.progressiveStartup = true;
+  bool isReady = false;
+  platform->CreateFilterEngineAsync(createParams, [&](const FilterEngine&)
+  {
+    isReady = true;
+  });
+  while (!isReady && RunNextTask())
+  {
+  }
+  ASSERT_TRUE(isReady);
+
+  auto& filterEngine = platform->GetFilterEngine();
+  ASSERT_FALSE(filterEngine.GetStartupProgress().isComplete);
+  filterEngine.GetFilter("||example.com/early-ad.png").AddToList();
+  filterEngine.GetFilter("||example.com/user-ad.png").RemoveFromList();
+  filterEngine.GetSubscription("https://example.org/list.txt").SetDisabled(true);
+  while (RunNextTask())
+  {
+  }
+
+  ASSERT_TRUE(filterEngine.GetStartupProgress().isComplete);
+  auto filters = filterEngine.GetListedFilters();
+  ASSERT_EQ(1u, filters.size());
+  EXPECT_EQ("||example.com/early-ad.png", filters[0].GetProperty("text").AsString());
+  EXPECT_TRUE(filterEngine.Matches("http://example.com/early-ad.png",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  EXPECT_FALSE(filterEngine.Matches("http://example.com/user-ad.png",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  auto subscriptions = filterEngine.GetListedSubscriptions();
+  ASSERT_EQ(1u, subscriptions.size());
+  EXPECT_TRUE(subscriptions[0].IsDisabled());
+  EXPECT_FALSE(filterEngine.Matches("http://example.com/list-ad.png",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+}
+
 namespace AA_ApiTest
 {
   const std::string kOtherSubscriptionUrl = "https://non-existing-subscription.txt";
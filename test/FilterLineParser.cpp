@@ -0,0 +1,172 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "../src/FilePrefetcher.h"
+#include "../src/FilterLineParser.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  ParsedFilterLine Parse(const std::string& text)
+  {
+    return ParseFilterLine(text.c_str(), 0, static_cast<uint32_t>(text.size()));
+  }
+
+  std::string GetText(const std::string& text, const TextRange& range)
+  {
+    return text.substr(range.first, range.second - range.first);
+  }
+
+  std::vector<std::string> GetKeywordCandidates(const std::string& text)
+  {
+    std::vector<std::string> result;
+    auto parsedLine = Parse(text);
+    EXPECT_TRUE(parsedLine.hasKeywordCandidates) << text;
+    for (const auto& range : parsedLine.keywordCandidates)
+      result.push_back(GetText(text, range));
+    return result;
+  }
+
+  TokenizedFile Tokenize(const std::string& content)
+  {
+    return *TokenizeFile(IFileSystem::IOBuffer(content.begin(), content.end()), "", 0);
+  }
+
+  // "-" stands for lines without a keyword.
+  std::vector<std::string> GetKeywords(const TokenizedFile& file)
+  {
+    std::vector<std::string> result;
+    std::string content(file.content.begin(), file.content.end());
+    for (const auto& keyword : file.keywords)
+      result.push_back(keyword.first == NO_KEYWORD ? "-" : GetText(content, keyword));
+    return result;
+  }
+}
+
+TEST(FilterLineParserTest, ClassifiesFilters)
+{
+  EXPECT_EQ(ParsedFilterLine::TYPE_COMMENT, Parse("! comment").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_BLOCKING, Parse("||example.com/ad.png").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_BLOCKING, Parse("foo#bar").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_BLOCKING, Parse("a/b##c").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_EXCEPTION, Parse("@@||example.com^$document").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_ELEMHIDE, Parse("##.ad").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_ELEMHIDE_EXCEPTION, Parse("example.com#@#.ad").type);
+  EXPECT_EQ(ParsedFilterLine::TYPE_ELEMHIDE_EMULATION,
+    Parse("example.com#?#div:-abp-has(.ad)").type);
+}
+
+TEST(FilterLineParserTest, ExtractsDomainsAndOptions)
+{
+  std::string text = "example.com,~foo.example.com##.ad";
+  auto parsedLine = Parse(text);
+  EXPECT_EQ("example.com,~foo.example.com", GetText(text, parsedLine.domains));
+  EXPECT_EQ("", GetText(text, parsedLine.options));
+
+  text = "/banner/*$image,domain=example.com|~foo.example.com";
+  parsedLine = Parse(text);
+  EXPECT_EQ("image,domain=example.com|~foo.example.com", GetText(text, parsedLine.options));
+  EXPECT_EQ("example.com|~foo.example.com", GetText(text, parsedLine.domains));
+
+  text = "@@||example.com^$document";
+  parsedLine = Parse(text);
+  EXPECT_EQ("document", GetText(text, parsedLine.options));
+  EXPECT_EQ("", GetText(text, parsedLine.domains));
+
+  text = "||example.com/$foo$bar";
+  EXPECT_EQ("bar", GetText(text, Parse(text).options));
+
+  text = "||example.com/$$";
+  EXPECT_EQ("", GetText(text, Parse(text).options));
+}
+
+TEST(FilterLineParserTest, FindsKeywordCandidates)
+{
+  EXPECT_EQ(std::vector<std::string>({"example", "com"}),
+    GetKeywordCandidates("||example.com/ad.png"));
+  EXPECT_EQ(std::vector<std::string>({"example", "com"}),
+    GetKeywordCandidates("@@||example.com^$document"));
+  EXPECT_EQ(std::vector<std::string>({"COM"}), GetKeywordCandidates("Example.COM/"));
+  EXPECT_EQ(std::vector<std::string>(), GetKeywordCandidates("*banner*"));
+  // regular expressions have no keyword.
+  EXPECT_EQ(std::vector<std::string>(), GetKeywordCandidates("/banner/"));
+
+  EXPECT_FALSE(Parse("! example.com/").hasKeywordCandidates);
+  EXPECT_FALSE(Parse("example.com##.ad").hasKeywordCandidates);
+  EXPECT_FALSE(Parse("/banner/*$image").hasKeywordCandidates);
+  EXPECT_FALSE(Parse("||ex\xc3\xa4mple.com/").hasKeywordCandidates);
+  EXPECT_FALSE(Parse("||example.com^$csp=script-src 'self'").hasKeywordCandidates);
+  EXPECT_FALSE(Parse("||example.com^$foo=").hasKeywordCandidates);
+}
+
+TEST(FilterLineParserTest, FindsKeywordsOfFilterSections)
+{
+  auto file = Tokenize(
+    "# Adblock Plus preferences\n"
+    "version=5\n"
+    "\n"
+    "[Subscription]\n"
+    "url=~user~1\n"
+    "\n"
+    "[Subscription filters]\n"
+    "||example.com/ad.png\n"
+    "||example.com/banner.png\n"
+    "@@||example.com/ad.png\n"
+    "example.com##.ad\n"
+    "\n"
+    "[Subscription]\n"
+    "url=https://example.com/list.txt\n"
+    "\n"
+    "[Subscription filters]\n"
+    "/ads/\n"
+    "\\[foo]/bar.\n");
+  EXPECT_EQ(std::vector<std::string>({
+    "-", "-",
+    "-", "-",
+    "-", "example", "banner", "example", "-",
+    "-", "-",
+    "-", "", "foo"}), GetKeywords(file));
+
+  EXPECT_TRUE(Tokenize("[Subscription]\nurl=~user~1\n").keywords.empty());
+}
+
+TEST(FilterLineParserTest, ParallelParsingFindsSameKeywords)
+{
+  std::string content;
+  for (int subscription = 0; subscription < 6; ++subscription)
+  {
+    content += "[Subscription]\nurl=https://example.com/" + std::to_string(subscription) + ".txt\n";
+    content += "[Subscription filters]\n";
+    for (int i = 0; i < 3000; ++i)
+    {
+      content += "||host" + std::to_string(i % 50) + ".example" + std::to_string(subscription) +
+        ".com/ad" + std::to_string(i) + ".png\n";
+      content += "example" + std::to_string(i % 7) + ".com##.ad" + std::to_string(i) + "\n";
+    }
+  }
+  auto file = Tokenize(content);
+  auto sequentialFile = file;
+  sequentialFile.keywords.clear();
+  FindFilterKeywords(sequentialFile, 1);
+  auto parallelFile = file;
+  parallelFile.keywords.clear();
+  FindFilterKeywords(parallelFile, 4);
+  ASSERT_EQ(file.lines.size(), parallelFile.keywords.size());
+  EXPECT_EQ(GetKeywords(sequentialFile), GetKeywords(parallelFile));
+}
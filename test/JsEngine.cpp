@@ -16,6 +16,7 @@
  */
 
 #include <stdexcept>
+#include <thread>
 #include "BaseJsTest.h"
 
 using namespace AdblockPlus;
@@ -160,6 +161,238 @@ TEST_F(JsEngineTest, EventCallbacks)
   ASSERT_FALSE(callbackCalled);
 }
 
+TEST_F(JsEngineTest, EventCallbacksByID)
+{
+  int callbackCalled = 0;
+  AdblockPlus::JsValueList callbackParams;
+  auto Callback = [&callbackCalled, &callbackParams](JsValueList&& params)
+  {
+    ++callbackCalled;
+    callbackParams = move(params);
+  };
+
+  auto& jsEngine = GetJsEngine();
+  auto eventID = jsEngine.RegisterEvent("foobar");
+  ASSERT_EQ(eventID, jsEngine.RegisterEvent("foobar"));
+  ASSERT_NE(eventID, jsEngine.RegisterEvent("barfoo"));
+  ASSERT_EQ(static_cast<int>(eventID), jsEngine.Evaluate("_getEventId('foobar')").AsInt());
+
+  // Callbacks set by ID are triggered by name and vice versa
+  jsEngine.SetEventCallback(eventID, Callback);
+  jsEngine.Evaluate("_triggerEvent(_getEventId('foobar'), 1, 'x')");
+  ASSERT_EQ(1, callbackCalled);
+  ASSERT_EQ(2u, callbackParams.size());
+  ASSERT_EQ(1, callbackParams[0].AsInt());
+  ASSERT_EQ("x", callbackParams[1].AsString());
+  jsEngine.Evaluate("_triggerEvent('foobar')");
+  ASSERT_EQ(2, callbackCalled);
+  jsEngine.RemoveEventCallback("foobar");
+  jsEngine.TriggerEvent(eventID, JsValueList());
+  ASSERT_EQ(2, callbackCalled);
+
+  jsEngine.SetEventCallback("foobar", Callback);
+  jsEngine.TriggerEvent(eventID, JsValueList());
+  ASSERT_EQ(3, callbackCalled);
+
+  // Unknown IDs are ignored on triggering only
+  jsEngine.TriggerEvent(100000, JsValueList());
+  ASSERT_THROW(jsEngine.SetEventCallback(100000, Callback), std::runtime_error);
+  ASSERT_EQ(3, callbackCalled);
+}
+
+TEST_F(JsEngineTest, Session)
+{
+  auto& jsEngine = GetJsEngine();
+  {
+    JsEngineSession session(jsEngine);
+    auto object = jsEngine.Evaluate("({foo: 'bar', baz: 42})");
+    auto names = object.GetOwnPropertyNames();
+    ASSERT_EQ(2u, names.size());
+    ASSERT_EQ("bar", object.GetProperty("foo").AsString());
+    ASSERT_EQ(42, object.GetProperty("baz").AsInt());
+    {
+      JsEngineSession nestedSession(jsEngine);
+      ASSERT_TRUE(jsEngine.Evaluate("(function() { return true; })").Call().AsBool());
+    }
+    ASSERT_EQ("bar", object.GetProperty("foo").AsString());
+  }
+
+  // the engine is released once the session is destroyed
+  std::string result;
+  std::thread([&jsEngine, &result]
+  {
+    result = jsEngine.Evaluate("'foo' + 'bar'").AsString();
+  }).join();
+  ASSERT_EQ("foobar", result);
+}
+
+TEST_F(JsEngineTest, StoreAndTakeJsValues)
+{
+  auto& jsEngine = GetJsEngine();
+  JsValueList values;
+  values.push_back(jsEngine.NewValue("foo"));
+  values.push_back(jsEngine.NewValue(42));
+  auto id = jsEngine.StoreJsValues(values);
+
+  auto taken = jsEngine.TakeJsValues(id);
+  ASSERT_EQ(2u, taken.size());
+  ASSERT_EQ("foo", taken[0].AsString());
+  ASSERT_EQ(42, taken[1].AsInt());
+
+  // the slot is reused but the old ID stays stale
+  auto otherId = jsEngine.StoreJsValues(JsValueList());
+  EXPECT_THROW(jsEngine.TakeJsValues(id), std::runtime_error);
+  EXPECT_EQ(0u, jsEngine.TakeJsValues(otherId).size());
+  EXPECT_THROW(jsEngine.TakeJsValues(otherId), std::runtime_error);
+}
+
+TEST_F(JsEngineTest, HeapStatistics)
+{
+  auto& jsEngine = GetJsEngine();
+  auto before = jsEngine.GetHeapStatistics();
+  EXPECT_LT(0u, before.usedHeapSize);
+  EXPECT_LE(before.usedHeapSize, before.totalHeapSize);
+  EXPECT_LE(before.totalHeapSize, before.heapSizeLimit);
+
+  jsEngine.NotifyLowMemory();
+  auto after = jsEngine.GetHeapStatistics();
+  EXPECT_LT(before.majorGcCount, after.majorGcCount);
+}
+
+namespace
+{
+  void WaitForLockWaitingCount(JsEngine& jsEngine, unsigned count)
+  {
+    while (jsEngine.GetLockWaitingCount() < count)
+      std::this_thread::yield();
+  }
+}
+
+TEST_F(JsEngineTest, LockStatistics)
+{
+  auto& jsEngine = GetJsEngine();
+  jsEngine.Evaluate("1");
+  for (const auto& statistics : jsEngine.GetLockStatistics())
+    EXPECT_EQ(0u, statistics.acquisitions);
+
+  jsEngine.SetLockProfilingEnabled(true);
+  std::thread waitingThread;
+  {
+    JsEngineSession session(jsEngine);
+    waitingThread = std::thread([&jsEngine]
+    {
+      jsEngine.Evaluate("1");
+    });
+    // the wait of the thread is recorded from now on.
+    WaitForLockWaitingCount(jsEngine, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  waitingThread.join();
+  jsEngine.SetLockProfilingEnabled(false);
+  jsEngine.Evaluate("1");
+
+  auto statistics = jsEngine.GetLockStatistics();
+  ASSERT_EQ(static_cast<size_t>(JsEngine::LOCK_CATEGORY_COUNT), statistics.size());
+  const auto& other = statistics.front();
+  EXPECT_EQ(JsEngine::LOCK_CATEGORY_OTHER, other.category);
+  EXPECT_EQ(2u, other.acquisitions);
+  EXPECT_LE(std::chrono::milliseconds(40), other.maxWaitTime);
+  EXPECT_LE(std::chrono::milliseconds(40), other.maxHoldTime);
+  EXPECT_LE(other.maxWaitTime, other.blockingTime);
+  EXPECT_EQ("other", JsEngine::LockCategoryToString(other.category));
+  EXPECT_EQ("match", JsEngine::LockCategoryToString(JsEngine::LOCK_CATEGORY_MATCH));
+
+  jsEngine.ResetLockStatistics();
+  EXPECT_EQ(0u, jsEngine.GetLockStatistics().front().acquisitions);
+}
+
+namespace
+{
+  // Locks the engine, lets a background (a memory pressure notification)
+  // and then a foreground thread wait for it and returns whether the
+  // background thread has locked the engine first.
+  bool IsBackgroundLockedFirst(JsEngine& jsEngine)
+  {
+    auto initialGcCount = jsEngine.GetHeapStatistics().majorGcCount;
+    bool isBackgroundFirst = false;
+    std::thread background, foreground;
+    {
+      JsEngineSession session(jsEngine);
+      background = std::thread([&jsEngine]
+      {
+        jsEngine.NotifyLowMemory();
+      });
+      WaitForLockWaitingCount(jsEngine, 1);
+      foreground = std::thread([&jsEngine, &isBackgroundFirst, initialGcCount]
+      {
+        JsEngineSession foregroundSession(jsEngine);
+        isBackgroundFirst = jsEngine.GetHeapStatistics().majorGcCount != initialGcCount;
+      });
+      // both wait at the lock gate, which decides the order.
+      WaitForLockWaitingCount(jsEngine, 2);
+    }
+    background.join();
+    foreground.join();
+    return isBackgroundFirst;
+  }
+}
+
+TEST_F(JsEngineTest, ForegroundLockPriority)
+{
+  auto& jsEngine = GetJsEngine();
+  JsEngine::LockPriorityParameters parameters;
+  parameters.enabled = true;
+  jsEngine.SetLockPriorityParameters(parameters);
+  EXPECT_FALSE(IsBackgroundLockedFirst(jsEngine));
+}
+
+TEST_F(JsEngineTest, BackgroundLockStarvationProtection)
+{
+  auto& jsEngine = GetJsEngine();
+  JsEngine::LockPriorityParameters parameters;
+  parameters.enabled = true;
+  // the session holding the lock in IsBackgroundLockedFirst() is the only
+  // foreground acquisition allowed before a waiting background one
+  parameters.maxForegroundBurst = 1;
+  jsEngine.SetLockPriorityParameters(parameters);
+  EXPECT_TRUE(IsBackgroundLockedFirst(jsEngine));
+}
+
+TEST(NewJsEngineTest, IsolateParameters)
+{
+  Platform platform{ThrowingPlatformCreationParameters()};
+  JsEngine::IsolateParameters isolateParameters;
+  isolateParameters.maxOldGenerationSizeMB = 32;
+  isolateParameters.maxSemiSpaceSizeMB = 1;
+  int nearHeapLimitCalls = 0;
+  isolateParameters.nearHeapLimitCallback = [&nearHeapLimitCalls](const JsEngine::HeapStatistics&)
+  {
+    ++nearHeapLimitCalls;
+  };
+  // any garbage collection reaches the zero ratio
+  isolateParameters.nearHeapLimitRatio = 0;
+  platform.SetUpJsEngine(AppInfo(), isolateParameters);
+  auto& jsEngine = platform.GetJsEngine();
+  EXPECT_GT(64u * 1024 * 1024, jsEngine.GetHeapStatistics().heapSizeLimit);
+
+  nearHeapLimitCalls = 0;
+  jsEngine.NotifyLowMemory();
+  EXPECT_LT(0, nearHeapLimitCalls);
+}
+
+TEST(NewJsEngineTest, InitializeV8OnlyOnce)
+{
+  JsEngine::V8Parameters parameters;
+  parameters.profile = "unknown";
+  EXPECT_THROW(JsEngine::InitializeV8(parameters), std::invalid_argument);
+
+  Platform platform{ThrowingPlatformCreationParameters()};
+  platform.GetJsEngine();
+  parameters.profile = "low-memory";
+  parameters.workerThreadCount = 1;
+  EXPECT_THROW(JsEngine::InitializeV8(parameters), std::logic_error);
+}
+
 TEST(NewJsEngineTest, GlobalPropertyTest)
 {
   Platform platform{ThrowingPlatformCreationParameters()};
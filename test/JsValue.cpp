@@ -183,6 +183,44 @@ TEST_F(JsValueTest, ArrayValue)
   ASSERT_ANY_THROW(value.Call());
 }
 
+TEST_F(JsValueTest, AsStringVector)
+{
+  auto value = GetJsEngine().Evaluate("['foo', 5, '\u00e4\u00f6', null, '']");
+  auto strings = value.AsStringVector();
+  ASSERT_EQ(5u, strings.size());
+  EXPECT_EQ("foo", strings[0]);
+  EXPECT_EQ("5", strings[1]);
+  EXPECT_EQ("\xC3\xA4\xC3\xB6", strings[2]);
+  EXPECT_EQ("null", strings[3]);
+  EXPECT_EQ("", strings[4]);
+  EXPECT_TRUE(GetJsEngine().Evaluate("[]").AsStringVector().empty());
+  ASSERT_ANY_THROW(GetJsEngine().Evaluate("({})").AsStringVector());
+  ASSERT_ANY_THROW(GetJsEngine().Evaluate("'foo'").AsStringVector());
+}
+
+TEST_F(JsValueTest, AsStringMap)
+{
+  auto value = GetJsEngine().Evaluate("({foo: 'bar', x: 2, empty: ''})");
+  auto strings = value.AsStringMap();
+  ASSERT_EQ(3u, strings.size());
+  EXPECT_EQ("bar", strings["foo"]);
+  EXPECT_EQ("2", strings["x"]);
+  EXPECT_EQ("", strings["empty"]);
+  EXPECT_TRUE(GetJsEngine().NewObject().AsStringMap().empty());
+  ASSERT_ANY_THROW(GetJsEngine().Evaluate("'foo'").AsStringMap());
+}
+
+TEST_F(JsValueTest, AsStringPairs)
+{
+  auto value = GetJsEngine().Evaluate("({foo: 'bar', x: 2, abc: ''})");
+  auto pairs = value.AsStringPairs();
+  ASSERT_EQ(3u, pairs.size());
+  EXPECT_EQ(std::make_pair(std::string("foo"), std::string("bar")), pairs[0]);
+  EXPECT_EQ(std::make_pair(std::string("x"), std::string("2")), pairs[1]);
+  EXPECT_EQ(std::make_pair(std::string("abc"), std::string("")), pairs[2]);
+  ASSERT_ANY_THROW(GetJsEngine().Evaluate("'foo'").AsStringPairs());
+}
+
 TEST_F(JsValueTest, FunctionValue)
 {
   auto value = GetJsEngine().Evaluate("(function(foo, bar) {return this.x + '/' + foo + '/' + bar;})");
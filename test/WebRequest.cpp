@@ -174,6 +174,14 @@ TEST_F(MockWebRequestTest, SuccessfulRequest)
   ASSERT_EQ("{\"Foo\":\"Bar\"}", jsEngine.Evaluate("JSON.stringify(foo.responseHeaders)").AsString());
 }
 
+TEST_F(MockWebRequestTest, RequestHeadersKeepTheirOrder)
+{
+  auto& jsEngine = GetJsEngine();
+  jsEngine.Evaluate("let foo; _webRequest.GET('http://example.com/', {Z: 'z', A: 'a'}, function(result) {foo = result;} )");
+  ProcessPendingWebRequests();
+  ASSERT_EQ("http://example.com/\nZ\nz", jsEngine.Evaluate("foo.responseText").AsString());
+}
+
 #if defined(HAVE_CURL) || defined(_WIN32)
 TEST_F(DefaultWebRequestTest, RealWebRequest)
 {